@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cinttypes>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "fancysoft/util/perf_counters.hh"
+
+namespace Fancysoft {
+namespace Bench {
+
+/// Prevent the compiler from optimizing away a *value*.
+template <typename T> inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Run the *function* *iterations* times (after a tenth as many warm-up
+/// iterations), and print the average time and hardware performance counters
+/// per iteration to the standard output.
+///
+/// @code{.cpp}
+///   Bench::run("vector push", 1000000, [&]() { vector.push_back(42); });
+/// @endcode
+template <typename F>
+void run(const std::string &name, uint64_t iterations, F &&function) {
+  for (uint64_t i = 0; i < iterations / 10; i++)
+    function();
+
+  // Shall be opened on the same thread.
+  static thread_local Util::PerfCounters counters;
+
+  auto start_counters = counters.read();
+  auto start = std::chrono::steady_clock::now();
+
+  for (uint64_t i = 0; i < iterations; i++)
+    function();
+
+  auto duration = std::chrono::steady_clock::now() - start;
+  auto delta = counters.read() - start_counters;
+
+  auto flags = std::cout.flags();
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(12)
+            << std::chrono::duration<double, std::nano>(duration).count() /
+                   iterations
+            << " ns/op";
+
+  for (size_t i = 0; i < Util::PerfCounters::CounterCount; i++) {
+    auto counter = (Util::PerfCounters::Counter)i;
+
+    if (counters.has(counter))
+      std::cout << std::setw(12) << (double)delta[counter] / iterations << " "
+                << Util::PerfCounters::name(counter) << "/op";
+  }
+
+  std::cout << "\n";
+  std::cout.flags(flags);
+}
+
+} // namespace Bench
+} // namespace Fancysoft
@@ -0,0 +1,41 @@
+#include <memory>
+#include <string>
+
+#include "fancysoft/bench.hh"
+#include "fancysoft/nxc/file.hh"
+#include "fancysoft/nxc/onyx/lexer.hh"
+
+using namespace Fancysoft;
+
+// The default release verbosity, i.e. the trace logging is disabled.
+Util::Logger Util::logger(Util::Logger::Verbosity::Warn, std::cerr);
+
+namespace {
+
+/// An in-memory source file which is not parsed.
+struct Source : NXC::File {
+  using NXC::File::File;
+  NXC::Position parse() override { return NXC::Position(); }
+};
+
+} // namespace
+
+int main() {
+  std::string source;
+
+  while (source.size() < 64 * 1024)
+    source += "let message = $\"Hello, world!\"\n"
+              "$puts(message)\n"
+              "let answer = sum(forty, two)\n";
+
+  Bench::run("Onyx::Lexer (64 KiB)", 100, [&]() {
+    auto unit = std::make_shared<Source>("bench.nx", source);
+    NXC::Onyx::Lexer lexer(unit);
+
+    for (auto &&token : lexer.lex())
+      Bench::do_not_optimize(token);
+
+    if (lexer.exception())
+      std::rethrow_exception(lexer.exception());
+  });
+}
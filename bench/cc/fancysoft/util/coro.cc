@@ -0,0 +1,160 @@
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "fancysoft/bench.hh"
+#include "fancysoft/util/coro.hh"
+
+using namespace Fancysoft;
+
+namespace {
+
+// The baselines are not inlined, as neither are the coroutine resumptions.
+
+[[gnu::noinline]] int next_value(int &state) { return state++; }
+
+Util::Coro::Generator<int> values() {
+  for (int i = 0;; i++)
+    co_yield i;
+}
+
+Util::Coro::Generator<int> single_value() { co_yield 42; }
+
+Util::Coro::Sync<int> sync_value() { co_return 42; }
+
+Util::Coro::Async<int> async_value() { co_return 42; }
+
+/// About the size of a lexer frame.
+struct alignas(16) Frame {
+  char data[256];
+};
+
+/// A word of the source, as a lexer token would be.
+struct Token {
+  std::string_view text;
+};
+
+/// Yields the characters of *source*.
+Util::Coro::Generator<char> chars(std::string_view source) {
+  for (auto c : source)
+    co_yield c;
+}
+
+/// Yields the space-separated words of *source*, read via a nested
+/// generator, similar to the lexer reading a source file.
+Util::Coro::Generator<Token> tokens(std::string_view source) {
+  size_t start = 0, position = 0;
+
+  for (auto c : chars(source)) {
+    if (c == ' ' || c == '\n') {
+      if (position > start)
+        co_yield Token{source.substr(start, position - start)};
+
+      start = position + 1;
+    }
+
+    position++;
+  }
+}
+
+/// The same as `tokens()`, but calling back.
+[[gnu::noinline]] void
+tokens(std::string_view source, const std::function<void(Token)> &callback) {
+  size_t start = 0, position = 0;
+
+  for (auto c : source) {
+    if (c == ' ' || c == '\n') {
+      if (position > start)
+        callback(Token{source.substr(start, position - start)});
+
+      start = position + 1;
+    }
+
+    position++;
+  }
+}
+
+} // namespace
+
+int main() {
+  const uint64_t iterations = 10000000;
+
+  // Resume latency
+  //
+
+  int state = 0;
+
+  Bench::run("function call", iterations, [&]() {
+    Bench::do_not_optimize(next_value(state));
+  });
+
+  std::function<void(int)> callback = [](int value) {
+    Bench::do_not_optimize(value);
+  };
+
+  Bench::run("std::function call", iterations, [&]() { callback(state++); });
+
+  auto generator = values();
+  generator.resume();
+
+  Bench::run("Generator::next()", iterations, [&]() {
+    Bench::do_not_optimize(generator.next());
+  });
+
+  // Frame allocation
+  //
+
+  Bench::run("operator new/delete (256 B)", iterations, [&]() {
+    auto frame = new Frame;
+    Bench::do_not_optimize(frame);
+    delete frame;
+  });
+
+  Bench::run("Generator create/destroy", iterations, [&]() {
+    auto generator = single_value();
+    Bench::do_not_optimize(generator);
+  });
+
+  Bench::run("Generator create/next/destroy", iterations, [&]() {
+    auto generator = single_value();
+    Bench::do_not_optimize(generator.next());
+  });
+
+  Bench::run("Sync<int> call", iterations, [&]() {
+    auto sync = sync_value();
+    Bench::do_not_optimize(sync.get());
+  });
+
+  Bench::run("Async<int> call", iterations, [&]() {
+    auto async = async_value();
+    Bench::do_not_optimize(async.get());
+  });
+
+  // Throughput
+  //
+
+  std::string source;
+
+  while (source.size() < 64 * 1024)
+    source += "let message = $\"Hello, world!\"\n"
+              "$puts(message)\n"
+              "let answer = sum(forty, two)\n";
+
+  size_t count = 0;
+
+  for (auto &&token : tokens(source)) {
+    Bench::do_not_optimize(token);
+    count++;
+  }
+
+  auto suffix = " (" + std::to_string(count) + " tokens)";
+
+  Bench::run("Generator pipeline" + suffix, 100, [&]() {
+    for (auto &&token : tokens(source))
+      Bench::do_not_optimize(token);
+  });
+
+  Bench::run("callback pipeline" + suffix, 100, [&]() {
+    tokens(source, [](Token token) { Bench::do_not_optimize(token); });
+  });
+}
@@ -0,0 +1,158 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fancysoft/bench.hh"
+#include "fancysoft/util/pool.hh"
+
+using namespace Fancysoft;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Dummy {
+  uint64_t value = 0;
+};
+
+/// Run *function* on *threads_count* threads at once, returning the time it
+/// has taken for all of them.
+template <typename F> Clock::duration parallel(unsigned threads_count, F &&f) {
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+
+  for (unsigned t = 0; t < threads_count; t++)
+    threads.emplace_back([&go, &f, t]() {
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+      f(t);
+    });
+
+  auto start = Clock::now();
+  go.store(true, std::memory_order_release);
+
+  for (auto &thread : threads)
+    thread.join();
+
+  return Clock::now() - start;
+}
+
+void print_stats(const Util::Pool<Dummy>::Stats &stats) {
+  std::cout << "  hits " << stats.hits << ", depot hits " << stats.depot_hits
+            << ", steals " << stats.steals << ", creations " << stats.creations
+            << ", waits " << stats.waits << ", timeouts " << stats.timeouts
+            << "\n";
+}
+
+/// The acquire/release throughput of a pool large enough not to wait.
+void throughput(unsigned threads_count) {
+  const uint64_t iterations = 1000000;
+  Util::Pool<Dummy> pool([] { return Dummy(); }, threads_count);
+
+  auto duration = parallel(threads_count, [&pool](unsigned) {
+    for (uint64_t i = 0; i < iterations; i++) {
+      auto dummy = pool.acquire();
+      Bench::do_not_optimize(++dummy->value);
+      pool.release(std::move(dummy));
+    }
+  });
+
+  auto ops = (double)iterations * threads_count;
+
+  std::cout << std::left << std::setw(40)
+            << ("acquire/release (" + std::to_string(threads_count) +
+                " threads)")
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12)
+            << std::chrono::duration<double, std::nano>(duration).count() /
+                   iterations
+            << " ns/op" << std::setw(12)
+            << ops / std::chrono::duration<double>(duration).count() / 1e6
+            << " Mops/s\n";
+
+  print_stats(pool.stats());
+}
+
+/// The acquisition wait times of more threads than objects, each holding an
+/// object for a while, and acquiring with a timeout of the same order.
+void wait_histogram(unsigned threads_count) {
+  const int iterations = 2000;
+  const auto hold = std::chrono::microseconds(20);
+  const auto timeout = std::chrono::microseconds(100);
+
+  Util::Pool<Dummy> pool([] { return Dummy(); }, 2);
+
+  // Buckets by the power of two of microseconds, the last is the overflow.
+  std::array<std::atomic<uint64_t>, 16> buckets = {};
+
+  parallel(threads_count, [&](unsigned) {
+    for (int i = 0; i < iterations; i++) {
+      auto start = Clock::now();
+      auto dummy = pool.acquire(timeout);
+      auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - start)
+                        .count();
+
+      size_t bucket = 0;
+
+      while (waited > 0 && bucket < buckets.size() - 1) {
+        waited >>= 1;
+        bucket++;
+      }
+
+      buckets[bucket]++;
+
+      if (dummy) {
+        auto until = Clock::now() + hold;
+
+        while (Clock::now() < until)
+          Bench::do_not_optimize(++dummy->value);
+
+        pool.release(std::move(dummy));
+      }
+    }
+  });
+
+  std::cout << "acquire wait time (" << threads_count
+            << " threads, 2 objects, " << timeout.count() << " us timeout)\n";
+
+  for (size_t i = 0; i < buckets.size(); i++) {
+    auto count = buckets[i].load();
+
+    if (!count)
+      continue;
+
+    std::string range;
+
+    if (i == 0)
+      range = "< 1 us";
+    else if (i == buckets.size() - 1)
+      range = ">= " + std::to_string(1 << (i - 1)) + " us";
+    else // Half-open
+      range = std::to_string(1 << (i - 1)) + "-" + std::to_string(1 << i) +
+              " us";
+
+    auto bar = count * 50 / (iterations * threads_count);
+
+    std::cout << "  " << std::left << std::setw(16) << range << std::right
+              << std::setw(10) << count << " " << std::string(bar, '#')
+              << "\n";
+  }
+
+  print_stats(pool.stats());
+}
+
+} // namespace
+
+int main() {
+  for (unsigned threads : {1, 2, 4, 8})
+    throughput(threads);
+
+  for (unsigned threads : {4, 8})
+    wait_histogram(threads);
+}
@@ -0,0 +1,29 @@
+#include "fancysoft/bench.hh"
+#include "fancysoft/util/time_trace.hh"
+
+using namespace Fancysoft;
+
+int main() {
+  const uint64_t iterations = 1000000;
+  Util::TimeTrace trace;
+
+  Bench::run("TimeTrace::Scope (disabled)", iterations, [&]() {
+    Util::TimeTrace::Scope scope("Bench", "detail", &trace);
+    Bench::do_not_optimize(scope);
+  });
+
+  trace.enable();
+
+  Bench::run("TimeTrace::Scope (enabled)", iterations, [&]() {
+    Util::TimeTrace::Scope scope("Bench", "detail", &trace);
+    Bench::do_not_optimize(scope);
+  });
+
+  trace.clear();
+  trace.enable(true);
+
+  Bench::run("TimeTrace::Scope (enabled, counters)", iterations, [&]() {
+    Util::TimeTrace::Scope scope("Bench", "detail", &trace);
+    Bench::do_not_optimize(scope);
+  });
+}
@@ -0,0 +1,32 @@
+#include <filesystem>
+
+#include "fancysoft/bench.hh"
+#include "fancysoft/util/trace_log.hh"
+
+using namespace Fancysoft;
+
+int main() {
+  const uint64_t iterations = 10000000;
+  auto path = std::filesystem::temp_directory_path() / "fnxc-bench.trace";
+  uint64_t i = 0;
+
+  Bench::run("FNXC_TRACE_EVENT (disabled)", iterations, [&]() {
+    FNXC_TRACE_EVENT("Bench", "read", 'x', i, i);
+    Bench::do_not_optimize(++i);
+  });
+
+  Util::trace_log.open(path);
+
+  Bench::run("FNXC_TRACE_EVENT (enabled)", iterations, [&]() {
+    FNXC_TRACE_EVENT("Bench", "read", 'x', i, i);
+    Bench::do_not_optimize(++i);
+  });
+
+  Bench::run("FNXC_TRACE_EVENT (enabled, string)", iterations, [&]() {
+    FNXC_TRACE_EVENT("Bench", "parsed", "VarDecl");
+    Bench::do_not_optimize(++i);
+  });
+
+  Util::trace_log.close();
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,206 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fancysoft/bench.hh"
+#include "fancysoft/util/utf8.hh"
+
+using namespace Fancysoft;
+
+namespace {
+
+/// The previous implementation walking a table of `new`-allocated
+/// entries, kept as the baseline.
+namespace Legacy {
+
+typedef struct {
+  uint8_t mask;
+  uint8_t lead;
+  uint32_t range_begin;
+  uint32_t range_end;
+  uint8_t significant_bits;
+} utf_t;
+
+utf_t *utf[] = {
+    new utf_t({0b00111111, 0b10000000, 0, 0, 6}),
+    new utf_t({0b01111111, 0b00000000, 0000, 0177, 7}),
+    new utf_t({0b00011111, 0b11000000, 0200, 03777, 5}),
+    new utf_t({0b00001111, 0b11100000, 04000, 0177777, 4}),
+    new utf_t({0b00000111, 0b11110000, 0200000, 04177777, 3}),
+    0,
+};
+
+[[gnu::noinline]] size_t code_point_byte_size(char32_t codepoint) {
+  size_t len = 0;
+
+  for (utf_t **u = utf; *u; ++u) {
+    if ((codepoint >= (*u)->range_begin) && (codepoint <= (*u)->range_end))
+      break;
+
+    ++len;
+  }
+
+  if (len > 4)
+    throw Util::UTF8::Error("UTF-8 codepoint length out of boundaries");
+
+  return len == 0 ? 1 : len;
+}
+
+[[gnu::noinline]] size_t size_from_leading_byte(char8_t ch) {
+  size_t len = 0;
+
+  for (utf_t **u = utf; *u; ++u) {
+    uint8_t result = (ch & ~(*u)->mask);
+
+    if (result == ((*u)->lead))
+      break;
+
+    len++;
+  }
+
+  if (len > 4)
+    throw Util::UTF8::Error("Malformed leading byte");
+
+  return len;
+}
+
+[[gnu::noinline]] char8_t *to_code_units(char32_t codepoint) {
+  static thread_local char8_t ret[5];
+  const int bytes = code_point_byte_size(codepoint);
+
+  int shift = utf[0]->significant_bits * (bytes - 1);
+  ret[0] = (codepoint >> shift & utf[bytes]->mask) | utf[bytes]->lead;
+  shift -= utf[0]->significant_bits;
+
+  for (int i = 1; i < bytes; ++i) {
+    ret[i] = (codepoint >> shift & utf[0]->mask) | utf[0]->lead;
+    shift -= utf[0]->significant_bits;
+  }
+
+  ret[bytes] = '\0';
+  return ret;
+}
+
+[[gnu::noinline]] char32_t to_code_point(const char8_t *codeunits) {
+  int bytes = size_from_leading_byte(*codeunits);
+  int shift = utf[0]->significant_bits * (bytes - 1);
+  char32_t codepoint = (*codeunits++ & utf[bytes]->mask) << shift;
+
+  for (int i = 1; i < bytes; ++i, ++codeunits) {
+    shift -= utf[0]->significant_bits;
+    codepoint |= ((char8_t)*codeunits & utf[0]->mask) << shift;
+  }
+
+  return codepoint;
+}
+
+} // namespace Legacy
+
+/// Benchmark the bulk operations over *text* repeated up to 64 KiB.
+void bulk(const std::string &name, const std::u8string &text) {
+  std::u8string units;
+
+  while (units.size() < 64 * 1024)
+    units += text;
+
+  std::vector<char32_t> code_points(units.size());
+  code_points.resize(Util::UTF8::decode_n(units, code_points));
+
+  std::u8string encoded(code_points.size() * 4, '\0');
+  const auto suffix = " (" + name + ", 64 KiB)";
+
+  Bench::run("legacy count" + suffix, 100, [&]() {
+    size_t count = 0;
+
+    for (size_t i = 0; i < units.size();
+         i += Legacy::size_from_leading_byte(units[i]))
+      count++;
+
+    Bench::do_not_optimize(count);
+  });
+
+  Bench::run("count_code_points" + suffix, 100, [&]() {
+    Bench::do_not_optimize(Util::UTF8::count_code_points(units));
+  });
+
+  Bench::run("legacy decode" + suffix, 100, [&]() {
+    size_t written = 0;
+
+    for (size_t i = 0; i < units.size();
+         i += Legacy::size_from_leading_byte(units[i]))
+      code_points[written++] = Legacy::to_code_point(units.data() + i);
+
+    Bench::do_not_optimize(code_points.data());
+  });
+
+  Bench::run("decode_n" + suffix, 100, [&]() {
+    Bench::do_not_optimize(Util::UTF8::decode_n(units, code_points));
+  });
+
+  Bench::run("legacy encode" + suffix, 100, [&]() {
+    size_t written = 0;
+
+    for (auto code_point : code_points) {
+      auto size = Legacy::code_point_byte_size(code_point);
+      std::memcpy(
+          encoded.data() + written, Legacy::to_code_units(code_point), size);
+      written += size;
+    }
+
+    Bench::do_not_optimize(written);
+  });
+
+  Bench::run("encode_n" + suffix, 100, [&]() {
+    Bench::do_not_optimize(Util::UTF8::encode_n(code_points, encoded));
+  });
+}
+
+} // namespace
+
+int main() {
+  const uint64_t iterations = 10000000;
+  const char8_t lead = 0xd0; // Ж
+  const char32_t code_point = 0x20ac; // €
+
+  // Scalar
+  //
+
+  Bench::run("legacy size_from_leading_byte", iterations, [&]() {
+    Bench::do_not_optimize(Legacy::size_from_leading_byte(lead));
+  });
+
+  Bench::run("size_from_leading_byte", iterations, [&]() {
+    Bench::do_not_optimize(Util::UTF8::size_from_leading_byte(lead));
+  });
+
+  Bench::run("legacy code_point_byte_size", iterations, [&]() {
+    Bench::do_not_optimize(Legacy::code_point_byte_size(code_point));
+  });
+
+  Bench::run("code_point_byte_size", iterations, [&]() {
+    Bench::do_not_optimize(Util::UTF8::code_point_byte_size(code_point));
+  });
+
+  Bench::run("legacy to_code_units", iterations, [&]() {
+    Bench::do_not_optimize(Legacy::to_code_units(code_point)[0]);
+  });
+
+  Bench::run("to_code_units", iterations, [&]() {
+    Bench::do_not_optimize(Util::UTF8::to_code_units(code_point)[0]);
+  });
+
+  Bench::run("legacy to_code_point", iterations, [&]() {
+    Bench::do_not_optimize(Legacy::to_code_point(u8"€"));
+  });
+
+  Bench::run("to_code_point", iterations, [&]() {
+    Bench::do_not_optimize(Util::UTF8::to_code_point(u8"€"));
+  });
+
+  // Bulk
+  //
+
+  bulk("ASCII", u8"let message = $\"Hello, world!\"\n$puts(message)\n");
+  bulk("Cyrillic", u8"пусть сообщение = $\"Привет, мир!\"\n");
+  bulk("mixed", u8"let ö_ж = \"€ 𝄞\"\n$puts(ö_ж)\n");
+}
@@ -19,6 +19,9 @@ private:
   std::shared_ptr<AST::TypeRef> _parse_type_ref();
   std::shared_ptr<AST::FuncDecl::ArgDecl> _parse_arg_decl();
 
+  /// Skip tokens past the erroneous declaration, i.e. up to the semicolon.
+  void _synchronize(bool single_expression);
+
   bool _is_punct(Token::Punct::Kind kind) const {
     if (auto punct = _if<Token::Punct>())
       return punct->kind == kind;
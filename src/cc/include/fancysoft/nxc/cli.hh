@@ -7,6 +7,7 @@
 
 #include "../util/cli.hh"
 #include "../util/logger.hh"
+#include "./daemon.hh"
 #include "./exception.hh"
 #include "./program.hh"
 
@@ -14,10 +15,23 @@ namespace Fancysoft {
 namespace NXC {
 
 struct CLI {
+  /// Create a CLI. With *program_cache* set (i.e. within a daemon), programs
+  /// are kept warm between runs; otherwise, compilation requests are
+  /// forwarded to a running daemon, if any.
+  CLI(ProgramCache *program_cache = nullptr) : _program_cache(program_cache) {}
+
   /// Run the CLI.
   int run(int argc, const char **argv) noexcept;
 
 private:
+  ProgramCache *_program_cache;
+
+  /// The compilation statistics format, see `--stats`.
+  enum class _StatsFormat {
+    Text, ///< A table printed to the standard error output, `--stats`.
+    JSON, ///< A JSON report written to a file, `--stats=json`.
+  };
+
   /// The command to compile an Onyx program.
   struct Compile : Util::CLI::Command {
     /// The compile command payload.
@@ -28,6 +42,7 @@ private:
         Exe,  ///< Emit an executable file, `--emit=exe`.
         MLIR, ///< Emit an MLIR archive, `--emit=mlir`.
         LLIR, ///< Emit an LLIR archive, `--emit=llir`.
+        BC,   ///< Emit an LLVM bitcode archive, `--emit=bc`.
       };
 
       /// An issued help request, e.g. `compile /emit /?`.
@@ -36,6 +51,7 @@ private:
         Output,
         Emit,
         Cache,
+        Target,
         LoggerVerbosity,
       };
 
@@ -66,6 +82,12 @@ private:
         return _emit;
       }
 
+      /// Get the parsed IR output format, if any (e.g. `--emit=llir:tar`).
+      std::optional<Program::IROutputFormat> ir_format() const {
+        assert(_parsed);
+        return _ir_format;
+      }
+
       /// Get the parsed cache path, if any. The monostate implies an explicitly
       /// disabled caching (i.e. `--no-cache`).
       std::optional<std::variant<std::filesystem::path, std::monostate>>
@@ -74,6 +96,63 @@ private:
         return _cache;
       }
 
+      /// Get the parsed target triple, if any.
+      std::optional<std::string> target_triple() const {
+        assert(_parsed);
+        return _target_triple;
+      }
+
+      /// Get the parsed target CPU name, if any. May be `"native"`.
+      std::optional<std::string> target_cpu() const {
+        assert(_parsed);
+        return _target_cpu;
+      }
+
+      /// Get the parsed list of target features, e.g. `{"+avx2", "-sse4a"}`.
+      std::vector<std::string> target_features() const {
+        assert(_parsed);
+        return _target_features;
+      }
+
+      /// Get the parsed optimization level, if any (e.g. `-O2`).
+      std::optional<unsigned> opt_level() const {
+        assert(_parsed);
+        return _opt_level;
+      }
+
+      /// Get the parsed time trace output path, if any. An empty path implies
+      /// the default one (i.e. `--time-trace`).
+      std::optional<std::filesystem::path> time_trace() const {
+        assert(_parsed);
+        return _time_trace;
+      }
+
+      /// Get the parsed binary trace log output path, if any. An empty path
+      /// implies the default one (i.e. `--trace-log`).
+      std::optional<std::filesystem::path> trace_log() const {
+        assert(_parsed);
+        return _trace_log;
+      }
+
+      /// Check if the low-memory mode is requested, i.e. `--low-memory`.
+      bool low_memory() const {
+        assert(_parsed);
+        return _low_memory;
+      }
+
+      /// Check if compiling in-process is requested even if a daemon is
+      /// running, i.e. `--no-daemon`.
+      bool no_daemon() const {
+        assert(_parsed);
+        return _no_daemon;
+      }
+
+      /// Get the parsed compilation statistics format, if any.
+      std::optional<_StatsFormat> stats() const {
+        assert(_parsed);
+        return _stats;
+      }
+
       /// Get the parsed logger verbosity, if any.
       std::optional<Util::Logger::Verbosity> logger_verbosity() const {
         assert(_parsed);
@@ -90,26 +169,169 @@ private:
           _output;
 
       std::optional<std::variant<Emit, std::monostate>> _emit;
+      std::optional<Program::IROutputFormat> _ir_format;
       std::optional<std::variant<std::filesystem::path, std::monostate>> _cache;
+      std::optional<std::string> _target_triple;
+      std::optional<std::string> _target_cpu;
+      std::vector<std::string> _target_features;
+      std::optional<unsigned> _opt_level;
+      std::optional<std::filesystem::path> _time_trace;
+      std::optional<std::filesystem::path> _trace_log;
+      std::optional<_StatsFormat> _stats;
+      bool _low_memory = false;
+      bool _no_daemon = false;
       std::optional<Util::Logger::Verbosity> _logger_verbosity;
     };
 
-    Compile() : Command("compile", 'c') {}
+    Compile(ProgramCache *program_cache) :
+        Command("compile", 'c'), _program_cache(program_cache) {}
 
     int exec(
         int argc, const char **argv, const std::string progname) const override;
 
   private:
+    ProgramCache *_program_cache;
+
     void _display_help(Payload::HelpRequest, const std::string progname) const;
   };
 
+  /// The command to compile an Onyx program just-in-time and run it.
+  struct Run : Util::CLI::Command {
+    /// The run command payload, e.g. `run main.nx -- foo bar`.
+    struct Payload {
+      /// Return true upon an issued help request, halting parsing.
+      /// Shall only be parsed once.
+      bool parse(int argc, const char **argv);
+
+      /// Get the parsed input path.
+      std::filesystem::path input() const {
+        assert(_parsed);
+        return _input.value();
+      }
+
+      /// Get the arguments passed to the program, i.e. those after `--`.
+      std::vector<std::string> program_args() const {
+        assert(_parsed);
+        return _program_args;
+      }
+
+      /// Get the parsed logger verbosity, if any.
+      std::optional<Util::Logger::Verbosity> logger_verbosity() const {
+        assert(_parsed);
+        return _logger_verbosity;
+      }
+
+    private:
+      bool _parsed = false;
+      std::optional<std::filesystem::path> _input;
+      std::vector<std::string> _program_args;
+      std::optional<Util::Logger::Verbosity> _logger_verbosity;
+    };
+
+    Run() : Command("run", 'r') {}
+
+    int exec(
+        int argc, const char **argv, const std::string progname) const override;
+
+  private:
+    void _display_help(const std::string progname) const;
+  };
+
+  /// The command to build multiple executables in a single workspace, so
+  /// that the common modules are only compiled once, see `Workspace::build`.
+  struct Build : Util::CLI::Command {
+    Build() : Command("build", 'b') {}
+
+    int exec(
+        int argc, const char **argv, const std::string progname) const override;
+
+  private:
+    void _display_help(const std::string progname) const;
+  };
+
+  /// The command to launch a compiler daemon, see `NXC::Daemon`.
+  struct Daemon : Util::CLI::Command {
+    Daemon() : Command("daemon", 'd') {}
+
+    int exec(
+        int argc, const char **argv, const std::string progname) const override;
+
+  private:
+    void _display_help(const std::string progname) const;
+  };
+
+  /// The command to decode a binary trace log, see `Util::TraceLog`.
+  struct TraceDump : Util::CLI::Command {
+    TraceDump() : Command("trace-dump") {}
+
+    int exec(
+        int argc, const char **argv, const std::string progname) const override;
+
+  private:
+    void _display_help(const std::string progname) const;
+  };
+
+  /// The command to launch a language server over stdio, see `LSP::Server`.
+  struct LanguageServer : Util::CLI::Command {
+    LanguageServer() : Command("lsp") {}
+
+    int exec(
+        int argc, const char **argv, const std::string progname) const override;
+  };
+
   static std::optional<Util::Logger::Verbosity>
   _try_parse_verbosity(const char *arg);
 
+  /// Try parsing a `--time-trace[=<path>]` option, returning the path or an
+  /// empty one for the default.
+  static std::optional<std::filesystem::path>
+  _try_parse_time_trace(const char *arg);
+
+  /// Try parsing a `--trace-log[=<path>]` option, returning the path or an
+  /// empty one for the default.
+  static std::optional<std::filesystem::path>
+  _try_parse_trace_log(const char *arg);
+
+  /// Try parsing a `--stats[=text|json]` option.
+  static std::optional<_StatsFormat> _try_parse_stats(const char *arg);
+
+  /// Start recording the time trace; once destroyed, write it to *path* (if
+  /// any) and the statistics. With *stats*, the performance counters and the
+  /// allocations are recorded as well, and the JSON statistics are written to
+  /// *stats_path*. Otherwise, the summary table is printed.
+  struct _TimeTraceOutput {
+    const std::optional<std::filesystem::path> path;
+    const std::optional<_StatsFormat> stats;
+    const std::filesystem::path stats_path;
+
+    /// The programs whose modules' memory is reported in the statistics.
+    std::vector<std::shared_ptr<Program>> programs;
+
+    _TimeTraceOutput(
+        std::optional<std::filesystem::path> path,
+        std::optional<_StatsFormat> stats,
+        std::filesystem::path stats_path = {});
+
+    ~_TimeTraceOutput();
+  };
+
+  /// Record the binary trace log into *path* until destroyed.
+  struct _TraceLogOutput {
+    _TraceLogOutput(const std::filesystem::path &path);
+    ~_TraceLogOutput();
+  };
+
   static void
   _display_help(const std::string progname, const std::string version);
 
-  static void _print(Panic panic) {
+  static void _print(const Panic &panic) {
+    if (auto panics = dynamic_cast<const Panics *>(&panic)) {
+      for (auto &each : panics->panics)
+        _print(each);
+
+      return;
+    }
+
     auto &out = Util::logger.error();
     out << "Panic! " << panic.what();
 
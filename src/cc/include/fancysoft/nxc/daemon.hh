@@ -0,0 +1,86 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./program.hh"
+#include "./workspace.hh"
+
+namespace Fancysoft {
+namespace NXC {
+
+/// Keeps programs warm between compilations, so that a repeated compilation
+/// only redoes the work invalidated by source modifications.
+struct ProgramCache {
+  /// Return the cached program for *ctx* and *workspace* if any, `refresh()`ed;
+  /// otherwise create and cache a new one. In the low-memory mode, a program
+  /// is cached per the last compilation *stage* requested, e.g. `"llir"`, as
+  /// the IRs released by a later stage could not be emitted by an earlier one.
+  std::shared_ptr<Program> get(
+      Program::CompilationContext ctx,
+      std::shared_ptr<Workspace> workspace,
+      std::string_view stage);
+
+  /// Remove *program* from the cache, e.g. upon a failed compilation.
+  void erase(const std::shared_ptr<Program> &program);
+
+  /// Return the distinct workspaces of the cached programs.
+  std::vector<std::shared_ptr<Workspace>> workspaces() const;
+
+private:
+  std::map<std::string, std::shared_ptr<Program>> _programs;
+};
+
+/// A long-lived compiler process, which listens on a Unix domain socket and
+/// executes CLI requests with a warm `ProgramCache`. A request is executed
+/// within the client's working directory, with the standard output and error
+/// streams (thus the diagnostics) streamed back to the client.
+///
+/// The protocol is a sequence of frames, each consisting of a type byte,
+/// a native-endian 32-bit payload size and the payload. A client sends a `V`
+/// frame containing its build version, which the daemon replies to with its
+/// own; unless they are equal, the client closes the connection. Then the
+/// client sends a single `R` frame containing its NUL-terminated working
+/// directory and the arguments. The daemon replies with `O` (stdout) and `E`
+/// (stderr) frames, and finishes with an `X` frame containing a 32-bit exit
+/// code. A frame larger than 16 MiB is rejected as malformed.
+///
+/// The socket is only accessible to the user running the daemon, and a
+/// client only forwards to a daemon run by the same user.
+struct Daemon {
+  /// Return the default socket path, which is `$FNXC_DAEMON_SOCKET` if set, or
+  /// `fnxc.sock` in `$XDG_RUNTIME_DIR`, or a per-user path in `/tmp`.
+  static std::filesystem::path default_socket_path();
+
+  /// Try forwarding the CLI *args* (the command and its options) to a daemon
+  /// listening at *socket_path*. Return the exit code, or nothing if there is
+  /// no daemon to connect to, or it is of another build or user.
+  static std::optional<int>
+  forward(std::filesystem::path socket_path, std::vector<std::string> args);
+
+  const std::filesystem::path socket_path;
+
+  Daemon(std::filesystem::path socket_path) : socket_path(socket_path) {}
+
+  /// Listen to the socket and serve requests one by one, never returning.
+  /// Throws if the socket can not be listened to.
+  [[noreturn]] void listen();
+
+private:
+  ProgramCache _programs;
+
+  /// Serve a single request from the connected *client* socket.
+  void _serve(int client);
+
+  /// Log the counters of the cached workspaces' pools, so that a contended
+  /// pool is noticed in a long-running daemon.
+  void _report_pools();
+};
+
+} // namespace NXC
+} // namespace Fancysoft
@@ -3,6 +3,7 @@
 #include <optional>
 #include <ostream>
 #include <stdexcept>
+#include <vector>
 
 #include "./placement.hh"
 
@@ -38,6 +39,15 @@ struct Panic : std::runtime_error {
       runtime_error(message), placement(placement), notes(notes) {}
 };
 
+/// Thrown for a unit which has been parsed despite panics, so that they are
+/// all reported at once. Caught as a `Panic`, it is the first one of them.
+struct Panics : Panic {
+  /// The panics in the order of occurrence, including the first one.
+  const std::vector<Panic> panics;
+
+  Panics(std::vector<Panic> all) : Panic(all.at(0)), panics(std::move(all)) {}
+};
+
 struct LinkerFailure : std::runtime_error {
   using std::runtime_error::runtime_error;
 };
@@ -62,7 +72,12 @@ struct Unimplemented : std::runtime_error {
       const std::string message = "Unimplemented",
       const char *file = __builtin_FILE(),
       int line = __builtin_LINE(),
+#if defined(__clang__)
       int column = __builtin_COLUMN()) :
+#else
+      // GNU CC does not provide the column.
+      int column = 0) :
+#endif
       runtime_error(message), location(file, line, column) {}
 };
 
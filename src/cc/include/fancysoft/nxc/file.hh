@@ -2,8 +2,12 @@
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
 #include <stdexcept>
 
+#include "../util/utf8.hh"
 #include "./unit.hh"
 
 namespace Fancysoft {
@@ -21,21 +25,68 @@ struct File : Unit {
 
   const std::filesystem::path path;
 
+  /// Read the file at *path* into memory at once, validating its encoding.
   File(std::filesystem::path path) : path(path) {
-    _file_stream = std::ifstream(path);
+    auto file_stream = std::make_unique<std::ifstream>(path);
 
-    if (_file_stream.bad()) {
+    if (file_stream->bad()) {
       throw OpenError(path);
     }
+
+    // A missing file is reported upon parsing.
+    if (!file_stream->is_open()) {
+      _source_stream = std::move(file_stream);
+      return;
+    }
+
+    std::string source;
+    file_stream->seekg(0, std::ios::end);
+    source.resize(file_stream->tellg());
+    file_stream->seekg(0);
+    file_stream->read(source.data(), source.size());
+    source.resize(file_stream->gcount());
+
+    _load(std::move(source));
   }
 
-  ~File() { _file_stream.close(); }
+  /// Create a file with in-memory *source* instead of reading it from the
+  /// disk, e.g. an unsaved editor buffer.
+  File(std::filesystem::path path, std::string source) : path(path) {
+    _load(std::move(source));
+  }
 
   virtual Position parse() override = 0;
-  std::istream &source_stream() override { return *&_file_stream; }
+  std::istream &source_stream() override { return *_source_stream; }
 
 protected:
-  std::ifstream _file_stream;
+  std::unique_ptr<std::istream> _source_stream;
+
+  /// The position of the first ill-formed UTF-8 sequence in the source,
+  /// if any. A parser shall panic there instead of lexing the file.
+  std::optional<Position> _encoding_error;
+
+private:
+  /// Validate the *source* once, so that lexers may decode it unchecked.
+  void _load(std::string source) {
+    auto valid = Util::UTF8::validate(source);
+
+    if (valid < source.size()) {
+      Position position;
+
+      for (size_t i = 0; i < valid; i++) {
+        if (source[i] == '\n') {
+          position.row++;
+          position.col = 0;
+        } else if ((source[i] & 0xc0) != 0x80) {
+          position.col++; // Code points, not continuation bytes
+        }
+      }
+
+      _encoding_error = position;
+    }
+
+    _source_stream = std::make_unique<std::istringstream>(std::move(source));
+  }
 };
 
 } // namespace NXC
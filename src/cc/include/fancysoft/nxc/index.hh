@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cinttypes>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "./position.hh"
+
+namespace Fancysoft {
+namespace NXC {
+
+/// A persistent workspace-wide symbol index stored in a directory.
+///
+/// Each source file has its own shard, which is only rewritten if the file
+/// content hash changes. Upon `commit()`, modified shards are merged into
+/// a single file of entries sorted by name, which is then memory-mapped, so
+/// that a lookup is a binary search rather than a parse of the sources. The
+/// shards of the source files deleted meanwhile are removed upon commit.
+struct Index {
+  enum class Kind : uint8_t {
+    VarDecl,   ///< A variable declaration.
+    VarRef,    ///< A reference to a variable.
+    CFuncDecl, ///< A C function prototype, e.g. from an `extern` block.
+    CFuncRef,  ///< A C function call.
+  };
+
+  struct Entry {
+    Kind kind;
+
+    /// The symbol name, e.g. `"puts"`.
+    std::string name;
+
+    /// The entry location.
+    std::filesystem::path path;
+    Position position;
+
+    /// The referenced declaration location; equals to the entry location
+    /// for a declaration itself.
+    std::filesystem::path decl_path;
+    Position decl_position;
+
+    /// The declaration in the MLIR syntax.
+    std::string description;
+
+    bool is_declaration() const {
+      return kind == Kind::VarDecl || kind == Kind::CFuncDecl;
+    }
+  };
+
+  /// Return the hash of the file contents at *path*, if readable.
+  static std::optional<uint64_t> hash_file(const std::filesystem::path &);
+
+  const std::filesystem::path dir;
+
+  Index(std::filesystem::path dir);
+
+  /// Check if the shard of the *source* file is up to date with its *hash*.
+  bool fresh(const std::filesystem::path &source, uint64_t hash);
+
+  /// Replace the shard of the *source* file having *hash* with *entries*.
+  void update(
+      const std::filesystem::path &source,
+      uint64_t hash,
+      const std::vector<Entry> &entries);
+
+  /// Remove the shard of the *source* file, e.g. upon its deletion.
+  void remove(const std::filesystem::path &source);
+
+  /// Remove the shards of the deleted source files, and merge the shards
+  /// into the lookup file if any has changed since the last commit (possibly
+  /// by another process).
+  void commit();
+
+  /// Return all the committed entries named *name*.
+  std::vector<Entry> lookup(std::string_view name);
+
+private:
+  std::mutex _mutex;
+
+  /// The memory-mapped merged file, if loaded.
+  std::unique_ptr<llvm::MemoryBuffer> _merged;
+
+  std::filesystem::path _shard_path(const std::filesystem::path &source) const;
+  std::filesystem::path _merged_path() const;
+
+  /// Load (i.e. map) the merged file if not yet.
+  void _load();
+};
+
+} // namespace NXC
+} // namespace Fancysoft
@@ -6,6 +6,7 @@
 #include <memory>
 #include <optional>
 #include <set>
+#include <sstream>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -13,6 +14,8 @@
 #include "../util/coro.hh"
 #include "../util/logger.hh"
 #include "../util/radix.hh"
+#include "../util/trace_log.hh"
+#include "../util/utf8.hh"
 
 #include "./exception.hh"
 #include "./unit.hh"
@@ -42,10 +45,15 @@ template <typename Token> struct Lexer {
     return _cursor;
   }
 
-  /// Check if the lexer has thrown an exception.
-  inline std::optional<std::exception> exception() { return _exception; }
+  /// Return the exception the lexer has thrown, if any. It is kept as is,
+  /// e.g. a `Panic` with its placement.
+  inline std::exception_ptr exception() const { return _exception; }
 
-  void _unread() { unit->source_stream().unget(); }
+  /// Unread the latest code point, see `_advance()`.
+  void _unread() {
+    for (size_t i = 0; i < _code_units_size; i++)
+      unit->source_stream().unget();
+  }
 
 private:
   inline void _debug_codepoint(std::ostream &stream) const {
@@ -53,20 +61,42 @@ private:
     case '\n':
       stream << "\\n";
       break;
-    case EOF:
+    case (char32_t)EOF:
       stream << "EOF";
       break;
     default:
-      stream << _code_point;
+      stream.write(_code_units, _code_units_size);
     }
   }
 
+  /// The interned `_debug_name()`, see `Util::TraceLog`.
+  Util::TraceLog::Id _trace_context = 0;
+
+  void _trace_read() {
+    static const auto name = Util::trace_log.intern("read");
+
+    if (!_trace_context)
+      _trace_context = Util::trace_log.intern(_debug_name());
+
+    // ASCII is recorded as a character, otherwise as the code point value.
+    if (_code_point < 0x80 || _code_point == (char32_t)EOF)
+      Util::trace_log.record(
+          _trace_context, name, (char)_code_point, _cursor.row, _cursor.col);
+    else
+      Util::trace_log.record(
+          _trace_context,
+          name,
+          (uint32_t)_code_point,
+          _cursor.row,
+          _cursor.col);
+  }
+
 protected:
   /// This lexer's name for debugging.
   virtual const char *_debug_name() const = 0;
 
   /// The lexer's exception thrown, if any.
-  std::optional<std::exception> _exception;
+  std::exception_ptr _exception;
 
   /// The latest yielded cursor position.
   Position _latest_yieled_cursor;
@@ -75,8 +105,12 @@ protected:
   Position _cursor;
 
   /// The latest read code point.
-  /// TODO: Move to `char32_t`.
-  char _code_point;
+  char32_t _code_point;
+
+  /// The UTF-8 code units of `_code_point`, so that a token is built
+  /// without re-encoding it.
+  char _code_units[4];
+  size_t _code_units_size = 0;
 
   inline Placement _placement() const {
     return Placement(unit, Location(_latest_yieled_cursor, _cursor));
@@ -95,16 +129,38 @@ protected:
   }
 
   /// Read the next codepoint, returning the previous one.
-  char _advance() {
-    char old = _code_point;
+  ///
+  /// The source is expected to be valid UTF-8 (see `File`), thus a
+  /// multi-byte sequence is decoded unchecked.
+  char32_t _advance() {
+    char32_t old = _code_point;
+    auto &stream = unit->source_stream();
+
+    if (stream.good()) {
+      auto lead = stream.get();
+      _code_units[0] = lead;
+
+      if (lead < 0x80) { // Also EOF
+        _code_point = lead;
+        _code_units_size = 1;
+      } else {
+        _code_units_size = Util::UTF8::sequence_size(lead);
+        stream.read(_code_units + 1, _code_units_size - 1);
+
+        _code_point = Util::UTF8::decode_sequence(
+            (const char8_t *)_code_units, _code_units_size);
+      }
 
-    if (unit->source_stream().good()) {
-      _code_point = unit->source_stream().get();
+      // Called per codepoint, thus shall not format anything unless logged.
+      if (FNXC_LOG_ENABLED(Trace)) {
+        auto &log = Util::logger.trace(_debug_name());
+        log << "Read `";
+        _debug_codepoint(log);
+        fmt::print(log, "` at {}:{}\n", _cursor.row, _cursor.col);
+      }
 
-      auto &log = Util::logger.trace(_debug_name());
-      log << "Read `";
-      _debug_codepoint(log);
-      fmt::print(log, "` at {}:{}\n", _cursor.row, _cursor.col);
+      if (Util::trace_log.enabled())
+        _trace_read();
 
       if (_is_newline()) {
         _cursor.row += 1;
@@ -127,22 +183,34 @@ protected:
     return Panic("Expected " + expected, _placement());
   }
 
+  /// Append the latest code point to *buf* as UTF-8.
+  inline void _append_code_point(std::stringbuf &buf) const {
+    buf.sputn(_code_units, _code_units_size);
+  }
+
   Panic _unexpected(std::set<char> expected) {
     return Panic(
         fmt::format("Expected {}", fmt::join(expected, ", ")), _placement());
   }
 
   /// Does the latest codepoint equal to *cmp*?
-  inline bool _is(char cmp) const { return _code_point == cmp; }
+  inline bool _is(char cmp) const { return _code_point == (char32_t)cmp; }
 
   /// Does the latest codepoint equal to *cmp*?
   inline bool _is(std::set<char> cmp) const {
-    return cmp.contains(_code_point);
+    return _code_point < 0x80 && cmp.contains(_code_point);
   }
 
   /// Has the stream ended?
   inline bool _is_eof() const {
-    return _code_point == EOF || unit->source_stream().eof();
+    return _code_point == (char32_t)EOF || unit->source_stream().eof();
+  }
+
+  /// Match any non-ASCII code point.
+  ///
+  /// @todo Match Unicode categories, e.g. XID_Start and XID_Continue.
+  inline bool _is_non_ascii() const {
+    return _code_point >= 0x80 && _code_point <= 0x10ffff;
   }
 
   /// Match a line breaking (End-Of-Line, EOL) character.
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "../util/pool.hh"
+#include "./target.hh"
+
+namespace Fancysoft {
+namespace NXC {
+
+/// The LLVM state of a target. Shared by the programs of a workspace which
+/// have the same target, see `Workspace::llvm_target()`.
+struct LLVMTarget {
+  std::string target_triple;
+
+  /// The machine to query the target properties from, e.g. the data layout.
+  /// A target machine is not thread-safe, thus objects shall be emitted with
+  /// a machine of `target_machines` instead.
+  llvm::TargetMachine *target_machine;
+
+  /// The machines to optimize and emit with, one per thread at a time, so
+  /// that a machine is not created per module.
+  Util::Pool<llvm::TargetMachine> target_machines;
+
+  LLVMTarget(const Target &);
+
+  /// Create a new target machine, e.g. to emit an object with.
+  std::unique_ptr<llvm::TargetMachine> create_target_machine() const;
+
+private:
+  const llvm::Target *_llvm_target;
+  llvm::TargetOptions _options;
+  std::string _cpu;
+  std::string _features;
+};
+
+} // namespace NXC
+} // namespace Fancysoft
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/JSON.h"
+
+#include "./mlir.hh"
+#include "./program.hh"
+
+namespace Fancysoft {
+namespace NXC {
+namespace LSP {
+
+/// A Language Server Protocol server communicating via a pair of streams,
+/// usually stdio. Every open document is the entry of its own `Program`;
+/// upon an edit, only the edited module is reparsed and recompiled, and
+/// hover and definition requests are answered from the cached MLIR.
+/// References from unopened files are looked up in the workspace index.
+///
+/// Messages are read by a separate thread, so that a stale edit (i.e. one
+/// followed by a newer edit to the same document) is skipped, and a request
+/// issued before a newer edit is answered with `ContentModified`. Explicit
+/// `$/cancelRequest` notifications are honored as well.
+///
+/// A custom `fnxc/stats` request returns the edit-to-diagnostics latency
+/// percentiles in milliseconds.
+struct Server {
+  /// The *input* shall outlive the server, e.g. be the standard input, as the
+  /// reader thread may still be blocked reading it, see `run()`.
+  Server(std::istream &input, std::ostream &output);
+
+  /// Serve until the `exit` notification or the end of input. Return the
+  /// exit code as per the specification.
+  int run();
+
+private:
+  using _Clock = std::chrono::steady_clock;
+
+  struct _Message {
+    llvm::json::Object body;
+    _Clock::time_point received_at;
+  };
+
+  struct _Document {
+    std::filesystem::path path;
+    int64_t version;
+    std::shared_ptr<Program> program;
+
+    /// The text lines, to convert the code point columns to UTF-16 ones.
+    std::vector<std::string> lines;
+  };
+
+  /// The state shared with the reader thread, which may outlive the server
+  /// while blocked reading the input, see `run()`.
+  struct _Inbox {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<_Message> queue;
+    std::set<std::string> cancelled_ids;
+    bool eof = false;
+  };
+
+  std::istream &_input;
+  std::ostream &_output;
+
+  const std::shared_ptr<_Inbox> _inbox = std::make_shared<_Inbox>();
+
+  /// The workspace shared by all the documents.
+  std::shared_ptr<Workspace> _workspace;
+
+  std::map<std::string, _Document> _documents;
+  bool _shutdown = false;
+
+  /// The latest edit latencies in milliseconds, bounded in size.
+  std::deque<double> _latencies;
+  uint64_t _edits_count = 0;
+  uint64_t _skipped_edits_count = 0;
+
+  /// Read messages from *input* into the *inbox* until the end of input.
+  static void _read_loop(std::istream &input, std::shared_ptr<_Inbox> inbox);
+
+  /// Read a single message. Return nothing upon the end of input, or a
+  /// malformed header.
+  static std::optional<std::string> _read_message(std::istream &input);
+
+  void _write_message(const llvm::json::Value &);
+  void _respond(const llvm::json::Value &id, llvm::json::Value result);
+  void _respond_error(const llvm::json::Value &id, int code, std::string);
+  void _notify(std::string method, llvm::json::Value params);
+
+  /// Check if there is a newer queued edit of the document at *uri*.
+  /// Shall be called with the lock held.
+  bool _has_queued_edit(const std::string &uri) const;
+
+  /// Handle a message. Return false upon the `exit` notification.
+  bool _handle(_Message &);
+
+  /// Set the document *text*, reanalyze it and publish the diagnostics.
+  void _update(std::string uri, int64_t version, std::string text);
+
+  llvm::json::Value _hover(const llvm::json::Object &params);
+  llvm::json::Value _definition(const llvm::json::Object &params);
+  llvm::json::Value _references(const llvm::json::Object &params);
+  llvm::json::Value _stats() const;
+
+  /// Return the text lines of the file at *path*, of an open document or
+  /// read from the disk, memoized in the *cache*.
+  const std::vector<std::string> &_lines(
+      const std::filesystem::path &path,
+      std::map<std::filesystem::path, std::vector<std::string>> &cache) const;
+
+  /// Record the latency of an edit received at *received_at*.
+  void _record_latency(_Clock::time_point received_at);
+
+  /// Find the MLIR reference at the position of the request *params*.
+  std::optional<MLIR::Reference>
+  _find_reference(const llvm::json::Object &params);
+};
+
+} // namespace LSP
+} // namespace NXC
+} // namespace Fancysoft
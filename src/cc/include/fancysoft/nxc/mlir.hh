@@ -25,8 +25,37 @@ namespace NXC {
 /// The Middle-Level Intermediate Representation.
 /// Represents both C and Onyx code. It is then lowered to LLIR.
 struct MLIR {
+  /// A reference from a use site to a declaration, recorded upon compilation
+  /// to aid tooling, e.g. the LSP. A declaration references itself.
+  struct Reference {
+    enum class Kind {
+      Variable,
+      CFunction,
+    };
+
+    Kind kind;
+
+    /// True if this is the declaration referencing itself.
+    bool is_declaration;
+
+    /// The use site, e.g. a variable identifier.
+    Placement use;
+
+    /// The referenced declaration site.
+    Placement declaration;
+
+    /// The referenced identifier.
+    std::string id;
+
+    /// The declaration in the MLIR syntax, e.g. `local char* %x`.
+    std::string description;
+  };
+
   MLIR(const Onyx::AST *, Program *);
 
+  /// Return the references in the order of compilation.
+  const std::vector<Reference> &references() const;
+
   /// Output the MLIR.
   void write(std::ostream &) const;
 
@@ -128,6 +157,9 @@ private:
 
     void write(std::ostream &, unsigned indent = 0) const;
     llvm::Function *lower(llvm::Module *) const;
+
+    /// Return the declaration written on a single line.
+    std::string describe() const;
   };
 
   /// A C call.
@@ -197,6 +229,9 @@ private:
     template <typename Scope>
     llvm::Value *lower(llvm::Module *, llvm::IRBuilder<> *);
 
+    /// Return the declaration written on a single line, without the value.
+    std::string describe() const;
+
   private:
     llvm::Value *_llvm_ref = nullptr;
     llvm::Value *_lower_to_local(llvm::Module *, llvm::IRBuilder<> *);
@@ -255,6 +290,9 @@ private:
     /// Add an expression to the scope. Implicitly updates `_var_decl_index`.
     void _add_expr(_Expr);
 
+    /// Record a reference in the top-level scope.
+    void _add_reference(Reference);
+
     /// Add a child scope.
     template <typename T>
     std::shared_ptr<T> _create_child(Safety safety, Storage storage) {
@@ -268,6 +306,9 @@ private:
   struct _TopLevelScope : _Scope {
     _TopLevelScope() : _Scope(Safety::Fragile, Storage::Static, nullptr) {}
 
+    /// All the references within the tree, see `_add_reference()`.
+    std::vector<Reference> references;
+
     void write(std::ostream &) const;
     void lower(llvm::Module *) const;
   };
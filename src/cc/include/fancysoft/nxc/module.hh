@@ -1,11 +1,24 @@
 #pragma once
 
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <vector>
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include "../util/memory_account.hh"
+#include "../util/time_trace.hh"
 #include "./mlir.hh"
 
 namespace Fancysoft {
@@ -15,38 +28,160 @@ struct Program;
 
 /// A module to be compiled into MLIR.
 struct Module {
+  /// *program* is null for a module shared by the programs of a workspace.
   Module(Program *program) : _program(program) {}
 
+  /// Guards the compilation stages of a module shared by the programs of
+  /// a workspace, so that each stage is only run once.
+  std::mutex mutex;
+
+  /// The heap memory of the module, i.e. its AST, MLIR and LLIR, as
+  /// allocated and freed by its compilation stages.
+  Util::MemoryAccount memory;
+
+  /// Return the paths of the modules this one depends on, i.e. which shall
+  /// be compiled before. Known once parsed.
+  virtual std::vector<std::filesystem::path> dependencies() const = 0;
+
   /// Compile the module. Shall not be already `compiled()`.
   virtual void compile() = 0;
 
-  /// Check if the module is compiled.
-  bool compiled() const { return !!_mlir; };
+  /// Check if the module is compiled, even if the MLIR is released since.
+  bool compiled() const { return _mlir || _mlir_released; };
 
-  /// Return MLIR pointer if `compiled()`.
+  /// Return MLIR pointer if `compiled()` and not released.
   MLIR *mlir() const { return _mlir.get(); }
 
-  /// Lower the MLIR to LLIR.
-  void lower(std::unique_ptr<llvm::Module> llvm_module) {
+  /// Free the MLIR, e.g. once lowered in the low-memory mode. The module is
+  /// still considered `compiled()`.
+  void release_mlir() {
+    assert(compiled());
+    _mlir.reset();
+    _mlir_released = true;
+  }
+
+  /// Lower the MLIR to an LLVM module named *name*. Each module has an LLVM
+  /// context of its own, so that modules are lowered, optimized and
+  /// assembled in parallel.
+  void lower(
+      llvm::StringRef name,
+      llvm::StringRef triple,
+      const llvm::DataLayout &data_layout) {
     assert(!_llir);
-    this->_llir = move(llvm_module);
+    Util::TimeTrace::Scope scope("Lower", name);
+
+    _llvm_context =
+        llvm::orc::ThreadSafeContext(std::make_unique<llvm::LLVMContext>());
+
+    _llir = std::make_unique<llvm::Module>(name, *_llvm_context.getContext());
+    _llir->setTargetTriple(triple);
+    _llir->setDataLayout(data_layout);
+
     this->_mlir->lower(_llir.get());
   }
 
-  /// Check if the MLIR is lowered to LLIR.
-  bool lowered() const { return !!_llir; }
+  /// Check if the MLIR is lowered to LLIR, even if the LLIR is released since.
+  bool lowered() const { return _llir || _llir_released; }
 
-  /// Return the LLVM module pointer if `lowered()`.
+  /// Return the LLVM module pointer if `lowered()` and not released.
   llvm::Module *llir() const { return _llir.get(); }
 
+  /// Free the LLIR along with its LLVM context, e.g. once assembled in the
+  /// low-memory mode. The module is still considered `lowered()`.
+  void release_llir() {
+    assert(lowered());
+
+    if (_llir) {
+      auto lock = _llvm_context.getLock();
+      _llir.reset();
+    }
+
+    _llvm_context = llvm::orc::ThreadSafeContext();
+    _llir_released = true;
+  }
+
+  /// Return the LLVM context of the module if `lowered()`.
+  llvm::orc::ThreadSafeContext llvm_context() const { return _llvm_context; }
+
+  /// Optimize the LLIR at *level* from 0 to 3. Shall be `lowered()`.
+  void optimize(unsigned level, llvm::TargetMachine *target_machine) {
+    assert(_llir && !optimized());
+    _optimized = true;
+
+    if (!level)
+      return;
+
+    Util::TimeTrace::Scope scope(
+        "Optimize", [this]() { return _llir->getModuleIdentifier(); });
+
+    llvm::PassManagerBuilder builder;
+    builder.OptLevel = level;
+
+    if (level > 1)
+      builder.Inliner = llvm::createFunctionInliningPass(level, 0, false);
+
+    target_machine->adjustPassManager(builder);
+
+    llvm::legacy::FunctionPassManager function_passes(_llir.get());
+    llvm::legacy::PassManager module_passes;
+    builder.populateFunctionPassManager(function_passes);
+    builder.populateModulePassManager(module_passes);
+
+    function_passes.doInitialization();
+
+    for (auto &function : *_llir)
+      function_passes.run(function);
+
+    function_passes.doFinalization();
+    module_passes.run(*_llir);
+  }
+
+  /// Check if the LLIR is optimized.
+  bool optimized() const { return _optimized; }
+
+  /// Emit the LLIR into an in-memory object file. Shall be `lowered()`.
+  void assemble(llvm::TargetMachine *target_machine) {
+    assert(_llir && !assembled());
+    Util::TimeTrace::Scope scope(
+        "Codegen", [this]() { return _llir->getModuleIdentifier(); });
+
+    llvm::raw_svector_ostream stream(_obj);
+    llvm::legacy::PassManager pass;
+
+    if (target_machine->addPassesToEmitFile(
+            pass, stream, nullptr, llvm::CGFT_ObjectFile))
+      throw "The target machine can't emit a file of this type";
+
+    pass.run(*_llir);
+  }
+
+  /// Check if the object file is emitted.
+  bool assembled() const { return !_obj.empty(); }
+
+  /// Return the in-memory object file contents if `assembled()`.
+  llvm::StringRef obj() const {
+    return llvm::StringRef(_obj.data(), _obj.size());
+  }
+
 protected:
   Program *_program;
 
   /// Set after `compile()` is called.
   std::unique_ptr<MLIR> _mlir;
+  bool _mlir_released = false;
+
+  /// Set after `lower()` is called; outlives the LLIR.
+  llvm::orc::ThreadSafeContext _llvm_context;
 
   /// Set after `lower()` is called.
   std::unique_ptr<llvm::Module> _llir;
+  bool _llir_released = false;
+
+  /// Set after `optimize()` is called.
+  bool _optimized = false;
+
+  /// Set after `assemble()` is called.
+  llvm::SmallVector<char, 0> _obj;
 };
 
 } // namespace NXC
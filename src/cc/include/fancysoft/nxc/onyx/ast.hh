@@ -10,6 +10,7 @@
 
 #include "../../util/variant.hh"
 #include "../c/block.hh"
+#include "../exception.hh"
 #include "../node.hh"
 #include "../safety.hh"
 #include "./token.hh"
@@ -21,13 +22,14 @@ namespace Onyx {
 /// An Onyx AST.
 struct AST : NXC::Node {
   struct ExternDirective;
-  // struct ImportDirective;
+  struct ImportDirective;
   // struct ExportDirective;
 
-  using Directive = std::variant<std::shared_ptr<ExternDirective>
-                                 // std::shared_ptr<ImportDirective>,
-                                 // std::shared_ptr<ExportDirective>
-                                 >;
+  using Directive = std::variant<
+      std::shared_ptr<ExternDirective>,
+      std::shared_ptr<ImportDirective>
+      // std::shared_ptr<ExportDirective>
+      >;
 
   struct VarDecl;
   // struct FunctionDecl;
@@ -109,7 +111,22 @@ struct AST : NXC::Node {
   using RVal = Util::Variant::flatten_t<
       std::variant<Literal, std::shared_ptr<Id>, std::shared_ptr<CId>, Expr>>;
 
-  using TopLevelNode = Util::Variant::flatten_t<std::variant<Directive, Expr>>;
+  struct Error;
+
+  using TopLevelNode = Util::Variant::flatten_t<
+      std::variant<Directive, Expr, std::shared_ptr<Error>>>;
+
+  /// A node in place of the code which has failed to parse, recovered from
+  /// by the parser. See `Parser::panics()`.
+  struct Error : NXC::Node {
+    const Panic panic;
+
+    Error(Panic panic) : panic(panic) {}
+
+    const char *node_name() const override { return "<Error>"; }
+    void inspect(std::ostream &, unsigned short indent = 0) const override;
+    std::string trace() const override { return node_name(); }
+  };
 
   /// An `extern` directive node.
   struct ExternDirective : NXC::Node {
@@ -127,6 +144,26 @@ struct AST : NXC::Node {
     std::string trace() const override { return node_name(); }
   };
 
+  /// An `import` directive node, e.g. `import "./foo.nx"`. The imported
+  /// module is compiled before the importing one.
+  struct ImportDirective : NXC::Node {
+    /// The `import` keyword token.
+    const Token::Keyword keyword;
+
+    /// The imported file path, relative to the importing file directory.
+    const Token::StringLiteral path;
+
+    ImportDirective(Token::Keyword keyword, Token::StringLiteral path) :
+        keyword(keyword), path(path) {}
+
+    const char *node_name() const override { return "<ImportDirective>"; }
+    void inspect(std::ostream &, unsigned short indent = 0) const override;
+
+    std::string trace() const override {
+      return "<ImportDirective \"" + path.string + "\">";
+    }
+  };
+
   // struct Block {
   //   std::vector<Expr> exprs;
   //   // TODO: Block style: brackets, inline-brackets, indented...
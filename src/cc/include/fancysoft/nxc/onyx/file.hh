@@ -14,16 +14,37 @@ struct File : NXC::File, Module, std::enable_shared_from_this<File> {
   File(std::filesystem::path path, Program *program) :
       NXC::File(path), Module(program) {}
 
+  /// Create a file with in-memory *source*, see `NXC::File`.
+  File(std::filesystem::path path, std::string source, Program *program) :
+      NXC::File(path, std::move(source)), Module(program) {}
+
   /// Parse the file.
   Position parse() override;
 
   /// Compile the file. Would parse implicitly if not parsed yet.
   void compile() override;
 
+  /// Return the paths of the imported files, see `resolve_import()`. Known
+  /// once parsed, and kept after the AST is released.
+  std::vector<std::filesystem::path> dependencies() const override {
+    return _dependencies;
+  }
+
+  /// Return the path of the file imported as *import*, i.e. relative to the
+  /// directory of this file.
+  std::filesystem::path resolve_import(const std::string &import) const {
+    return (path.parent_path() / import).lexically_normal();
+  }
+
+  /// Return the AST if parsed and not released.
   const AST *ast() { return _ast.get(); }
 
+  /// Free the AST, e.g. once compiled in the low-memory mode.
+  void release_ast() { _ast.reset(); }
+
 private:
   std::unique_ptr<const AST> _ast;
+  std::vector<std::filesystem::path> _dependencies;
 };
 
 } // namespace Onyx
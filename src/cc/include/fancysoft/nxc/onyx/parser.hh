@@ -16,12 +16,22 @@ namespace Onyx {
 
 struct Parser : NXC::Parser<Lexer, Token::Any> {
   using NXC::Parser<Lexer, Token::Any>::Parser;
+
+  /// Parse the unit. A top-level construct which fails to parse is replaced
+  /// with an `AST::Error` node, and its panic is recorded, see `panics()`.
   std::unique_ptr<AST> parse();
 
 protected:
   inline const char *_debug_name() const override { return "Parser"; }
 
 private:
+  /// Parse a top-level construct into *ast*, throwing a panic on failure.
+  void _parse_top_level(AST &ast);
+
+  /// Skip the tokens up to the next newline (consumed) or top-level keyword,
+  /// where the parsing may resume after a panic.
+  void _synchronize();
+
   AST::RVal _parse_rval();
   AST::Expr _parse_expr();
 
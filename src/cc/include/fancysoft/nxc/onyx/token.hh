@@ -20,6 +20,7 @@ struct Keyword : Base {
 
   enum Kind {
     Extern,
+    Import,
     Let,
     Final,
     UnsafeBang,
@@ -31,6 +32,8 @@ struct Keyword : Base {
     switch (kind) {
     case Extern:
       return "extern";
+    case Import:
+      return "import";
     case Let:
       return "let";
     case Final:
@@ -47,6 +50,8 @@ struct Keyword : Base {
   static std::optional<Kind> parse_kind(std::string string) {
     if (!string.compare("extern"))
       return Extern;
+    else if (!string.compare("import"))
+      return Import;
     else if (!string.compare("let"))
       return Let;
     else if (!string.compare("final"))
@@ -4,11 +4,13 @@
 #include <memory>
 #include <optional>
 #include <variant>
+#include <vector>
 
 #include <fmt/core.h>
 
 #include "../util/coro.hh"
 #include "../util/logger.hh"
+#include "../util/trace_log.hh"
 #include "../util/variant.hh"
 
 #include "./exception.hh"
@@ -26,13 +28,32 @@ template <typename LexerT, typename TokenT> struct Parser {
 
   Parser(std::shared_ptr<LexerT> lexer) : _lexer(lexer) {}
 
+  /// Return the panics recovered from while parsing, in the order of
+  /// occurrence. The parsed AST is incomplete unless it is empty.
+  const std::vector<Panic> &panics() const { return _panics; }
+
 private:
+  /// The panics recorded by `_recover()`.
+  std::vector<Panic> _panics;
+
+  void _record(Panic panic) {
+    FNXC_DEBUG(_debug_name()) << "Recovering from " << panic.what() << "\n";
+    _panics.push_back(std::move(panic));
+  }
+
+  /// Set once the lexer's panic is recorded, so that it is not recorded
+  /// twice. It may have been rethrown by `_advance()` before.
+  bool _lexer_panic_recorded = false;
+
   /// The lexing coroutine yielding a token.
-  std::unique_ptr<Util::Coro::Generator<TokenT>> _token_coro;
+  std::optional<Util::Coro::Generator<TokenT>> _token_coro;
 
   /// A container for the latest token (not set until first advanced).
   std::optional<TokenT> _token_container;
 
+  /// The interned `_debug_name()`, see `Util::TraceLog`.
+  Util::TraceLog::Id _trace_context = 0;
+
   void _debug_token(std::ostream &output) const {
     std::visit(
         [&output](auto &&token) {
@@ -50,7 +71,17 @@ protected:
   virtual const char *_debug_name() const = 0;
 
   void _debug_parsed(std::string node_name) {
-    fmt::print(Util::logger.debug(_debug_name()), "Parsed {}\n", node_name);
+    if (FNXC_LOG_ENABLED(Debug))
+      fmt::print(Util::logger.debug(_debug_name()), "Parsed {}\n", node_name);
+
+    if (Util::trace_log.enabled()) {
+      static const auto name = Util::trace_log.intern("parsed");
+
+      if (!_trace_context)
+        _trace_context = Util::trace_log.intern(_debug_name());
+
+      Util::trace_log.record(_trace_context, name, node_name);
+    }
   }
 
   /// Must be called before `_advance()`.
@@ -59,18 +90,21 @@ protected:
     if (_token_coro)
       throw "The token coroutine has already been created";
 
-    _token_coro =
-        std::make_unique<Util::Coro::Generator<TokenT>>(_lexer->lex());
+    _token_coro.emplace(_lexer->lex());
+    _token_coro->resume();
+
+    // The yielded token is moved, as it is not referenced by the lexer.
+    if (!_token_coro->done())
+      _token_container = std::move(_token_coro->current());
 
-    _token_coro.get()->begin();
-    _token_container = _token_coro.get()->current();
-    _debug_token(Util::logger.debug(_debug_name()));
+    if (FNXC_LOG_ENABLED(Debug))
+      _debug_token(Util::logger.debug(_debug_name()));
   }
 
   /// Check if lexer has done yielding tokens.
   bool _lexer_done() const {
     if (_token_coro)
-      return _token_coro.get()->done();
+      return _token_coro->done();
     else
       throw "The token coroutine hasn't been created yet";
   }
@@ -79,21 +113,56 @@ protected:
   /// `_initialize()` must be called beforeahead.
   TokenT _advance() {
     if (_lexer_done()) {
-      if (_lexer->exception()) {
-        throw _lexer->exception().value();
-      } else {
+      if (_lexer->exception())
+        std::rethrow_exception(_lexer->exception());
+      else
         throw "Lexer is already done, can not advance";
-      }
     }
 
-    auto old = _token();
+    auto old = std::move(_token_container.value());
+    _token_coro->resume();
+
+    // Otherwise the last token is kept.
+    if (!_token_coro->done())
+      _token_container = std::move(_token_coro->current());
+    else
+      _token_container = old;
 
-    _token_container = _token_coro.get()->next();
-    _debug_token(Util::logger.debug(_debug_name()));
+    if (FNXC_LOG_ENABLED(Debug))
+      _debug_token(Util::logger.debug(_debug_name()));
 
     return old;
   }
 
+  /// Record the *panic* instead of throwing it, so that the parsing goes on
+  /// once the caller synchronizes at the next construct it may parse.
+  void _recover(Panic panic) {
+    // Once the lexer has failed, the tokens are truncated, so that the panic
+    // is a consequence of the lexer's one, which is recorded instead.
+    if (_lexer_done() && _lexer->exception()) {
+      _recover_lexer();
+      return;
+    }
+
+    _record(std::move(panic));
+  }
+
+  /// Record the lexer's panic, if it has thrown one which has not been
+  /// recovered from yet. To be called once done parsing, as the lexer stops
+  /// at its first error.
+  void _recover_lexer() {
+    if (!_lexer->exception() || _lexer_panic_recorded)
+      return;
+
+    _lexer_panic_recorded = true;
+
+    try {
+      std::rethrow_exception(_lexer->exception());
+    } catch (Panic &panic) {
+      _record(panic);
+    }
+  }
+
   /// Force get the stored token pointer from the `_token_container`,
   /// throw otherwise.
   const TokenT &_token() const {
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <filesystem>
+#include <memory>
+#include <optional>
 #include <ostream>
+#include <utility>
 #include <vector>
 
 #include "./location.hh"
@@ -23,6 +27,10 @@ struct Placement {
 
   /// Output the full placement, so that a end-user can be pointed precisely.
   void debug(std::ostream &stream) const;
+
+  /// Resolve the placement to a source file path and an absolute position
+  /// within it, i.e. taking the containing C blocks into account.
+  std::optional<std::pair<std::filesystem::path, Position>> resolve() const;
 };
 
 } // namespace NXC
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <compare>
 #include <stdint.h>
 
 namespace Fancysoft {
@@ -11,6 +12,8 @@ struct Position {
 
   Position(uint32_t row = 0, uint32_t col = 0) : row(row), col(col) {}
 
+  auto operator<=>(const Position &) const = default;
+
   inline Position operator+(Position another) {
     if (another.row == 0) {
       return Position(row, col + another.col);
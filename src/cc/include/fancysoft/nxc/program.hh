@@ -1,17 +1,23 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <variant>
 #include <vector>
 
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Target/TargetMachine.h"
 
+#include "./llvm_target.hh"
 #include "./target.hh"
 #include "./workspace.hh"
 
@@ -29,7 +35,7 @@ struct Program {
   /// The Intermediate Representation (i.e. non-executable) output format.
   enum class IROutputFormat {
     Raw, ///< Raw, files separated with `0x1C`.
-    // Tar, ///< A tarball archive.
+    Tar, ///< A tarball archive, a member per module.
   };
 
   struct CompilationContext {
@@ -53,6 +59,16 @@ struct Program {
 
     /// The list of Onyx macro require paths.
     std::vector<std::filesystem::path> onyx_macro_require_paths;
+
+    /// The LLIR optimization level, from 0 to 3.
+    unsigned opt_level = 0;
+
+    /// Release each module's AST once compiled to MLIR, the MLIR once
+    /// lowered (unless only the MLIR is requested), and the LLIR once
+    /// assembled, so that the peak memory depends on the amount of modules
+    /// in flight rather than the program size. A released IR can not be
+    /// emitted afterwards, which thus throws.
+    bool low_memory = false;
   };
 
   const std::shared_ptr<Workspace> workspace;
@@ -60,6 +76,24 @@ struct Program {
   /// Create a program. It is not compiled just yet.
   Program(CompilationContext, std::shared_ptr<Workspace>);
 
+  /// Would wait for pending object cache writes.
+  ~Program();
+
+  /// Check the source files for modifications since they've been read. Upon
+  /// any, drop all the modules so that they're recompiled, keeping the LLVM
+  /// target state warm. Return true if the program has been reset.
+  bool refresh();
+
+  /// Override the source of the module at *path* with an in-memory *source*,
+  /// e.g. an unsaved editor buffer. Only that module is then recompiled.
+  void set_source(std::filesystem::path path, std::string source);
+
+  /// Return the module at *path*, if any.
+  std::shared_ptr<Onyx::File> module(std::filesystem::path path) const;
+
+  /// Return all the modules of the program.
+  std::vector<std::shared_ptr<Onyx::File>> modules() const;
+
   /// Compile the program into MLIR without lowering it just yet.
   void compile_mlir();
 
@@ -68,7 +102,7 @@ struct Program {
       std::variant<std::filesystem::path, std::ostream *> output,
       IROutputFormat);
 
-  /// Lower the program to LLIR without emitting anything.
+  /// Lower the program to LLIR and optimize it without emitting anything.
   void compile_llir();
 
   /// Emit the LLIR of the program.
@@ -76,45 +110,143 @@ struct Program {
       std::variant<std::filesystem::path, std::ostream *> output,
       IROutputFormat);
 
+  /// Emit the LLVM bitcode of the program.
+  void emit_bc(
+      std::variant<std::filesystem::path, std::ostream *> output,
+      IROutputFormat);
+
   /// Link the program, and emit it as a single executable file.
   void emit_exe(
       std::filesystem::path exe_path,
       std::vector<std::filesystem::path> lib_paths,
       std::vector<std::string> linked_libs);
 
+  /// Compile the program just-in-time and call its `main` function in-process
+  /// with *args*, returning the exit code. A function is only compiled upon
+  /// its first call, and C symbols are resolved from the host process. The
+  /// target shall be the host one.
+  int run(std::vector<std::string> args);
+
+  /// Get the cached object file path for *module_path*. Objects of different
+  /// targets and optimization levels are stored separately. Would create
+  /// missing directories implicitly. Caching shall be enabled.
+  std::filesystem::path obj_path(std::filesystem::path module_path) const;
+
 private:
   CompilationContext _compilation_ctx;
 
-  struct _LLVMContext {
-    const std::unique_ptr<llvm::LLVMContext> raw_context;
-    std::string target_triple;
-    llvm::TargetMachine *target_machine;
-    llvm::legacy::PassManager pass_manager;
-    _LLVMContext();
-  };
-
   std::shared_ptr<Onyx::File> _entry_module;
 
   /// TODO: Would add C physical file modules here.
   std::map<std::filesystem::path, std::shared_ptr<Onyx::File>> _modules;
 
+  /// The last write time of each module's source file upon its creation.
+  std::map<std::filesystem::path, std::filesystem::file_time_type>
+      _source_write_times;
+
+  /// Guards the modules and their write times while the pipeline runs, as
+  /// the imported modules are added meanwhile.
+  std::mutex _modules_mutex;
+
+  /// Create the entry module, or reuse one shared by the workspace.
+  void _add_entry_module();
+
+  /// Create the module at *path*, or reuse one shared by the workspace.
+  std::shared_ptr<Onyx::File> _add_module(const std::filesystem::path &path);
+
+  /// Drop the modules but the *reachable* ones, e.g. not imported anymore.
+  void _prune_modules(const std::vector<std::filesystem::path> &reachable);
+
+  /// Return a key unique to the settings affecting the modules' LLIR and
+  /// objects, i.e. the target and the optimization level.
+  std::string _module_cache_key() const;
+
+  /// Update the workspace index with the references of the compiled on-disk
+  /// modules whose shards are outdated. No-op if caching is disabled.
+  void _update_index();
+
+  /// Update the index shard of the compiled on-disk module at *path* if
+  /// outdated, returning true if updated. Thread-safe.
+  bool _index_module(
+      Index &index, const std::filesystem::path &path, Onyx::File &module);
+
+  /// Set once a module is indexed ahead of `_update_index()`, i.e. before
+  /// its MLIR is released in the low-memory mode.
+  std::atomic<bool> _index_pending = false;
+
   /// The program-wide Onyx type specialization map.
   // std::map<Onyx::HLIR::NXTypeSkeleton,
   // std::shared_ptr<Onyx::HLIR::NXTypeSpez>>
   //     _onyx_type_spezs;
 
-  std::unique_ptr<_LLVMContext> _llvm_ctx;
+  /// Shared by the workspace programs with the same target.
+  std::shared_ptr<LLVMTarget> _llvm_ctx;
+
+  /// Pending asynchronous object cache writes, each resulting in an optional
+  /// error message.
+  std::vector<std::future<std::optional<std::string>>> _obj_cache_writes;
+  std::mutex _obj_cache_writes_mutex;
+
+  /// Serialize each module with *serialize* and write it to *output*. The
+  /// modules are serialized on the shared executor, each with its lock held.
+  /// In the `Tar` format, a module becomes an archive member named after its
+  /// path with *extension* as soon as it's serialized.
+  void _emit_ir(
+      std::variant<std::filesystem::path, std::ostream *> output,
+      IROutputFormat,
+      const char *extension,
+      std::function<std::string(Onyx::File &)> serialize);
+
+  /// The compilation stages of a module, see `_run_pipeline()`.
+  enum class _Stage {
+    Parse,
+    MLIR,
+    Lower,
+    Optimize,
+    Codegen,
+  };
+
+  /// Move the entry module and the ones it imports, transitively, through
+  /// the stages until the *last* one, in parallel as the module dependencies
+  /// allow. Return true if any module has been compiled to MLIR anew.
+  bool _run_pipeline(_Stage last);
 
+  /// Emit in-memory object files for all the modules. If caching is enabled,
+  /// the objects are written to the cache asynchronously.
   void _compile_obj();
 
+  /// Write the *obj* of the module at *module_path* into the cache
+  /// asynchronously, if caching is enabled.
+  void _write_obj_cache(
+      const std::filesystem::path &module_path, llvm::StringRef obj);
+
+  /// Wait for pending object cache writes, logging failures as warnings.
+  void _await_obj_cache_writes();
+
+  /// Link the in-memory objects into the executable at *exe_path*.
+  ///
+  /// Only on a Linux host the objects are handed to the linker without
+  /// touching the disk, via memory files. Elsewhere, including a Windows
+  /// host linking COFF, the cached objects are linked if any, and the rest
+  /// are written to temporary files.
   void _link(
       std::filesystem::path exe_path,
       std::vector<std::filesystem::path> lib_paths,
       std::vector<std::string> linked_libs);
 
-  /// Get object file path for *module_path*.
-  /// Would create missing directories implicitly.
-  std::filesystem::path _obj_path(std::filesystem::path module_path) const;
+  /// Link a Windows executable with `lld-link`.
+  void _link_coff(
+      std::filesystem::path exe_path,
+      const std::vector<std::string> &obj_paths,
+      std::vector<std::filesystem::path> lib_paths,
+      std::vector<std::string> linked_libs);
+
+  /// Link a Linux executable with `ld.lld` against the host C runtime.
+  void _link_elf(
+      std::filesystem::path exe_path,
+      const std::vector<std::string> &obj_paths,
+      std::vector<std::filesystem::path> lib_paths,
+      std::vector<std::string> linked_libs);
 };
 
 } // namespace NXC
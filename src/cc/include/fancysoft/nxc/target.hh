@@ -1,14 +1,44 @@
 #pragma once
 
+#include <string>
+
 namespace Fancysoft {
 namespace NXC {
 
 struct Target {
   enum class ObjectFileFormat {
     COFF,
+    ELF,
   };
 
+  /// Return the default target triple, i.e. the one of the compiler process.
+  static std::string default_triple();
+
+  /// Return the object file format used by *triple*, e.g. `ELF` for
+  /// `"x86_64-pc-linux-gnu"`. Throws for unsupported formats.
+  static ObjectFileFormat object_file_format_of(const std::string &triple);
+
   ObjectFileFormat object_file_format;
+
+  /// The target triple, e.g. `"x86_64-pc-win32-msvc"`.
+  std::string triple;
+
+  /// The target CPU name, e.g. `"skylake-avx512"`. A special `"native"` value
+  /// stands for the host CPU, see `resolve()`.
+  std::string cpu = "generic";
+
+  /// The comma-separated target features string, e.g. `"+avx2,-avx512f"`.
+  std::string features;
+
+  /// Return a copy of the target with the `"native"` CPU replaced by the host
+  /// CPU name, and the host CPU features prepended to the explicit ones (so
+  /// that the explicit features take precedence).
+  Target resolve() const;
+
+  /// Return a file system friendly key uniquely identifying the target, e.g.
+  /// `"x86_64-pc-win32-msvc-skylake-1a2b3c4d5e6f7a8b"`. Shall be a part of
+  /// any target-dependent cache key. Expects the target to be `resolve()`d.
+  std::string cache_key() const;
 };
 
 } // namespace NXC
@@ -2,7 +2,9 @@
 
 #include <memory>
 #include <ostream>
+#include <vector>
 
+#include "./exception.hh"
 #include "./position.hh"
 
 namespace Fancysoft {
@@ -22,8 +24,14 @@ struct Unit {
   /// A `parse()` call shall throw if already parsed.
   bool parsed() const { return _parsed; }
 
+  /// Return the panics recovered from while parsing, see `Parser::panics()`.
+  /// A unit parsed with any is incomplete, thus shall not be compiled but
+  /// on the best-effort basis, e.g. for an editor.
+  const std::vector<Panic> &panics() const { return _panics; }
+
 protected:
   bool _parsed = false;
+  std::vector<Panic> _panics;
 };
 
 } // namespace NXC
@@ -1,18 +1,45 @@
 #pragma once
 
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./index.hh"
+#include "./target.hh"
 
 namespace Fancysoft {
 namespace NXC {
 
 struct Program;
+struct LLVMTarget;
+
+namespace Onyx {
+struct File;
+}
 
 /// A workspace hosts a number of programs to be built. All of its programs
 /// share the same cache and reference index. Direct paths (e.g. `"foo/bar"`)
 /// within the workspace programs are resolved relative to *root*.
+///
+/// Programs of a workspace with the same target and optimization level share
+/// on-disk modules along with their MLIR, LLIR and objects, so that a module
+/// common to several programs is only compiled once.
 struct Workspace {
+  /// An executable to be built by `build()`.
+  struct Executable {
+    std::shared_ptr<Program> program;
+    std::filesystem::path exe_path;
+    std::vector<std::filesystem::path> lib_paths;
+    std::vector<std::string> linked_libs;
+  };
+
   std::filesystem::path root;
   std::optional<std::filesystem::path> cache_dir;
 
@@ -25,7 +52,60 @@ struct Workspace {
       return dir;
     }
   }
-  // std::vector<std::shared_ptr<Program>> programs;
+
+  /// Return the persistent reference index, created lazily within the cache
+  /// directory. Returns null if caching is disabled.
+  std::shared_ptr<Index> index() {
+    if (!cache_dir)
+      return nullptr;
+
+    std::lock_guard lock(_index_mutex);
+
+    if (!_index)
+      _index = std::make_shared<Index>(cache_dir.value() / "./index/");
+
+    return _index;
+  }
+
+  /// Return the shared module at *path* for the settings identified by *key*
+  /// (e.g. the target), calling *create* if there is none yet or its source
+  /// file has been modified since. A module is kept while any program refers
+  /// to it.
+  std::shared_ptr<Onyx::File> module(
+      const std::filesystem::path &path,
+      const std::string &key,
+      std::function<std::shared_ptr<Onyx::File>()> create);
+
+  /// Return the LLVM state shared by the programs with the resolved *target*.
+  std::shared_ptr<LLVMTarget> llvm_target(const Target &target);
+
+  /// Return the LLVM states created so far, e.g. to report their pools.
+  std::vector<std::shared_ptr<LLVMTarget>> llvm_targets();
+
+  /// Build *executables* in parallel on a pool of *jobs* threads (zero
+  /// stands for the hardware concurrency). Modules common to the programs
+  /// are only compiled once. Return an error per executable, null if it has
+  /// been built successfully.
+  std::vector<std::exception_ptr>
+  build(const std::vector<Executable> &executables, unsigned jobs = 0);
+
+private:
+  struct _SharedModule {
+    std::weak_ptr<Onyx::File> module;
+    std::filesystem::file_time_type write_time;
+  };
+
+  std::mutex _index_mutex;
+  std::shared_ptr<Index> _index;
+
+  /// Guards `_modules` and `_llvm_targets`.
+  std::mutex _mutex;
+
+  /// The shared modules by their absolute paths and settings keys.
+  std::map<std::pair<std::filesystem::path, std::string>, _SharedModule>
+      _modules;
+
+  std::map<std::string, std::shared_ptr<LLVMTarget>> _llvm_targets;
 };
 
 } // namespace NXC
@@ -4,9 +4,13 @@
 
 #pragma once
 
+#include <cstddef>
 #include <exception>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <optional>
+#include <type_traits>
 
 // HACK: Coroutines status is... questionable among the compilers.
 // TODO: Define compiler versions for even more precise settings.
@@ -47,6 +51,12 @@
 #include <experimental/coroutine>
 #define __FNXC__CORO_NS std::experimental
 
+// GNU CC or CLang on Linux, with C++20 coroutines.
+#elif defined(__linux__)
+
+#include <coroutine>
+#define __FNXC__CORO_NS std
+
 #else
 
 #error "Coroutines are not implemented yet for this platform"
@@ -57,13 +67,134 @@ namespace Fancysoft {
 namespace Util {
 namespace Coro {
 
+/// A thread-local recycling allocator of coroutine frames, so that creating
+/// a coroutine, e.g. a lexer per file, costs no heap allocation once a frame
+/// of the same size class has been freed on the thread.
+///
+/// The frames are grouped into `Granularity`-sized classes up to `MaxSize`,
+/// larger ones are always heap-allocated. A frame freed on another thread is
+/// recycled there.
+struct FrameAllocator {
+  static constexpr size_t Granularity = 64;
+  static constexpr size_t MaxSize = 4096;
+
+  /// The maximum amount of frames cached per size class and thread.
+  static constexpr size_t MaxCached = 16;
+
+  static void *allocate(size_t size) {
+    if (size > MaxSize)
+      return ::operator new(size);
+    else if (_Cache::destroyed)
+      return ::operator new(_class_size(size));
+
+    auto &list = _cache.lists[_class(size)];
+
+    if (auto frame = list.head) {
+      list.head = frame->next;
+      list.count--;
+      return frame;
+    }
+
+    return ::operator new(_class_size(size));
+  }
+
+  static void deallocate(void *frame, size_t size) noexcept {
+    if (size > MaxSize || _Cache::destroyed)
+      return ::operator delete(frame);
+
+    auto &list = _cache.lists[_class(size)];
+
+    if (list.count == MaxCached)
+      return ::operator delete(frame);
+
+    list.head = new (frame) _Free{list.head};
+    list.count++;
+  }
+
+  /// The amount of frames cached by the current thread.
+  static size_t cached() {
+    size_t count = 0;
+
+    for (auto &list : _cache.lists)
+      count += list.count;
+
+    return count;
+  }
+
+private:
+  struct _Free {
+    _Free *next;
+  };
+
+  struct _List {
+    _Free *head = nullptr;
+    size_t count = 0;
+  };
+
+  struct _Cache {
+    /// Frames may be freed after the cache upon the thread exit.
+    static thread_local bool destroyed;
+
+    _List lists[MaxSize / Granularity];
+
+    ~_Cache() {
+      for (auto &list : lists)
+        while (auto frame = list.head) {
+          list.head = frame->next;
+          ::operator delete(frame);
+        }
+
+      destroyed = true;
+    }
+  };
+
+  static thread_local _Cache _cache;
+
+  static size_t _class(size_t size) {
+    return size ? (size - 1) / Granularity : 0;
+  }
+
+  static size_t _class_size(size_t size) {
+    return (_class(size) + 1) * Granularity;
+  }
+};
+
+inline thread_local bool FrameAllocator::_Cache::destroyed = false;
+inline thread_local FrameAllocator::_Cache FrameAllocator::_cache;
+
+/// A lazy coroutine yielding values of type *T*, which may be a reference.
+/// The yielded values are not copied, but referenced until the coroutine is
+/// resumed; an rvalue reference is given out unless *T* is a reference, so
+/// that a yielded value may be moved out. The frames are allocated with
+/// `FrameAllocator`.
+///
+/// @code{.cpp}
+///   Generator<Token> lex() {
+///     co_yield Token(); // Not copied
+///   }
+///
+///   for (auto &&token : lex())
+///     tokens.push_back(std::move(token));
+/// @endcode
 template <typename T> struct Generator {
+  using value_type = std::remove_cvref_t<T>;
+  using reference = std::conditional_t<std::is_reference_v<T>, T, T &&>;
+
   struct Promise {
-    std::optional<T> current_value;
+    /// Points to the value yielded last, valid until the next resumption.
+    std::add_pointer_t<reference> current_value = nullptr;
 
     Promise(){};
     ~Promise(){};
 
+    static void *operator new(size_t size) {
+      return FrameAllocator::allocate(size);
+    }
+
+    static void operator delete(void *frame, size_t size) {
+      FrameAllocator::deallocate(frame, size);
+    }
+
     __FNXC__CORO_NS::suspend_always initial_suspend() {
       return __FNXC__CORO_NS::suspend_always{};
     }
@@ -72,16 +203,48 @@ template <typename T> struct Generator {
       return Generator{Handle::from_promise(*this)};
     }
 
-    __FNXC__CORO_NS::suspend_always yield_value(T value) {
-      current_value = value;
+    /// A temporary outlives the suspension, thus it is referenced.
+    __FNXC__CORO_NS::suspend_always
+    yield_value(std::remove_reference_t<reference> &&value) noexcept {
+      current_value = std::addressof(value);
+      return __FNXC__CORO_NS::suspend_always{};
+    }
+
+    __FNXC__CORO_NS::suspend_always
+    yield_value(std::remove_reference_t<reference> &value) noexcept
+      requires std::is_lvalue_reference_v<reference>
+    {
+      current_value = std::addressof(value);
       return __FNXC__CORO_NS::suspend_always{};
     }
 
+    /// An lvalue yielded by a non-reference generator is copied into the
+    /// frame, so that moving it out doesn't affect the coroutine.
+    auto yield_value(const value_type &value)
+      requires(!std::is_reference_v<T>)
+    {
+      struct Awaiter {
+        value_type copy;
+        Promise &promise;
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(Handle) noexcept {
+          promise.current_value = std::addressof(copy);
+        }
+
+        void await_resume() noexcept {}
+      };
+
+      return Awaiter{value, *this};
+    }
+
     __FNXC__CORO_NS::suspend_never return_void() {
       return __FNXC__CORO_NS::suspend_never{};
     }
 
     __FNXC__CORO_NS::suspend_always final_suspend() noexcept {
+      current_value = nullptr;
       return __FNXC__CORO_NS::suspend_always{};
     }
 
@@ -112,29 +275,48 @@ template <typename T> struct Generator {
       return *this;
     }
 
-    T operator*() const { return owner.coro.promise().current_value.value(); }
+    reference operator*() const { return owner.current(); }
   };
 
+  using promise_type = Promise;
   using Handle = __FNXC__CORO_NS::coroutine_handle<Promise>;
 
   Generator(const Generator &) = delete;
-  Generator(Generator &&g) : coro(g.coro) { g.coro = nullptr; };
+  Generator &operator=(const Generator &) = delete;
+
+  Generator(Generator &&g) noexcept : coro(g.coro) { g.coro = nullptr; };
+
+  Generator &operator=(Generator &&g) noexcept {
+    if (this != &g) {
+      if (coro)
+        coro.destroy();
+
+      coro = g.coro;
+      g.coro = nullptr;
+    }
+
+    return *this;
+  }
 
   ~Generator() {
     if (coro)
       coro.destroy();
   }
 
-  T current() { return coro.promise().current_value.value(); }
+  /// The value yielded last, until resumed. Must not be `done()`.
+  reference current() const {
+    return static_cast<reference>(*coro.promise().current_value);
+  }
 
   void resume() { coro.resume(); }
 
-  T next() {
+  /// Resume and return the value yielded. Must not be `done()` afterwards.
+  reference next() {
     coro.resume();
     return current();
   }
 
-  bool done() { return coro.done(); }
+  bool done() const { return coro.done(); }
 
   Iterator begin() { return Iterator{*this, false}; }
   Iterator end() { return Iterator{*this, true}; }
@@ -145,10 +327,11 @@ private:
 };
 
 template <typename T> struct CoReturn {
-  struct promise;
-  friend struct promise;
+  struct Promise;
+  friend struct Promise;
 
-  using Handle = __FNXC__CORO_NS::coroutine_handle<promise>;
+  using promise_type = Promise;
+  using Handle = __FNXC__CORO_NS::coroutine_handle<Promise>;
 
   CoReturn(const CoReturn &) = delete;
   CoReturn(CoReturn &&s) : coro(s.coro) { s.coro = nullptr; }
@@ -199,7 +382,7 @@ template <typename T> struct Sync : public CoReturn<T> {
   using CoReturn<T>::CoReturn;
   using Handle = typename CoReturn<T>::Handle;
 
-  struct Promise : public CoReturn<T>::promise {
+  struct Promise : public CoReturn<T>::Promise {
     Sync<T> get_return_object() { return Sync<T>{Handle::from_promise(*this)}; }
 
     __FNXC__CORO_NS::suspend_never initial_suspend() {
@@ -207,6 +390,8 @@ template <typename T> struct Sync : public CoReturn<T> {
     }
   };
 
+  using promise_type = Promise;
+
   T get() { return CoReturn<T>::get(); }
 };
 
@@ -214,7 +399,7 @@ template <typename T> struct Async : public CoReturn<T> {
   using CoReturn<T>::CoReturn;
   using Handle = typename CoReturn<T>::Handle;
 
-  struct Promise : public CoReturn<T>::promise {
+  struct Promise : public CoReturn<T>::Promise {
     Async<T> get_return_object() {
       return Async<T>{Handle::from_promise(*this)};
     }
@@ -224,6 +409,8 @@ template <typename T> struct Async : public CoReturn<T> {
     }
   };
 
+  using promise_type = Promise;
+
   struct Awaitable {
     Handle coro;
 
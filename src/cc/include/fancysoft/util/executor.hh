@@ -0,0 +1,555 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "./coro.hh"
+
+namespace Fancysoft {
+namespace Util {
+namespace Coro {
+
+template <typename T = void> class Task;
+
+namespace Detail {
+
+struct TaskPromiseBase {
+  /// Resumed once the task is done, by symmetric transfer.
+  __FNXC__CORO_NS::coroutine_handle<> continuation =
+      __FNXC__CORO_NS::noop_coroutine();
+
+  std::exception_ptr exception;
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename P>
+    __FNXC__CORO_NS::coroutine_handle<>
+    await_suspend(__FNXC__CORO_NS::coroutine_handle<P> handle) noexcept {
+      return handle.promise().continuation;
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  static void *operator new(size_t size) {
+    return FrameAllocator::allocate(size);
+  }
+
+  static void operator delete(void *frame, size_t size) {
+    FrameAllocator::deallocate(frame, size);
+  }
+
+  __FNXC__CORO_NS::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T> struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;
+
+  Task<T> get_return_object();
+
+  template <typename U> void return_value(U &&v) {
+    value.emplace(std::forward<U>(v));
+  }
+
+  T result() {
+    if (exception)
+      std::rethrow_exception(exception);
+
+    return std::move(*value);
+  }
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object();
+
+  void return_void() {}
+
+  void result() {
+    if (exception)
+      std::rethrow_exception(exception);
+  }
+};
+
+} // namespace Detail
+
+/// A lazily started coroutine returning *T*, which is started once awaited.
+/// The awaiting coroutine is suspended until the task is done, and then
+/// resumed on the thread which has completed it; both transitions are
+/// symmetric transfers, thus a chain of tasks doesn't grow the stack. An
+/// exception thrown by the task is rethrown upon awaiting.
+///
+/// A task runs on the thread which awaits it until it awaits something else,
+/// e.g. `Executor::schedule()` to move to the executor.
+///
+/// @code{.cpp}
+///   Task<int> answer(Executor &executor) {
+///     co_await executor.schedule();
+///     co_return 42;
+///   }
+///
+///   assert(executor.block_on(answer(executor)) == 42);
+/// @endcode
+template <typename T> class Task {
+public:
+  using Promise = Detail::TaskPromise<T>;
+  using promise_type = Promise;
+  using Handle = __FNXC__CORO_NS::coroutine_handle<Promise>;
+
+  Task(Task &&other) noexcept : _handle(std::exchange(other._handle, {})) {}
+
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      if (_handle)
+        _handle.destroy();
+
+      _handle = std::exchange(other._handle, {});
+    }
+
+    return *this;
+  }
+
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+
+  ~Task() {
+    if (_handle)
+      _handle.destroy();
+  }
+
+  bool done() const { return !_handle || _handle.done(); }
+
+  /// Await the task's completion and return its result, which is moved out,
+  /// thus a task shall only be awaited once.
+  auto operator co_await() noexcept {
+    struct Awaiter : _Awaiter {
+      T await_resume() { return this->handle.promise().result(); }
+    };
+
+    return Awaiter{{_handle}};
+  }
+
+  /// Await the task's completion, but neither return its result nor rethrow
+  /// its exception.
+  auto when_ready() noexcept {
+    struct Awaiter : _Awaiter {
+      void await_resume() noexcept {}
+    };
+
+    return Awaiter{{_handle}};
+  }
+
+  /// Return the result of a done task, or rethrow its exception.
+  T result() { return _handle.promise().result(); }
+
+private:
+  friend Promise;
+
+  Handle _handle;
+
+  explicit Task(Handle handle) : _handle(handle) {}
+
+  struct _Awaiter {
+    Handle handle;
+
+    bool await_ready() noexcept { return !handle || handle.done(); }
+
+    __FNXC__CORO_NS::coroutine_handle<>
+    await_suspend(__FNXC__CORO_NS::coroutine_handle<> awaiting) noexcept {
+      handle.promise().continuation = awaiting;
+      return handle;
+    }
+  };
+};
+
+template <typename T> Task<T> Detail::TaskPromise<T>::get_return_object() {
+  return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> Detail::TaskPromise<void>::get_return_object() {
+  return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+/// A pool of worker threads resuming coroutines, with a deque per worker. A
+/// coroutine scheduled by a worker is pushed to its own deque, which it pops
+/// from in the LIFO order for the cache locality; an idle worker steals from
+/// the other end of the others' deques. A coroutine scheduled by any other
+/// thread is injected via a shared queue.
+///
+/// @code{.cpp}
+///   Task<> compile(Executor &executor, Module &module) {
+///     co_await executor.schedule(); // Now running on a worker
+///     module.compile();
+///   }
+///
+///   Executor executor;
+///   std::vector<Task<>> tasks;
+///
+///   for (auto &module : modules)
+///     tasks.push_back(compile(executor, module));
+///
+///   executor.block_on(when_all(std::move(tasks)));
+/// @endcode
+class Executor {
+public:
+  /// Thrown by `block_on()` if the executor has run out of work before the
+  /// task is done, i.e. the task awaits something never to happen.
+  struct Deadlock : std::runtime_error {
+    Deadlock() : std::runtime_error("The awaited task would never complete") {}
+  };
+
+  /// Start *size* workers; zero stands for the hardware concurrency.
+  Executor(unsigned size = 0);
+
+  /// Would resume the coroutines scheduled already and wait for the workers
+  /// to stop.
+  ~Executor();
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  /// Return the process-wide executor with the hardware concurrency workers,
+  /// started upon the first call. Sharing it bounds the total amount of
+  /// workers, e.g. when multiple programs are compiled at once.
+  static Executor &shared();
+
+  /// Return the amount of workers.
+  unsigned size() const { return _workers.size(); }
+
+  /// Return an awaitable resuming the awaiting coroutine on a worker.
+  auto schedule() noexcept {
+    struct Awaiter {
+      Executor &executor;
+
+      bool await_ready() noexcept { return false; }
+
+      void await_suspend(__FNXC__CORO_NS::coroutine_handle<> handle) {
+        executor.post(handle);
+      }
+
+      void await_resume() noexcept {}
+    };
+
+    return Awaiter{*this};
+  }
+
+  /// Schedule a suspended coroutine to be resumed on a worker.
+  void post(__FNXC__CORO_NS::coroutine_handle<> handle);
+
+  /// Start *task* on a worker and block until it is done, returning its
+  /// result or rethrowing its exception. Shall not be called by a worker,
+  /// but may be by multiple other threads at once. Throws `Deadlock` if there
+  /// is nothing left to run before *task* is done.
+  template <typename T> T block_on(Task<T> task);
+
+private:
+  struct alignas(64) _Worker {
+    std::thread thread;
+
+    /// Only contended upon stealing.
+    std::mutex mutex;
+
+    std::deque<__FNXC__CORO_NS::coroutine_handle<>> deque;
+  };
+
+  /// The root of `block_on()`, which signals once suspended finally, so
+  /// that it is not destroyed while still running.
+  struct _Signal {
+    struct Promise {
+      Executor *executor;
+      bool *done;
+
+      _Signal get_return_object() {
+        return _Signal{
+            __FNXC__CORO_NS::coroutine_handle<Promise>::from_promise(*this)};
+      }
+
+      __FNXC__CORO_NS::suspend_always initial_suspend() noexcept { return {}; }
+
+      auto final_suspend() noexcept {
+        struct Awaiter {
+          bool await_ready() noexcept { return false; }
+
+          void await_suspend(
+              __FNXC__CORO_NS::coroutine_handle<Promise> handle) noexcept {
+            auto &promise = handle.promise();
+            promise.executor->_finish(*promise.done);
+          }
+
+          void await_resume() noexcept {}
+        };
+
+        return Awaiter{};
+      }
+
+      void return_void() {}
+
+      // The awaited task's exception is kept by the task.
+      void unhandled_exception() { std::terminate(); }
+    };
+
+    using promise_type = Promise;
+
+    __FNXC__CORO_NS::coroutine_handle<Promise> handle;
+
+    ~_Signal() { handle.destroy(); }
+  };
+
+  template <typename T> static _Signal _signal(Task<T> &task) {
+    co_await task.when_ready();
+  }
+
+  std::vector<std::unique_ptr<_Worker>> _workers;
+
+  /// The coroutines scheduled by non-worker threads.
+  std::mutex _injected_mutex;
+  std::deque<__FNXC__CORO_NS::coroutine_handle<>> _injected;
+
+  /// The amount of coroutines scheduled, but not taken by a worker yet.
+  std::atomic<size_t> _queued = 0;
+
+  /// The amount of coroutines scheduled or running, so that zero means
+  /// that the executor has run out of work.
+  std::atomic<size_t> _outstanding = 0;
+
+  /// The amount of workers waiting for work.
+  std::atomic<size_t> _sleeping = 0;
+
+  /// Guards the sleeping, stopping and `block_on()` completion.
+  std::mutex _mutex;
+  std::condition_variable _work_available;
+  std::condition_variable _idle;
+  bool _stopping = false;
+
+  void _work(size_t index);
+
+  /// Take a coroutine from the worker's deque, the injected ones or from
+  /// another worker's deque.
+  __FNXC__CORO_NS::coroutine_handle<> _take(size_t index);
+
+  void _finish(bool &done);
+};
+
+template <typename T> T Executor::block_on(Task<T> task) {
+  bool done = false;
+  auto signal = _signal(task);
+  signal.handle.promise().executor = this;
+  signal.handle.promise().done = &done;
+  post(signal.handle);
+
+  {
+    std::unique_lock lock(_mutex);
+    _idle.wait(lock, [this, &done]() { return done || !_outstanding; });
+
+    if (!done)
+      throw Deadlock();
+  }
+
+  return task.result();
+}
+
+/// A one-shot event, the awaiting coroutines of which are resumed on an
+/// executor once it is set. An event set already is not suspended upon.
+class Event {
+public:
+  Event(Executor &executor) : _executor(executor) {}
+
+  Event(const Event &) = delete;
+  Event &operator=(const Event &) = delete;
+
+  bool is_set() const { return _set.load(std::memory_order_acquire); }
+
+  /// Set the event, scheduling the awaiting coroutines. Is idempotent.
+  void set() {
+    std::vector<__FNXC__CORO_NS::coroutine_handle<>> waiters;
+
+    {
+      std::lock_guard lock(_mutex);
+
+      if (is_set())
+        return;
+
+      _set.store(true, std::memory_order_release);
+      waiters.swap(_waiters);
+    }
+
+    for (auto waiter : waiters)
+      _executor.post(waiter);
+  }
+
+  auto operator co_await() noexcept {
+    struct Awaiter {
+      Event &event;
+
+      bool await_ready() noexcept { return event.is_set(); }
+
+      bool await_suspend(__FNXC__CORO_NS::coroutine_handle<> handle) {
+        std::lock_guard lock(event._mutex);
+
+        if (event.is_set())
+          return false;
+
+        event._waiters.push_back(handle);
+        return true;
+      }
+
+      void await_resume() noexcept {}
+    };
+
+    return Awaiter{*this};
+  }
+
+private:
+  Executor &_executor;
+  std::atomic<bool> _set = false;
+  std::mutex _mutex;
+  std::vector<__FNXC__CORO_NS::coroutine_handle<>> _waiters;
+};
+
+namespace Detail {
+
+/// Counts the `when_all()` tasks down, resuming the awaiting coroutine once
+/// they all are done. Starts with an extra count, so that the tasks done
+/// while still starting the others don't resume it prematurely.
+struct WhenAllLatch {
+  std::atomic<size_t> count;
+  __FNXC__CORO_NS::coroutine_handle<> awaiting;
+
+  /// Return true if it has been the last one.
+  bool arrive() { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+};
+
+/// Awaits a single `when_all()` task and arrives at the latch.
+struct WhenAllArrival {
+  struct Promise {
+    WhenAllLatch *latch;
+
+    WhenAllArrival get_return_object() {
+      return WhenAllArrival{
+          __FNXC__CORO_NS::coroutine_handle<Promise>::from_promise(*this)};
+    }
+
+    static void *operator new(size_t size) {
+      return FrameAllocator::allocate(size);
+    }
+
+    static void operator delete(void *frame, size_t size) {
+      FrameAllocator::deallocate(frame, size);
+    }
+
+    __FNXC__CORO_NS::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+      struct Awaiter {
+        bool await_ready() noexcept { return false; }
+
+        __FNXC__CORO_NS::coroutine_handle<> await_suspend(
+            __FNXC__CORO_NS::coroutine_handle<Promise> handle) noexcept {
+          auto latch = handle.promise().latch;
+
+          if (latch->arrive())
+            return latch->awaiting;
+          else
+            return __FNXC__CORO_NS::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+      };
+
+      return Awaiter{};
+    }
+
+    void return_void() {}
+
+    // The task's exception is kept by the task.
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  using promise_type = Promise;
+
+  __FNXC__CORO_NS::coroutine_handle<Promise> handle;
+
+  WhenAllArrival(__FNXC__CORO_NS::coroutine_handle<Promise> handle) :
+      handle(handle) {}
+
+  WhenAllArrival(WhenAllArrival &&other) noexcept :
+      handle(std::exchange(other.handle, {})) {}
+
+  ~WhenAllArrival() {
+    if (handle)
+      handle.destroy();
+  }
+};
+
+template <typename T> WhenAllArrival when_all_arrival(Task<T> &task) {
+  co_await task.when_ready();
+}
+
+/// Start all the *tasks*, suspending until they are done.
+template <typename T> struct WhenAllAwaiter {
+  std::vector<Task<T>> &tasks;
+  std::vector<WhenAllArrival> arrivals;
+  WhenAllLatch latch;
+
+  bool await_ready() noexcept { return tasks.empty(); }
+
+  bool await_suspend(__FNXC__CORO_NS::coroutine_handle<> awaiting) {
+    latch.count.store(tasks.size() + 1, std::memory_order_relaxed);
+    latch.awaiting = awaiting;
+    arrivals.reserve(tasks.size());
+
+    for (auto &task : tasks) {
+      arrivals.push_back(when_all_arrival(task));
+      arrivals.back().handle.promise().latch = &latch;
+      arrivals.back().handle.resume();
+    }
+
+    // Not to suspend if all the tasks are done already.
+    return !latch.arrive();
+  }
+
+  void await_resume() noexcept {}
+};
+
+} // namespace Detail
+
+/// Start all the *tasks* at once and await them all, returning their
+/// results in order. If any has thrown, the first one's exception is
+/// rethrown once all are done. The tasks run concurrently as long as they
+/// are scheduled on an executor.
+template <typename T>
+Task<std::vector<T>> when_all(std::vector<Task<T>> tasks) {
+  co_await Detail::WhenAllAwaiter<T>{tasks, {}, {}};
+
+  std::vector<T> results;
+  results.reserve(tasks.size());
+
+  for (auto &task : tasks)
+    results.push_back(task.result());
+
+  co_return results;
+}
+
+/// Start all the *tasks* at once and await them all. If any has thrown,
+/// the first one's exception is rethrown once all are done.
+inline Task<void> when_all(std::vector<Task<void>> tasks) {
+  co_await Detail::WhenAllAwaiter<void>{tasks, {}, {}};
+
+  for (auto &task : tasks)
+    task.result();
+}
+
+} // namespace Coro
+} // namespace Util
+} // namespace Fancysoft
@@ -1,15 +1,41 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <variant>
 #include <vector>
 
 #include "./null_stream.hh"
 
+/// The minimum logging verbosity compiled in, as the `Logger::Verbosity`
+/// ordinal. The `FNXC_LOG` macros of a lower level expand to dead code, so
+/// that neither the level check nor the arguments remain in the binary. By
+/// default, trace and debug logging is compiled out of release builds.
+#ifndef FNXC_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define FNXC_LOG_MIN_LEVEL 2 // Info
+#else
+#define FNXC_LOG_MIN_LEVEL 0 // Trace
+#endif
+#endif
+
 namespace Fancysoft {
 namespace Util {
 
+/// A leveled logger. A message is buffered per thread until it ends with a
+/// newline (or is flushed), and then written at once, so that messages of
+/// parallel threads do not interleave.
+///
+/// Once `start_async()`ed, the messages are put into per-thread lock-free
+/// ring buffers instead, and written by a background thread, so that the
+/// logging threads neither wait for the output nor for each other. Errors
+/// are still written synchronously.
 class Logger {
 public:
   enum class Verbosity {
@@ -30,6 +56,27 @@ public:
 
   Logger(Verbosity, std::ostream &);
 
+  /// Would `stop_async()`.
+  ~Logger();
+
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  /// Start writing the messages by a background thread. Each logging thread
+  /// gets a ring buffer of *buffer_size* bytes; a message which does not fit
+  /// waits for the writer to catch up.
+  void start_async(size_t buffer_size = 64 * 1024);
+
+  /// Write all the pending messages and stop the background thread.
+  void stop_async();
+
+  /// Write the messages pending in the async mode synchronously, e.g. before
+  /// the output stream is written to directly.
+  void flush();
+
+  /// Check if messages of the *level* are output at run-time.
+  bool enabled(Verbosity level) const { return verbosity <= level; }
+
 #define DEF_LOGGING(LEVEL)                                                     \
   std::ostream &LEVEL(const char *context = NULL);                             \
   std::ostream &LEVEL(const std::vector<const char *> context);
@@ -44,14 +91,83 @@ public:
 #undef DEF_LOGGING
 
 private:
+  /// A single-producer single-consumer ring buffer of length-prefixed
+  /// messages.
+  struct _Ring;
+
+  /// The thread-local stream buffering a message.
+  class _ThreadStream;
+
   std::ostream &_output;
   NullStream _null_stream;
-  void _output_header(
+
+  /// Unique per instance, unlike the address.
+  const uint64_t _id;
+
+  /// Guards the output in the synchronous mode, and the rings list.
+  std::mutex _mutex;
+
+  std::vector<std::shared_ptr<_Ring>> _rings;
+  size_t _ring_size = 0;
+
+  std::atomic<bool> _async = false;
+  std::atomic<bool> _stopping = false;
+  std::thread _writer;
+  std::mutex _writer_mutex;
+  std::condition_variable _writer_wakeup;
+
+  /// Return the stream of the calling thread with the header written.
+  std::ostream &_begin(
       Verbosity, std::variant<const char *, std::vector<const char *>> context);
-  void _output_time();
+
+  void _output_header(
+      std::ostream &,
+      Verbosity,
+      std::variant<const char *, std::vector<const char *>> context);
+
+  void _output_time(std::ostream &);
+
+  /// Output a complete *message*. In the async mode, it is put into the
+  /// calling thread's *ring*, created if null. An *urgent* one (i.e. an
+  /// error) is written synchronously after the pending ones, so that it is
+  /// ordered against the output written directly, e.g. a panic.
+  void _commit(
+      std::string_view message, std::shared_ptr<_Ring> &ring, bool urgent);
+
+  /// Write the messages pending in the rings, returning true if any.
+  bool _drain();
+
+  void _write_loop();
 };
 
 extern Logger logger;
 
 } // namespace Util
 } // namespace Fancysoft
+
+/// Check if the `VERBOSITY` level (e.g. `Trace`) is both compiled in and
+/// enabled at run-time.
+#define FNXC_LOG_ENABLED(VERBOSITY)                                            \
+  (int(Fancysoft::Util::Logger::Verbosity::VERBOSITY) >= FNXC_LOG_MIN_LEVEL && \
+   Fancysoft::Util::logger.enabled(                                            \
+       Fancysoft::Util::Logger::Verbosity::VERBOSITY))
+
+/// Log with the global logger, checking the level before the streamed
+/// arguments are evaluated, unlike calling `logger.trace()` directly.
+///
+/// @code{.cpp}
+///   FNXC_TRACE("MLIR") << "compile(" << ast->trace() << ")\n";
+///   FNXC_DEBUG({"MLIR", "_CCall"}) << "Done\n";
+/// @endcode
+#define FNXC_LOG(LEVEL, VERBOSITY, ...)                                        \
+  if (!FNXC_LOG_ENABLED(VERBOSITY))                                            \
+    ;                                                                          \
+  else                                                                         \
+    Fancysoft::Util::logger.LEVEL(__VA_ARGS__)
+
+#define FNXC_FATAL(...) FNXC_LOG(fatal, Fatal, __VA_ARGS__)
+#define FNXC_ERROR(...) FNXC_LOG(error, Error, __VA_ARGS__)
+#define FNXC_WARN(...) FNXC_LOG(warn, Warn, __VA_ARGS__)
+#define FNXC_INFO(...) FNXC_LOG(info, Info, __VA_ARGS__)
+#define FNXC_DEBUG(...) FNXC_LOG(debug, Debug, __VA_ARGS__)
+#define FNXC_TRACE(...) FNXC_LOG(trace, Trace, __VA_ARGS__)
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+
+namespace Fancysoft {
+namespace Util {
+
+/// Accounting of the heap allocations, implemented by replacing the global
+/// `operator new` and `operator delete`. Nothing is accounted until
+/// `enable()`d, so that it otherwise costs a single atomic load per
+/// allocation.
+///
+/// An allocation is accounted to the calling thread, and to the account of
+/// the innermost `Scope` of the thread, if any. A deallocation is accounted
+/// the same way, i.e. memory freed outside of the account scope which
+/// allocated it is not subtracted from the account.
+///
+/// @code{.cpp}
+///   MemoryAccount::enable();
+///   MemoryAccount account;
+///
+///   {
+///     MemoryAccount::Scope scope(account);
+///     ast = parse();
+///   }
+///
+///   std::cout << account.stats().live_bytes;
+/// @endcode
+class MemoryAccount {
+public:
+  struct Stats {
+    /// The amount of allocations.
+    uint64_t allocations = 0;
+
+    /// The total amount of bytes allocated, including those freed since.
+    uint64_t allocated_bytes = 0;
+
+    /// The amount of bytes allocated and not yet freed.
+    int64_t live_bytes = 0;
+
+    /// The maximum of `live_bytes`.
+    int64_t peak_bytes = 0;
+
+    /// Return the change of the amounts since *other*, with the peak kept.
+    Stats operator-(const Stats &other) const;
+  };
+
+  /// Attributes the allocations of the calling thread to an account until
+  /// destroyed. Scopes may be nested, the innermost account wins.
+  class Scope {
+  public:
+    Scope(MemoryAccount &account);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    MemoryAccount *_previous;
+  };
+
+  /// Start accounting the allocations of the process.
+  static void enable();
+
+  /// Stop accounting the allocations; the stats are kept.
+  static void disable();
+
+  static bool enabled();
+
+  /// Return the allocations of the calling thread since the accounting has
+  /// been enabled. The peak is not tracked.
+  static Stats thread_stats();
+
+  /// Return the peak resident set size of the process in bytes, or zero if
+  /// unknown on this platform.
+  static uint64_t peak_rss();
+
+  MemoryAccount() = default;
+  MemoryAccount(const MemoryAccount &) = delete;
+  MemoryAccount &operator=(const MemoryAccount &) = delete;
+
+  Stats stats() const;
+
+  /// Called by the allocation hooks.
+  void _allocated(uint64_t bytes);
+  void _freed(uint64_t bytes);
+
+private:
+  std::atomic<uint64_t> _allocations = 0;
+  std::atomic<uint64_t> _allocated_bytes = 0;
+  std::atomic<int64_t> _live_bytes = 0;
+  std::atomic<int64_t> _peak_bytes = 0;
+};
+
+} // namespace Util
+} // namespace Fancysoft
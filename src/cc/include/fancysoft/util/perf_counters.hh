@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cinttypes>
+#include <optional>
+#include <string>
+
+namespace Fancysoft {
+namespace Util {
+
+/// Hardware performance counters of the calling thread, backed by
+/// `perf_event_open(2)` on Linux. A counter which could not be opened (e.g.
+/// due to `perf_event_paranoid`, a virtual machine or another platform) is
+/// reported as unavailable rather than failing.
+///
+/// @code{.cpp}
+///   PerfCounters counters;
+///   auto before = counters.read();
+///   work();
+///   auto delta = counters.read() - before;
+///
+///   if (counters.has(PerfCounters::Instructions))
+///     std::cout << delta[PerfCounters::Instructions];
+/// @endcode
+class PerfCounters {
+public:
+  enum Counter {
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    CounterCount,
+  };
+
+  /// Return a short human-readable counter name, e.g. `"cache-misses"`.
+  static const char *name(Counter);
+
+  /// The counter values, zero for unavailable counters.
+  struct Values {
+    std::array<uint64_t, CounterCount> counts{};
+
+    uint64_t operator[](Counter counter) const { return counts[counter]; }
+
+    Values operator-(const Values &other) const;
+    Values &operator+=(const Values &other);
+  };
+
+  /// Open and start the counters for the calling thread, which shall be
+  /// the only one to read them.
+  PerfCounters();
+
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  /// Check if the *counter* is available.
+  bool has(Counter counter) const { return _fds[counter] >= 0; }
+
+  /// Check if any counter is available.
+  bool available() const;
+
+  /// Return the reason of the first counter which failed to open, if any.
+  const std::optional<std::string> &error() const { return _error; }
+
+  /// Read the current values.
+  Values read() const;
+
+private:
+  std::array<int, CounterCount> _fds;
+  std::optional<std::string> _error;
+};
+
+} // namespace Util
+} // namespace Fancysoft
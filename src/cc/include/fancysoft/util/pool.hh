@@ -1,42 +1,460 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <deque>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <thread>
 
 namespace Fancysoft {
 namespace Util {
 
+/// A pool of up to `size` lazily created objects, e.g. expensive to create
+/// LLVM target machines.
+///
+/// A released object is put into the releasing thread's magazine, a small
+/// set of slots which the thread acquires from first, in the release order;
+/// once full, it is put into a bounded global depot. Both are lock-free, and
+/// a thread steals from the other magazines before creating a new object.
+/// Only a thread waiting for an object, i.e. once `size` objects are in use,
+/// takes the lock.
+///
+/// @code{.cpp}
+///   Pool<Foo> pool([] { return std::make_unique<Foo>(); }, 4);
+///
+///   {
+///     auto foo = pool.lease();
+///     foo->bar();
+///   } // Released here
+/// @endcode
 template <class T> class Pool {
-  std::deque<std::unique_ptr<T>> _queue;
+public:
+  using Clock = std::chrono::steady_clock;
 
-  /// The maximum allowed amount of created objects.
-  size_t _max_size;
+  /// An object acquired from a pool until destroyed.
+  class Lease {
+  public:
+    Lease(Pool &pool, std::unique_ptr<T> object) :
+        _pool(&pool), _object(std::move(object)) {}
 
-  /// Tracks the total amount of created objects.
-  size_t _current_size = 0;
+    Lease(Lease &&) = default;
+    Lease &operator=(Lease &&other) {
+      _release();
+      _pool = other._pool;
+      _object = std::move(other._object);
+      return *this;
+    }
 
-  std::function<T()> _factory;
+    ~Lease() { _release(); }
 
-  std::mutex _mutex;
-  std::condition_variable _condvar;
+    T *get() const { return _object.get(); }
+    T *operator->() const { return _object.get(); }
+    T &operator*() const { return *_object; }
+    explicit operator bool() const { return (bool)_object; }
+
+  private:
+    Pool *_pool;
+    std::unique_ptr<T> _object;
+
+    void _release() {
+      if (_object)
+        _pool->release(std::move(_object));
+    }
+  };
+
+  Pool(std::function<std::unique_ptr<T>()> factory, size_t size);
 
-public:
   Pool(std::function<T()> factory, size_t size) :
-      _factory(factory), _max_size(size) {}
+      Pool([factory]() { return std::make_unique<T>(factory()); }, size) {}
+
+  /// Destroys the objects in the pool, but not those in use.
+  ~Pool();
+
+  Pool(const Pool &) = delete;
+  Pool &operator=(const Pool &) = delete;
+
+  /// Acquire an object, waiting for one to be released if `size` objects are
+  /// already in use.
+  std::unique_ptr<T> acquire() { return _acquire(std::nullopt); }
 
-  std::unique_ptr<T> acquire();
-  std::unique_ptr<T> acquire(std::chrono::duration<float> timeout);
+  /// Acquire an object, waiting for up to *timeout*. Returns `nullptr` upon
+  /// the timeout.
+  std::unique_ptr<T> acquire(std::chrono::duration<float> timeout) {
+    return _acquire(
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout));
+  }
+
+  /// Acquire an object, released back once the lease is destroyed.
+  Lease lease() { return Lease(*this, acquire()); }
+
+  /// The pool counters since its creation, e.g. to report the pool health.
+  /// The hits are the objects acquired without waiting or creating.
+  struct Stats {
+    /// Acquired from the thread's own magazine.
+    uint64_t hits = 0;
+
+    /// Acquired from the global depot.
+    uint64_t depot_hits = 0;
+
+    /// Stolen from another thread's magazine.
+    uint64_t steals = 0;
+
+    /// The misses, i.e. the objects created by the factory.
+    uint64_t creations = 0;
+
+    /// The acquisitions which had to wait for a release.
+    uint64_t waits = 0;
+
+    /// The waits which have timed out.
+    uint64_t timeouts = 0;
+
+    /// The total time spent waiting.
+    std::chrono::nanoseconds wait_time{0};
+
+    /// The amount of currently created objects.
+    size_t size = 0;
+
+    size_t max_size = 0;
+  };
+
+  /// Sum the counters up. The hot path counters are kept per magazine and
+  /// updated without contention, thus the sum is not an atomic snapshot.
+  Stats stats() const;
 
   /// Put an object back to the pool.
   ///
   /// NOTE: It doesn't check if the object was actually created in this
   /// pool before!
   void release(std::unique_ptr<T>);
+
+private:
+  static constexpr size_t _MagazineSize = 4;
+
+  /// The maximum depot capacity, the objects not fitting are destroyed.
+  static constexpr size_t _MaxDepotSize = 1024;
+
+  /// Accessed by the threads of the same index modulo the amount of
+  /// magazines, usually a single one.
+  struct alignas(64) _Magazine {
+    std::atomic<T *> slots[_MagazineSize] = {};
+
+    /// The slots to start looking from, so that the objects are taken in
+    /// the order they are put.
+    std::atomic<unsigned> get = 0, put = 0;
+
+    /// Counted by the owning threads, see `Stats`.
+    std::atomic<uint64_t> hits = 0, depot_hits = 0, steals = 0;
+  };
+
+  /// A cell of the depot, a bounded multi-producer multi-consumer queue.
+  struct _Cell {
+    std::atomic<size_t> sequence;
+    T *object;
+  };
+
+  std::function<std::unique_ptr<T>()> _factory;
+
+  /// The maximum allowed amount of created objects.
+  const size_t _max_size;
+
+  /// Tracks the total amount of created objects.
+  std::atomic<size_t> _current_size = 0;
+
+  std::unique_ptr<_Magazine[]> _magazines;
+  size_t _magazines_mask;
+
+  std::unique_ptr<_Cell[]> _depot;
+  size_t _depot_mask;
+  alignas(64) std::atomic<size_t> _depot_head = 0;
+  alignas(64) std::atomic<size_t> _depot_tail = 0;
+
+  /// The slow path counters, see `Stats`.
+  alignas(64) std::atomic<uint64_t> _creations = 0;
+  std::atomic<uint64_t> _waits = 0, _timeouts = 0, _wait_ns = 0;
+
+  /// The amount of threads waiting for an object.
+  alignas(64) std::atomic<size_t> _waiters = 0;
+  std::mutex _mutex;
+  std::condition_variable _condvar;
+
+  static size_t _ceil_pow2(size_t value) {
+    size_t result = 1;
+
+    while (result < value)
+      result <<= 1;
+
+    return result;
+  }
+
+  _Magazine &_own_magazine() {
+    static std::atomic<size_t> next_index = 0;
+    thread_local size_t index = next_index++;
+    return _magazines[index & _magazines_mask];
+  }
+
+  static T *_take(_Magazine &);
+  static bool _put(_Magazine &, T *);
+
+  T *_depot_pop();
+  bool _depot_push(T *);
+
+  /// Create an object unless there are `size` of them already.
+  T *_create();
+
+  /// Take an available object, or create one.
+  T *_try_acquire();
+
+  std::unique_ptr<T> _acquire(std::optional<Clock::time_point> deadline);
 };
 
+template <class T>
+Pool<T>::Pool(std::function<std::unique_ptr<T>()> factory, size_t size) :
+    _factory(factory), _max_size(size) {
+  auto magazines =
+      _ceil_pow2(std::max<size_t>(1, std::thread::hardware_concurrency()));
+
+  _magazines = std::make_unique<_Magazine[]>(magazines);
+  _magazines_mask = magazines - 1;
+
+  auto depot = _ceil_pow2(std::clamp<size_t>(size, 1, _MaxDepotSize));
+  _depot = std::make_unique<_Cell[]>(depot);
+  _depot_mask = depot - 1;
+
+  for (size_t i = 0; i < depot; i++)
+    _depot[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <class T> Pool<T>::~Pool() {
+  for (size_t i = 0; i <= _magazines_mask; i++)
+    while (auto object = _take(_magazines[i]))
+      delete object;
+
+  while (auto object = _depot_pop())
+    delete object;
+}
+
+template <class T> typename Pool<T>::Stats Pool<T>::stats() const {
+  Stats stats;
+
+  for (size_t i = 0; i <= _magazines_mask; i++) {
+    auto &magazine = _magazines[i];
+    stats.hits += magazine.hits.load(std::memory_order_relaxed);
+    stats.depot_hits += magazine.depot_hits.load(std::memory_order_relaxed);
+    stats.steals += magazine.steals.load(std::memory_order_relaxed);
+  }
+
+  stats.creations = _creations.load(std::memory_order_relaxed);
+  stats.waits = _waits.load(std::memory_order_relaxed);
+  stats.timeouts = _timeouts.load(std::memory_order_relaxed);
+  stats.wait_time =
+      std::chrono::nanoseconds(_wait_ns.load(std::memory_order_relaxed));
+  stats.size = _current_size.load(std::memory_order_relaxed);
+  stats.max_size = _max_size;
+
+  return stats;
+}
+
+template <class T> void Pool<T>::release(std::unique_ptr<T> object) {
+  auto raw = object.release();
+
+  if (!_put(_own_magazine(), raw) && !_depot_push(raw)) {
+    delete raw;
+    _current_size.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Either a waiter registered by now sees the object, or it is notified.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (_waiters.load(std::memory_order_relaxed)) {
+    // Wait for the waiter to actually wait.
+    std::lock_guard lock(_mutex);
+    _condvar.notify_one();
+  }
+}
+
+template <class T> T *Pool<T>::_take(_Magazine &magazine) {
+  auto start = magazine.get.load(std::memory_order_relaxed);
+
+  for (unsigned i = 0; i < _MagazineSize; i++) {
+    auto index = (start + i) % _MagazineSize;
+    auto &slot = magazine.slots[index];
+
+    if (!slot.load(std::memory_order_relaxed))
+      continue;
+
+    if (auto object = slot.exchange(nullptr, std::memory_order_acquire)) {
+      magazine.get.store(
+          (index + 1) % _MagazineSize, std::memory_order_relaxed);
+      return object;
+    }
+  }
+
+  return nullptr;
+}
+
+template <class T> bool Pool<T>::_put(_Magazine &magazine, T *object) {
+  auto start = magazine.put.load(std::memory_order_relaxed);
+
+  for (unsigned i = 0; i < _MagazineSize; i++) {
+    auto index = (start + i) % _MagazineSize;
+    T *expected = nullptr;
+
+    if (magazine.slots[index].compare_exchange_strong(
+            expected,
+            object,
+            std::memory_order_release,
+            std::memory_order_relaxed)) {
+      magazine.put.store(
+          (index + 1) % _MagazineSize, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <class T> T *Pool<T>::_depot_pop() {
+  auto position = _depot_head.load(std::memory_order_relaxed);
+
+  while (true) {
+    auto &cell = _depot[position & _depot_mask];
+    auto sequence = cell.sequence.load(std::memory_order_acquire);
+    auto difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+    if (difference == 0) {
+      if (_depot_head.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed)) {
+        auto object = cell.object;
+        cell.sequence.store(
+            position + _depot_mask + 1, std::memory_order_release);
+        return object;
+      }
+    } else if (difference < 0)
+      return nullptr; // Empty
+    else
+      position = _depot_head.load(std::memory_order_relaxed);
+  }
+}
+
+template <class T> bool Pool<T>::_depot_push(T *object) {
+  auto position = _depot_tail.load(std::memory_order_relaxed);
+
+  while (true) {
+    auto &cell = _depot[position & _depot_mask];
+    auto sequence = cell.sequence.load(std::memory_order_acquire);
+    auto difference = (intptr_t)sequence - (intptr_t)position;
+
+    if (difference == 0) {
+      if (_depot_tail.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed)) {
+        cell.object = object;
+        cell.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (difference < 0)
+      return false; // Full
+    else
+      position = _depot_tail.load(std::memory_order_relaxed);
+  }
+}
+
+template <class T> T *Pool<T>::_create() {
+  auto size = _current_size.load(std::memory_order_relaxed);
+
+  do {
+    if (size >= _max_size)
+      return nullptr;
+  } while (!_current_size.compare_exchange_weak(
+      size, size + 1, std::memory_order_relaxed));
+
+  try {
+    auto object = _factory().release();
+    _creations.fetch_add(1, std::memory_order_relaxed);
+    return object;
+  } catch (...) {
+    _current_size.fetch_sub(1, std::memory_order_relaxed);
+    throw;
+  }
+}
+
+template <class T> T *Pool<T>::_try_acquire() {
+  auto &own = _own_magazine();
+
+  // Not contended unless the threads share the magazine.
+  auto count = [](std::atomic<uint64_t> &counter) {
+    counter.fetch_add(1, std::memory_order_relaxed);
+  };
+
+  if (auto object = _take(own)) {
+    count(own.hits);
+    return object;
+  }
+
+  if (auto object = _depot_pop()) {
+    count(own.depot_hits);
+    return object;
+  }
+
+  // Stealing is cheaper than creating.
+  for (size_t i = 0; i <= _magazines_mask; i++)
+    if (&_magazines[i] != &own)
+      if (auto object = _take(_magazines[i])) {
+        count(own.steals);
+        return object;
+      }
+
+  return _create();
+}
+
+template <class T>
+std::unique_ptr<T>
+Pool<T>::_acquire(std::optional<Clock::time_point> deadline) {
+  if (auto object = _try_acquire())
+    return std::unique_ptr<T>(object);
+
+  auto start = Clock::now();
+  _waits.fetch_add(1, std::memory_order_relaxed);
+
+  std::unique_lock lock(_mutex);
+  _waiters.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  struct Unregister {
+    Pool &pool;
+    Clock::time_point start;
+
+    ~Unregister() {
+      pool._waiters.fetch_sub(1, std::memory_order_relaxed);
+      pool._wait_ns.fetch_add(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              Clock::now() - start)
+              .count(),
+          std::memory_order_relaxed);
+    }
+  } unregister{*this, start};
+
+  while (true) {
+    if (auto object = _try_acquire())
+      return std::unique_ptr<T>(object);
+
+    if (!deadline)
+      _condvar.wait(lock);
+    else if (
+        _condvar.wait_until(lock, *deadline) == std::cv_status::timeout) {
+      auto object = _try_acquire();
+
+      if (!object)
+        _timeouts.fetch_add(1, std::memory_order_relaxed);
+
+      return std::unique_ptr<T>(object);
+    }
+  }
+}
+
 } // namespace Util
 } // namespace Fancysoft
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cinttypes>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace Fancysoft {
+namespace Util {
+namespace Tar {
+
+struct Error : std::logic_error {
+  Error(const char *msg) : std::logic_error(msg) {}
+};
+
+/// A streaming POSIX ustar archive writer. A member is written to the output
+/// stream as soon as it is added, thus the archive is never kept in memory.
+/// Adding members is thread-safe.
+///
+/// @code{.cpp}
+///   std::ostringstream out;
+///   Tar::Writer tar(out);
+///   tar.add("foo/bar.ll", "; ModuleID = 'bar'");
+///   tar.finish();
+/// @endcode
+class Writer {
+public:
+  Writer(std::ostream &output) : _output(output) {}
+
+  /// Would `finish()` the archive implicitly.
+  ~Writer();
+
+  /// Write a regular file member with *contents* at *path*. The path shall
+  /// fit into 255 bytes, and its last component into 100 bytes. Throws
+  /// `Error` if the path does not fit or the archive is already finished.
+  void add(std::string_view path, std::string_view contents, int64_t mtime = 0);
+
+  /// Write the end-of-archive marker. Further calls are no-op.
+  void finish();
+
+private:
+  std::ostream &_output;
+  std::mutex _mutex;
+  bool _finished = false;
+};
+
+} // namespace Tar
+} // namespace Util
+} // namespace Fancysoft
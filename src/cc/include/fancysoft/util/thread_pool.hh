@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Fancysoft {
+namespace Util {
+
+/// A fixed-size pool of worker threads executing submitted tasks in FIFO
+/// order. Unlike `std::async`, the amount of concurrently running tasks is
+/// bounded regardless of how many are submitted.
+///
+/// @code{.cpp}
+///   ThreadPool pool(4);
+///   auto future = pool.submit([]() { return 42; });
+///   assert(future.get() == 42);
+/// @endcode
+class ThreadPool {
+public:
+  /// Start *size* workers; zero stands for the hardware concurrency.
+  ThreadPool(unsigned size = 0);
+
+  /// Would wait for all the submitted tasks to complete.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// Return the amount of workers.
+  unsigned size() const { return _workers.size(); }
+
+  /// Submit a *task* for execution, returning a future of its result. An
+  /// exception thrown by the task is rethrown from the future.
+  template <typename F> auto submit(F &&task) {
+    using R = std::invoke_result_t<F>;
+
+    auto packaged =
+        std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+
+    auto future = packaged->get_future();
+    _push([packaged]() { (*packaged)(); });
+    return future;
+  }
+
+  /// Wait until the queue is empty and all the workers are idle.
+  void wait();
+
+private:
+  std::vector<std::thread> _workers;
+  std::deque<std::function<void()>> _queue;
+  std::mutex _mutex;
+  std::condition_variable _task_available;
+  std::condition_variable _idle;
+  unsigned _busy = 0;
+  bool _stopping = false;
+
+  void _push(std::function<void()>);
+  void _work();
+};
+
+} // namespace Util
+} // namespace Fancysoft
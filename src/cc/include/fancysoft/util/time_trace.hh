@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "./memory_account.hh"
+#include "./perf_counters.hh"
+
+namespace Fancysoft {
+namespace Util {
+
+/// A scoped timer profiler writing the Chrome trace event format, which is
+/// viewable in `chrome://tracing` or Perfetto, similar to Clang's
+/// `-ftime-trace`. When disabled, a scope costs a single atomic load.
+///
+/// Optionally, the hardware performance counters of the thread are read at
+/// the bounds of each scope, see `PerfCounters`, and so are the allocations
+/// of the thread, see `MemoryAccount`.
+///
+/// @code{.cpp}
+///   time_trace.enable();
+///
+///   {
+///     TimeTrace::Scope scope("Parse", [&]() { return path.string(); });
+///     parse();
+///   }
+///
+///   time_trace.write(json_file);
+///   time_trace.write_summary(std::cerr);
+/// @endcode
+class TimeTrace {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// A completed event.
+  struct Event {
+    /// A static string, e.g. `"Parse"`.
+    const char *name;
+
+    /// An optional detail, e.g. the module path.
+    std::string detail;
+
+    Clock::time_point start;
+    Clock::duration duration;
+
+    /// The performance counter deltas, if enabled and available.
+    std::optional<PerfCounters::Values> counters;
+
+    /// The allocations of the thread within the event, if enabled.
+    std::optional<MemoryAccount::Stats> allocations;
+
+    /// The peak RSS over the process lifetime by the end of the event, if the
+    /// allocations are recorded; thus not specific to the event.
+    uint64_t process_peak_rss = 0;
+  };
+
+  /// Records an event spanning from its construction until its destruction,
+  /// if the trace is enabled upon construction.
+  class Scope {
+  public:
+    /// Begin an event named *name*, which shall have static storage. The
+    /// *detail* is either a string, or a function returning one, so that it
+    /// is only evaluated if the trace is enabled.
+    template <typename D = std::string_view>
+    Scope(const char *name, D &&detail = {}, TimeTrace *trace = nullptr);
+
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    TimeTrace *_trace;
+    const char *_name;
+    std::string _detail;
+    Clock::time_point _start;
+    std::optional<PerfCounters::Values> _start_counters;
+    std::optional<MemoryAccount::Stats> _start_allocations;
+
+    void _begin();
+  };
+
+  TimeTrace();
+
+  /// Start recording events. The timestamps are relative to the first call.
+  /// With *counters*, the performance counters are recorded as well. With
+  /// *memory*, so are the allocations, which enables `MemoryAccount`.
+  void enable(bool counters = false, bool memory = false);
+
+  /// Stop recording events, keeping the recorded ones.
+  void disable() { _enabled.store(false, std::memory_order_relaxed); }
+
+  bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+  /// Drop all the recorded events, and the exited threads.
+  void clear();
+
+  /// Return the reason the performance counters are unavailable in the
+  /// calling thread, if enabled.
+  std::optional<std::string> counters_error();
+
+  /// Write the recorded events as a Chrome trace JSON object, with a track
+  /// per thread.
+  void write(std::ostream &) const;
+
+  /// Write a table of the total, count and average duration per event name,
+  /// sorted by the total duration, along with the total counters if any.
+  void write_summary(std::ostream &) const;
+
+  /// Write the same summary as a JSON array of objects, one per event name.
+  void write_summary_json(std::ostream &) const;
+
+private:
+  /// The events of a single thread, so that no lock is taken upon recording.
+  struct _Thread {
+    uint32_t id;
+
+    /// Only contended by writing or clearing the trace.
+    std::mutex mutex;
+
+    std::vector<Event> events;
+
+    /// Opened by the owning thread if the counters are enabled, and closed
+    /// upon its exit.
+    std::unique_ptr<PerfCounters> counters;
+
+    /// The counters available once opened, kept after they are closed.
+    std::array<bool, PerfCounters::CounterCount> has_counters{};
+
+    /// Set upon the owning thread exit, so that it is pruned once cleared.
+    bool exited = false;
+  };
+
+  /// Unique per instance, unlike the address.
+  const uint64_t _id;
+
+  std::atomic<bool> _enabled = false;
+  std::atomic<bool> _counters_enabled = false;
+  std::atomic<bool> _memory_enabled = false;
+  Clock::time_point _epoch;
+
+  mutable std::mutex _mutex;
+  std::vector<std::shared_ptr<_Thread>> _threads;
+  uint32_t _next_thread_id = 0;
+
+  /// Return the events buffer of the current thread, registering it if not
+  /// yet. The buffer outlives the thread until cleared, as do its events.
+  _Thread &_current_thread();
+
+  void _record(Event);
+
+  /// The events aggregated by name.
+  struct _Total {
+    std::string_view name;
+    size_t count = 0;
+    Clock::duration duration = Clock::duration::zero();
+    PerfCounters::Values counters;
+    MemoryAccount::Stats allocations;
+    uint64_t process_peak_rss = 0;
+  };
+
+  struct _Summary {
+    /// Sorted by the total duration.
+    std::vector<_Total> totals;
+
+    /// The counters available in any thread.
+    std::array<bool, PerfCounters::CounterCount> counters{};
+    bool any_counters = false;
+
+    /// Whether any event has the allocations recorded.
+    bool memory = false;
+  };
+
+  _Summary _summarize() const;
+};
+
+extern TimeTrace time_trace;
+
+template <typename D>
+TimeTrace::Scope::Scope(const char *name, D &&detail, TimeTrace *trace) :
+    _trace(trace ? trace : &time_trace), _name(name) {
+  if (!_trace->enabled()) {
+    _trace = nullptr;
+    return;
+  }
+
+  if constexpr (std::is_invocable_v<D>)
+    _detail = detail();
+  else
+    _detail = std::string(std::string_view(detail));
+
+  _begin();
+}
+
+} // namespace Util
+} // namespace Fancysoft
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace Fancysoft {
+namespace Util {
+
+/// A compact binary event log, cheap enough to keep the trace-level
+/// recording on in production, unlike the textual logging. An event is a
+/// pair of interned static strings (the context, e.g. `"MLIR/_Scope"`, and
+/// the name), a timestamp and a small payload of scalars and short strings.
+/// The events are buffered per thread and written to the file in blocks.
+///
+/// The file is decoded by `read()`, e.g. with `nxc trace-dump`. It is in the
+/// native byte order:
+///
+/// ```
+/// header := "NXCTRACE" u32(version)
+/// string := 'S' u32(id) u16(length) bytes
+/// block  := 'B' u32(thread) u32(size) event*
+/// event  := u32(context) u32(name) u64(ns) u8(payload size) payload
+/// ```
+///
+/// @code{.cpp}
+///   trace_log.open("nxc.trace");
+///   FNXC_TRACE_EVENT("Lexer", "read", code_point, row, col);
+///   trace_log.close();
+/// @endcode
+class TraceLog {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// An interned string id, never zero.
+  using Id = uint32_t;
+
+  static constexpr uint32_t Version = 1;
+
+  /// The maximum payload size; the arguments not fitting are dropped.
+  static constexpr size_t MaxPayload = 255;
+
+  struct Error : std::runtime_error {
+    Error(const std::string &msg) : std::runtime_error(msg) {}
+  };
+
+  /// A decoded payload argument.
+  using Value = std::variant<int64_t, uint64_t, double, char, std::string>;
+
+  /// A decoded event, with the strings only valid within the callback.
+  struct Event {
+    uint32_t thread;
+
+    /// Since the log has been opened.
+    std::chrono::nanoseconds timestamp;
+
+    std::string_view context;
+    std::string_view name;
+    std::vector<Value> args;
+  };
+
+  TraceLog();
+
+  /// Would `close()`.
+  ~TraceLog();
+
+  TraceLog(const TraceLog &) = delete;
+  TraceLog &operator=(const TraceLog &) = delete;
+
+  /// Start recording into the file at *path*, truncating it. Throws `Error`
+  /// if the file could not be opened.
+  void open(const std::filesystem::path &path);
+
+  /// Write all the buffered events and close the file, if open.
+  void close();
+
+  bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+  /// Return the id of *string*, interning it if not yet. The ids are stable
+  /// for the lifetime of the log, and thus may be cached.
+  Id intern(std::string_view string);
+
+  /// Record an event, which is a no-op unless enabled. The *args* are either
+  /// integers, floating points, `char`s or strings.
+  template <typename... Args>
+  void record(Id context, Id name, const Args &...args);
+
+  /// Decode a log from *input*, calling *callback* for each event. The
+  /// events are ordered per thread, but not across threads. Throws `Error`
+  /// upon a malformed input.
+  static void
+  read(std::istream &input, const std::function<void(const Event &)> &callback);
+
+  /// Decode a log from *input* into human-readable lines sorted by time.
+  static void dump(std::istream &input, std::ostream &output);
+
+private:
+  /// The events of a single thread, so that no lock is contended upon
+  /// recording but the file writes.
+  struct _Thread {
+    uint32_t id;
+
+    /// Only contended by closing the log.
+    std::mutex mutex;
+
+    std::vector<char> buffer;
+  };
+
+  /// Unique per instance, unlike the address.
+  const uint64_t _id;
+
+  std::atomic<bool> _enabled = false;
+
+  /// The ticks upon opening, and their rate measured then, see `_now()`.
+  uint64_t _epoch_ticks = 0;
+  double _ns_per_tick = 1;
+
+  /// Guards the file, the strings and the threads.
+  std::mutex _mutex;
+
+  std::ofstream _file;
+  std::unordered_map<std::string, Id> _ids;
+
+  /// Indexed by the id minus one.
+  std::vector<std::string> _strings;
+
+  std::vector<std::shared_ptr<_Thread>> _threads;
+
+  _Thread &_current_thread();
+
+  /// Return the nanoseconds since opened, cheaper than `Clock::now()`.
+  uint64_t _now() const;
+
+  template <typename T>
+  static void _encode(char *payload, size_t &size, const T &arg);
+
+  static void _put(char *payload, size_t &size, const void *data, size_t n) {
+    memcpy(payload + size, data, n);
+    size += n;
+  }
+
+  void _append(Id context, Id name, const char *payload, size_t size);
+
+  /// Write the *thread*'s buffer as a block, expects both locked.
+  void _flush(_Thread &thread);
+
+  void _write_string(Id id, std::string_view string);
+};
+
+extern TraceLog trace_log;
+
+template <typename... Args>
+void TraceLog::record(Id context, Id name, const Args &...args) {
+  if (!enabled())
+    return;
+
+  char payload[MaxPayload];
+  size_t size = 0;
+  (_encode(payload, size, args), ...);
+
+  _append(context, name, payload, size);
+}
+
+template <typename T>
+void TraceLog::_encode(char *payload, size_t &size, const T &arg) {
+  if constexpr (std::is_same_v<T, char>) {
+    if (size + 2 > MaxPayload)
+      return;
+
+    payload[size++] = 'c';
+    payload[size++] = arg;
+  } else if constexpr (std::is_integral_v<T>) {
+    if (size + 9 > MaxPayload)
+      return;
+
+    if constexpr (std::is_signed_v<T>) {
+      int64_t value = arg;
+      payload[size++] = 'i';
+      _put(payload, size, &value, sizeof(value));
+    } else {
+      uint64_t value = arg;
+      payload[size++] = 'u';
+      _put(payload, size, &value, sizeof(value));
+    }
+  } else if constexpr (std::is_floating_point_v<T>) {
+    if (size + 9 > MaxPayload)
+      return;
+
+    double value = arg;
+    payload[size++] = 'd';
+    _put(payload, size, &value, sizeof(value));
+  } else {
+    std::string_view string(arg);
+
+    if (size + 2 > MaxPayload)
+      return;
+
+    // A string is truncated to fit.
+    uint8_t length = std::min(string.size(), MaxPayload - size - 2);
+    payload[size++] = 's';
+    payload[size++] = length;
+    _put(payload, size, string.data(), length);
+  }
+}
+
+} // namespace Util
+} // namespace Fancysoft
+
+/// Record an event into the global trace log. The *CONTEXT* and *NAME* shall
+/// be constant per call site, as they are interned once.
+///
+/// @code{.cpp}
+///   FNXC_TRACE_EVENT("MLIR/_Scope", "compile_var_decl", id);
+/// @endcode
+#define FNXC_TRACE_EVENT(CONTEXT, NAME, ...)                                   \
+  do {                                                                         \
+    if (Fancysoft::Util::trace_log.enabled()) {                                \
+      static const Fancysoft::Util::TraceLog::Id _fnxc_trace_context =        \
+          Fancysoft::Util::trace_log.intern(CONTEXT);                          \
+      static const Fancysoft::Util::TraceLog::Id _fnxc_trace_name =           \
+          Fancysoft::Util::trace_log.intern(NAME);                             \
+      Fancysoft::Util::trace_log.record(                                       \
+          _fnxc_trace_context, _fnxc_trace_name, ##__VA_ARGS__);               \
+    }                                                                          \
+  } while (false)
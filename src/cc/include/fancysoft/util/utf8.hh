@@ -1,9 +1,13 @@
 #pragma once
 
+#include <array>
+#include <bit>
 #include <cinttypes>
 #include <cstddef>
+#include <span>
 #include <stdexcept>
 #include <stdint.h>
+#include <string_view>
 
 namespace Fancysoft {
 namespace Util {
@@ -13,6 +17,50 @@ struct Error : std::logic_error {
   Error(const char *msg) : std::logic_error(msg) {}
 };
 
+namespace Detail {
+
+/// The payload bits of a leading code unit by the sequence size.
+inline constexpr uint8_t lead_mask[5] = {0, 0x7f, 0x1f, 0x0f, 0x07};
+
+/// The marker bits of a leading code unit by the sequence size.
+inline constexpr uint8_t lead_marker[5] = {0, 0x00, 0xc0, 0xe0, 0xf0};
+
+/// The sequence size by the count of a code unit's leading one bits,
+/// zero for a continuation byte and more than four.
+inline constexpr uint8_t size_by_leading_ones[9] = {
+    1, 0, 2, 3, 4, 0, 0, 0, 0};
+
+/// The encoded size by the bit width of a code point, zero if too
+/// wide. Note that U+110000 to U+1FFFFF still fit four code units.
+inline constexpr auto size_by_bit_width = []() {
+  std::array<uint8_t, 33> sizes = {};
+
+  for (unsigned width = 0; width < sizes.size(); width++)
+    sizes[width] = width <= 7    ? 1
+                   : width <= 11 ? 2
+                   : width <= 16 ? 3
+                   : width <= 21 ? 4
+                                 : 0;
+
+  return sizes;
+}();
+
+/// The well-formed sequence size by a leading code unit, see
+/// `sequence_size`.
+inline constexpr auto sequence_sizes = []() {
+  std::array<uint8_t, 256> sizes = {};
+
+  for (unsigned lead = 0; lead < 256; lead++)
+    sizes[lead] =
+        lead == 0xc0 || lead == 0xc1 || lead >= 0xf5
+            ? 0
+            : size_by_leading_ones[std::countl_one((uint8_t)lead)];
+
+  return sizes;
+}();
+
+} // namespace Detail
+
 /// Return the amount of bytes needed to encode a code point.
 ///
 /// @code{.cpp}
@@ -43,6 +91,70 @@ char8_t *to_code_units(char32_t code_point);
 /// @endcode
 char32_t to_code_point(const char8_t *code_units);
 
+/// Return the size of a well-formed sequence beginning with the
+/// *lead* code unit, or zero if it may not begin one (a continuation
+/// byte, an overlong C0/C1 or F5+). Unlike `size_from_leading_byte`,
+/// it never throws.
+///
+/// @code{.cpp}
+///   CHECK(UTF8::sequence_size(0xc3) == 2);
+///   CHECK(UTF8::sequence_size(0xb6) == 0);
+/// @endcode
+constexpr size_t sequence_size(char8_t lead) {
+  return Detail::sequence_sizes[lead];
+}
+
+/// Return the code point of a *size* code units long sequence,
+/// assuming it is well-formed, e.g. `validate`d.
+constexpr char32_t decode_sequence(const char8_t *units, size_t size) {
+  char32_t code_point = units[0] & Detail::lead_mask[size];
+
+  for (size_t i = 1; i < size; i++)
+    code_point = code_point << 6 | (units[i] & 0x3f);
+
+  return code_point;
+}
+
+/// Return the offset of the first ill-formed sequence in *string*,
+/// or its size if it is valid UTF-8. Overlong encodings, surrogates
+/// and code points above U+10FFFF are ill-formed. ASCII runs are
+/// checked 32 bytes at a time.
+///
+/// @code{.cpp}
+///   CHECK(UTF8::validate("ö") == 2);
+///   CHECK(UTF8::validate("a\\xc0\\x80") == 1);
+/// @endcode
+size_t validate(std::string_view string);
+
+/// Return the amount of code points in `validate`d *units*, i.e. the
+/// amount of bytes other than continuation ones.
+///
+/// @code{.cpp}
+///   CHECK(UTF8::count_code_points(std::u8string_view(u8"aö")) == 2);
+/// @endcode
+size_t count_code_points(std::span<const char8_t> units);
+
+/// Decode `validate`d *units* into *out*, which shall fit
+/// `count_code_points(units)`, returning the amount written.
+/// An invalid leading byte is decoded as U+FFFD.
+///
+/// @code{.cpp}
+///   char32_t out[2];
+///   CHECK(UTF8::decode_n(std::u8string_view(u8"aö"), out) == 2);
+/// @endcode
+size_t decode_n(std::span<const char8_t> units, std::span<char32_t> out);
+
+/// Encode *code_points* into *out*, which shall fit their encoded
+/// size, returning the amount of code units written. A code point
+/// above U+10FFFF is encoded as U+FFFD.
+///
+/// @code{.cpp}
+///   char8_t out[3];
+///   CHECK(UTF8::encode_n(std::u32string_view(U"aö"), out) == 3);
+/// @endcode
+size_t
+encode_n(std::span<const char32_t> code_points, std::span<char8_t> out);
+
 } // namespace UTF8
 } // namespace Util
 } // namespace Fancysoft
@@ -24,7 +24,7 @@ Fancysoft::Util::Logger setup_default_logger() {
     verbosity = Fancysoft::Util::Logger::Verbosity::Debug;
 #else
     // For release builds, the WARN level is the default one.
-    verbosity = Fancysoft::Util::Logger::Verbosity::WARN;
+    verbosity = Fancysoft::Util::Logger::Verbosity::Warn;
 #endif
   }
 
@@ -36,6 +36,11 @@ Fancysoft::Util::Logger Fancysoft::Util::logger = setup_default_logger();
 int main(int argc, const char *argv[]) {
   Fancysoft::Util::logger.enable_thread_id_output = false;
   Fancysoft::Util::logger.enable_time_output = false;
+  Fancysoft::Util::logger.start_async();
+
   Fancysoft::NXC::CLI cli{};
-  return cli.run(argc, argv);
+  auto result = cli.run(argc, argv);
+
+  Fancysoft::Util::logger.stop_async();
+  return result;
 }
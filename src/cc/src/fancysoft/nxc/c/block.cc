@@ -11,6 +11,10 @@ Position Block::parse() {
   auto lexer = std::make_shared<Lexer>(shared_from_this());
   Parser parser(lexer);
   _ast = std::move(parser.parse(true));
+
+  for (auto &panic : parser.panics())
+    _panics.push_back(panic);
+
   _parsed = true;
   return lexer->cursor();
 }
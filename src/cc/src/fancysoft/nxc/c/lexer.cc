@@ -28,7 +28,7 @@ Util::Coro::Generator<Token::Any> Lexer::lex() noexcept {
         std::stringbuf buf;
 
         while (_is_latin_lowercase() || _is('_') || _is_decimal()) {
-          buf.sputc(_code_point);
+          _append_code_point(buf);
           _advance();
         }
 
@@ -43,7 +43,7 @@ Util::Coro::Generator<Token::Any> Lexer::lex() noexcept {
         std::stringbuf buf;
 
         while (_is_op()) {
-          buf.sputc(_code_point);
+          _append_code_point(buf);
           _advance();
         }
 
@@ -75,8 +75,8 @@ Util::Coro::Generator<Token::Any> Lexer::lex() noexcept {
         continue;
       }
     } while (!_is_eof());
-  } catch (std::exception &e) {
-    _exception = e;
+  } catch (std::exception &) {
+    _exception = std::current_exception();
     co_return;
   }
 }
@@ -14,80 +14,94 @@ std::unique_ptr<AST> Parser::parse(bool single_expression) {
   auto ast = std::make_unique<AST>();
 
   while (!_lexer_done() && (!single_expression || !an_expression_parsed)) {
-    if (_is_punct(Token::Punct::HSpace)) {
-      _advance();
-      continue;
-    }
+    try {
+      if (_is_punct(Token::Punct::HSpace)) {
+        _advance();
+        continue;
+      }
 
-    else if (_is<Token::Id>()) {
-      auto initial_type_ref = _parse_type_ref();
+      else if (_is<Token::Id>()) {
+        auto initial_type_ref = _parse_type_ref();
 
-      if (_is_punct(Token::Punct::HSpace)) {
-        // That's a function declaration.
-        //
+        if (_is_punct(Token::Punct::HSpace)) {
+          // That's a function declaration.
+          //
 
-        _advance(); // Consume the space
+          _advance(); // Consume the space
 
-        auto function_id_token = _as<Token::Id>();
-        _advance(); // Consume the function id token
+          auto function_id_token = _as<Token::Id>();
+          _advance(); // Consume the function id token
 
-        _as_open_paren();
-        _advance(); // Consue the opening parenthesis
+          _as_open_paren();
+          _advance(); // Consue the opening parenthesis
 
-        std::vector<std::shared_ptr<AST::FuncDecl::ArgDecl>> args;
+          std::vector<std::shared_ptr<AST::FuncDecl::ArgDecl>> args;
 
-        while (_is<Token::Id>()) {
-          args.push_back(_parse_arg_decl());
+          while (_is<Token::Id>()) {
+            args.push_back(_parse_arg_decl());
 
-          if (_is_comma()) {
-            _advance();
-            continue;
-          } else if (_is_close_paren()) {
-            _advance();
-            break;
-          } else {
-            throw _unexpected("comma or closing parenthesis");
+            if (_is_comma()) {
+              _advance();
+              continue;
+            } else if (_is_close_paren()) {
+              _advance();
+              break;
+            } else {
+              throw _unexpected("comma or closing parenthesis");
+            }
           }
-        }
 
-        _as_semi();
+          _as_semi();
 
-        auto node = std::make_shared<AST::FuncDecl>(
-            initial_type_ref, function_id_token, args);
+          auto node = std::make_shared<AST::FuncDecl>(
+              initial_type_ref, function_id_token, args);
 
-        _debug_parsed(node->node_name());
-        ast->add_child(node);
+          _debug_parsed(node->node_name());
+          ast->add_child(node);
 
-        if (!single_expression) {
-          _advance();
-        }
+          if (!single_expression) {
+            _advance();
+          }
 
-        an_expression_parsed = true;
-        continue;
+          an_expression_parsed = true;
+          continue;
+        } else {
+          throw _unexpected();
+        }
       } else {
         throw _unexpected();
       }
-    } else {
-      throw _unexpected();
+    } catch (Panic &panic) {
+      _recover(panic);
+      _synchronize(single_expression);
+
+      // The erroneous declaration counts as parsed.
+      an_expression_parsed = true;
     }
   }
 
-  auto &log = Util::logger.debug(_debug_name());
-  log << "Done parsing due to ";
-
-  if (_lexer_done()) {
-    log << "lexer depletion";
-  } else if (an_expression_parsed) {
-    log << "single expression parsed";
-  } else {
+  if (!_lexer_done() && !an_expression_parsed)
     throw "Unreacheable";
-  }
 
-  log << std::endl;
+  FNXC_DEBUG(_debug_name())
+      << "Done parsing due to "
+      << (_lexer_done() ? "lexer depletion" : "single expression parsed")
+      << std::endl;
 
+  _recover_lexer();
   return ast;
 }
 
+void Parser::_synchronize(bool single_expression) {
+  // As in C, a missing semicolon makes the declaration span what follows.
+  while (!_lexer_done() && !_is_punct(Token::Punct::Semi))
+    _advance();
+
+  // The semicolon is consumed as it would be if parsed.
+  if (!single_expression && !_lexer_done())
+    _advance();
+}
+
 std::shared_ptr<AST::TypeRef> Parser::_parse_type_ref() {
   auto id = _as<Token::Id>();
   _advance();
@@ -1,20 +1,54 @@
 #include <filesystem>
 #include <fstream>
+#include <map>
 #include <optional>
 #include <ostream>
 #include <regex>
+#include <set>
 #include <variant>
 
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_os_ostream.h>
+
 #include "fancysoft/nxc/cli.hh"
 #include "fancysoft/nxc/exception.hh"
+#include "fancysoft/nxc/lsp.hh"
+#include "fancysoft/nxc/onyx/file.hh"
 #include "fancysoft/nxc/target.hh"
 #include "fancysoft/nxc/workspace.hh"
 #include "fancysoft/util/cli.hh"
 #include "fancysoft/util/logger.hh"
+#include "fancysoft/util/time_trace.hh"
+#include "fancysoft/util/trace_log.hh"
 #include "fancysoft/util/variant.hh"
 
 namespace Fancysoft::NXC {
 
+namespace {
+
+/// Return the default path of the executable compiled from *input*.
+std::filesystem::path
+default_exe_path(std::filesystem::path input, Target::ObjectFileFormat format) {
+  auto path = input;
+
+  switch (format) {
+  case Target::ObjectFileFormat::COFF:
+    path.replace_extension(".exe");
+    break;
+  case Target::ObjectFileFormat::ELF:
+    path.replace_extension();
+    break;
+  }
+
+  // E.g. an extensionless ELF input, which shall not be overwritten.
+  if (path == input)
+    path += ".out";
+
+  return path;
+}
+
+} // namespace
+
 int CLI::run(int argc, const char **argv) noexcept {
   std::string progname = std::filesystem::path(argv[0]).filename().string();
 
@@ -25,12 +59,25 @@ int CLI::run(int argc, const char **argv) noexcept {
         return 0;
       }
 
-      for (auto &cmd : {Compile()}) {
-        if (cmd.detect(argv[1])) {
-          Util::logger.trace("CLI") << "Detected command: " << cmd.name << "\n";
+      const Compile compile(_program_cache);
+      const Run run;
+      const Build build;
+      const Daemon daemon;
+      const TraceDump trace_dump;
+      const LanguageServer lsp;
+
+      for (const Util::CLI::Command *cmd :
+           {static_cast<const Util::CLI::Command *>(&compile),
+            static_cast<const Util::CLI::Command *>(&run),
+            static_cast<const Util::CLI::Command *>(&build),
+            static_cast<const Util::CLI::Command *>(&daemon),
+            static_cast<const Util::CLI::Command *>(&trace_dump),
+            static_cast<const Util::CLI::Command *>(&lsp)}) {
+        if (cmd->detect(argv[1])) {
+          FNXC_TRACE("CLI") << "Detected command: " << cmd->name << "\n";
 
           try {
-            return cmd.exec(argc - 2, argv + 2, progname);
+            return cmd->exec(argc - 2, argv + 2, progname);
           } catch (Util::CLI::Error e) {
             std::cerr << e.what() << "\n";
             return 1;
@@ -46,12 +93,19 @@ int CLI::run(int argc, const char **argv) noexcept {
       _display_help(progname, "v0");
       return 0;
     }
-  } catch (char *s) {
+  } catch (const char *s) {
     std::cerr << s << "\n";
-    exit(1);
+    return 1;
   } catch (std::string s) {
     std::cerr << s << "\n";
-    exit(1);
+    return 1;
+  } catch (const std::exception &e) {
+    // E.g. a filesystem error, which shall not terminate a daemon.
+    std::cerr << e.what() << "\n";
+    return 1;
+  } catch (...) {
+    std::cerr << "Unknown error\n";
+    return 1;
   }
 }
 
@@ -64,20 +118,50 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
   const static std::regex output_flag_regex("\\/o([\\w\\.\\/-]+)?$");
   const static char *no_output_param = "/no-output";
 
-  const static char *emit_exe_param = "/emit=exe";
-  const static char *emit_mlir_param = "/emit=mlir";
-  const static char *emit_llir_param = "/emit=llir";
+  const static std::regex emit_param_regex("\\/emit=(\\w+)(?::(\\w+))?$");
   const static char *no_emit_param = "/no-emit";
 
-  const static char *emit_exe_flag = "/exe";
-  const static char *emit_mlir_flag = "/emlir";
-  const static char *emit_llir_flag = "/ellir";
+  const static std::map<std::string, Emit> emit_flags = {
+      {"/exe", Emit::Exe},
+      {"/emlir", Emit::MLIR},
+      {"/ellir", Emit::LLIR},
+      {"/ebc", Emit::BC},
+  };
 
   const static std::regex cache_param_regex("\\/cache=([\\w\\.\\/-]+)$");
   const static std::regex cache_flag_regex("\\/C([\\w\\.\\/-]+)$");
   const static char *no_cache_param = "/no-cache";
 
+  const static std::regex target_param_regex("\\/target=([\\w\\.-]+)$");
+  const static std::regex target_flag_regex("\\/t([\\w\\.-]+)$");
+  const static std::regex cpu_param_regex("\\/cpu=([\\w\\.-]+)$");
+  const static std::regex feature_flag_regex("\\/m([+-]?[\\w\\.-]+)$");
+  const static std::regex opt_flag_regex("\\/O([0-3])$");
+  const static char *low_memory_param = "/low-memory";
+  const static char *no_daemon_param = "/no-daemon";
+
 #else
+  const static std::regex output_param_regex("--output(?:=([\\w\\.\\/-]+))?$");
+  const static std::regex output_flag_regex("-o([\\w\\.\\/-]+)?$");
+  const static char *no_output_param = "--no-output";
+
+  const static std::regex emit_param_regex("--emit=(\\w+)(?::(\\w+))?$");
+  const static char *no_emit_param = "--no-emit";
+
+  // There are no emit shortcuts on POSIX.
+  const static std::map<std::string, Emit> emit_flags = {};
+
+  const static std::regex cache_param_regex("--cache=([\\w\\.\\/-]+)$");
+  const static std::regex cache_flag_regex("-C([\\w\\.\\/-]+)$");
+  const static char *no_cache_param = "--no-cache";
+
+  const static std::regex target_param_regex("--target=([\\w\\.-]+)$");
+  const static std::regex target_flag_regex("-t([\\w\\.-]+)$");
+  const static std::regex cpu_param_regex("--cpu=([\\w\\.-]+)$");
+  const static std::regex feature_flag_regex("-m([+-]?[\\w\\.-]+)$");
+  const static std::regex opt_flag_regex("-O([0-3])$");
+  const static char *low_memory_param = "--low-memory";
+  const static char *no_daemon_param = "--no-daemon";
 #endif
 
   std::cmatch regex_matches;
@@ -86,11 +170,11 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
   for (int i = 0; i < argc; i++) {
     // TODO: If unsupported flag (begins with /)
 
-    Util::logger.trace("CLI") << "Parsing arg " << argv[i] << "\n";
+    FNXC_TRACE("CLI") << "Parsing arg " << argv[i] << "\n";
 
     // A help request.
     if (Util::CLI::is_help(argv[i])) {
-      Util::logger.trace("CLI") << "Requested compile help\n";
+      FNXC_TRACE("CLI") << "Requested compile help\n";
       return latest_help_request;
     }
 
@@ -106,7 +190,7 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
         if (path.empty())
           throw Util::CLI::Error("Output path shall not be empty");
 
-        Util::logger.trace("CLI") << "Set `output` to " << path << "\n";
+        FNXC_TRACE("CLI") << "Set `output` to " << path << "\n";
         _output = path;
       }
 
@@ -118,47 +202,58 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
       if (this->_output.has_value()) {
         throw Util::CLI::Error("Already specified the output option");
       } else {
-        Util::logger.trace("CLI") << "Set `output` to stdout\n";
+        FNXC_TRACE("CLI") << "Set `output` to stdout\n";
         _output = std::monostate();
       }
 
       latest_help_request = HelpRequest::Output;
     }
 
-    // The "emit executable" option.
-    else if (
-        !strcmp(argv[i], emit_exe_param) || !strcmp(argv[i], emit_exe_flag)) {
+    // The "emit" option, with an optional IR output format.
+    else if (std::regex_match(argv[i], regex_matches, emit_param_regex)) {
       if (this->_emit.has_value())
         throw Util::CLI::Error("Already specified the emit option");
-      else {
-        Util::logger.trace("CLI") << "Set `emit` to `exe`\n";
-        _emit = Emit::Exe;
-      }
 
-      latest_help_request = HelpRequest::Emit;
-    }
+      auto emit = regex_matches[1].str();
 
-    // The "emit MLIR" option.
-    else if (
-        !strcmp(argv[i], emit_mlir_param) || !strcmp(argv[i], emit_mlir_flag)) {
-      if (this->_emit.has_value())
-        throw Util::CLI::Error("Already specified the emit option");
-      else {
-        Util::logger.trace("CLI") << "Set `emit` to `mlir`\n";
+      if (emit == "exe")
+        _emit = Emit::Exe;
+      else if (emit == "mlir")
         _emit = Emit::MLIR;
+      else if (emit == "llir")
+        _emit = Emit::LLIR;
+      else if (emit == "bc")
+        _emit = Emit::BC;
+      else
+        throw Util::CLI::Error("Unknown emit option value `" + emit + "`");
+
+      FNXC_TRACE("CLI") << "Set `emit` to `" << emit << "`\n";
+
+      if (regex_matches[2].matched) {
+        auto format = regex_matches[2].str();
+
+        if (emit == "exe")
+          throw Util::CLI::Error("An executable has no output format");
+        else if (format == "raw")
+          _ir_format = Program::IROutputFormat::Raw;
+        else if (format == "tar")
+          _ir_format = Program::IROutputFormat::Tar;
+        else
+          throw Util::CLI::Error("Unknown IR output format `" + format + "`");
+
+        FNXC_TRACE("CLI") << "Set `IR format` to `" << format << "`\n";
       }
 
       latest_help_request = HelpRequest::Emit;
     }
 
-    // The "emit LLIR" option.
-    else if (
-        !strcmp(argv[i], emit_llir_param) || !strcmp(argv[i], emit_llir_flag)) {
+    // An "emit" option shortcut.
+    else if (emit_flags.contains(argv[i])) {
       if (this->_emit.has_value())
         throw Util::CLI::Error("Already specified the emit option");
       else {
-        Util::logger.trace("CLI") << "Set `emit` to `llir`\n";
-        _emit = Emit::LLIR;
+        FNXC_TRACE("CLI") << "Set `emit` via " << argv[i] << "\n";
+        _emit = emit_flags.at(argv[i]);
       }
 
       latest_help_request = HelpRequest::Emit;
@@ -169,7 +264,7 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
       if (this->_emit.has_value())
         throw Util::CLI::Error("Already specified the emit option");
       else {
-        Util::logger.trace("CLI") << "Set `emit` to `none`\n";
+        FNXC_TRACE("CLI") << "Set `emit` to `none`\n";
         _emit = std::monostate();
       }
 
@@ -188,7 +283,7 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
         if (path.empty())
           throw Util::CLI::Error("Cache path shall not be empty");
 
-        Util::logger.trace("CLI") << "Set `cache` to " << path << "\n";
+        FNXC_TRACE("CLI") << "Set `cache` to " << path << "\n";
         _cache = path;
       }
 
@@ -200,18 +295,124 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
       if (this->_cache.has_value())
         throw Util::CLI::Error("Already specified the cache option");
       else {
-        Util::logger.trace("CLI") << "Set `cache` to `none`\n";
+        FNXC_TRACE("CLI") << "Set `cache` to `none`\n";
         _cache = std::monostate();
       }
 
       latest_help_request = HelpRequest::Cache;
     }
 
+    // The "time trace" option. Matched ahead of the target flag, which would
+    // match `/time-trace` on Windows otherwise (as well as `/trace-log`).
+    else if (auto path = CLI::_try_parse_time_trace(argv[i])) {
+      if (this->_time_trace.has_value())
+        throw Util::CLI::Error("Already specified the time trace option");
+      else {
+        FNXC_TRACE("CLI") << "Set `time trace` to " << *path << "\n";
+        _time_trace = path;
+      }
+
+      latest_help_request = HelpRequest::General;
+    }
+
+    // The "trace log" option.
+    else if (auto path = CLI::_try_parse_trace_log(argv[i])) {
+      if (this->_trace_log.has_value())
+        throw Util::CLI::Error("Already specified the trace log option");
+      else {
+        FNXC_TRACE("CLI") << "Set `trace log` to " << *path << "\n";
+        _trace_log = path;
+      }
+
+      latest_help_request = HelpRequest::General;
+    }
+
+    // The "target" option.
+    else if (
+        std::regex_match(argv[i], regex_matches, target_param_regex) ||
+        std::regex_match(argv[i], regex_matches, target_flag_regex)) {
+      if (this->_target_triple.has_value())
+        throw Util::CLI::Error("Already specified the target option");
+      else {
+        auto triple = regex_matches[1].str();
+        FNXC_TRACE("CLI") << "Set `target` to " << triple << "\n";
+        _target_triple = triple;
+      }
+
+      latest_help_request = HelpRequest::Target;
+    }
+
+    // The "target CPU" option.
+    else if (std::regex_match(argv[i], regex_matches, cpu_param_regex)) {
+      if (this->_target_cpu.has_value())
+        throw Util::CLI::Error("Already specified the CPU option");
+      else {
+        auto cpu = regex_matches[1].str();
+        FNXC_TRACE("CLI") << "Set `cpu` to " << cpu << "\n";
+        _target_cpu = cpu;
+      }
+
+      latest_help_request = HelpRequest::Target;
+    }
+
+    // A "target feature" option, may be repeated.
+    else if (std::regex_match(argv[i], regex_matches, feature_flag_regex)) {
+      auto feature = regex_matches[1].str();
+
+      // A feature is enabled unless explicitly prefixed with `-`.
+      if (feature[0] != '+' && feature[0] != '-')
+        feature = '+' + feature;
+
+      FNXC_TRACE("CLI") << "Add target feature " << feature << "\n";
+      _target_features.push_back(feature);
+
+      latest_help_request = HelpRequest::Target;
+    }
+
+    // The "low memory" option.
+    else if (!strcmp(argv[i], low_memory_param)) {
+      FNXC_TRACE("CLI") << "Set `low memory` to `true`\n";
+      _low_memory = true;
+      latest_help_request = HelpRequest::General;
+    }
+
+    // The "no daemon" option.
+    else if (!strcmp(argv[i], no_daemon_param)) {
+      FNXC_TRACE("CLI") << "Set `no daemon` to `true`\n";
+      _no_daemon = true;
+      latest_help_request = HelpRequest::General;
+    }
+
+    // The "stats" option.
+    else if (auto format = CLI::_try_parse_stats(argv[i])) {
+      if (this->_stats.has_value())
+        throw Util::CLI::Error("Already specified the stats option");
+      else {
+        FNXC_TRACE("CLI") << "Set `stats`\n";
+        _stats = format;
+      }
+
+      latest_help_request = HelpRequest::General;
+    }
+
+    // The "optimization level" option.
+    else if (std::regex_match(argv[i], regex_matches, opt_flag_regex)) {
+      if (this->_opt_level.has_value())
+        throw Util::CLI::Error("Already specified the optimization level");
+      else {
+        auto level = std::stoul(regex_matches[1].str());
+        FNXC_TRACE("CLI") << "Set `opt level` to " << level << "\n";
+        _opt_level = level;
+      }
+
+      latest_help_request = HelpRequest::General;
+    }
+
     else if (auto v = CLI::_try_parse_verbosity(argv[i])) {
       if (this->_logger_verbosity.has_value())
         throw Util::CLI::Error("Already specified the logger verbosity option");
       else {
-        Util::logger.trace("CLI")
+        FNXC_TRACE("CLI")
             << "Set `logger verbosity` to "
             << Util::Logger::verbosity_to_string(v.value()) << "\n";
 
@@ -231,7 +432,7 @@ CLI::Compile::Payload::parse(int argc, const char **argv) {
         if (path.empty())
           throw Util::CLI::Error("Input path shall not be empty");
 
-        Util::logger.trace("CLI") << "Set `input` to " << path << "\n";
+        FNXC_TRACE("CLI") << "Set `input` to " << path << "\n";
         _input = path;
       }
 
@@ -256,6 +457,16 @@ int CLI::Compile::exec(
     return 0;
   }
 
+  // Unless being the daemon, let a running daemon do the job.
+  if (!_program_cache && !payload.no_daemon()) {
+    std::vector<std::string> args = {"compile"};
+    args.insert(args.end(), argv, argv + argc);
+
+    if (auto code = NXC::Daemon::forward(
+            NXC::Daemon::default_socket_path(), args))
+      return *code;
+  }
+
   auto input = payload.input();
 
   std::optional<std::filesystem::path> cache;
@@ -282,6 +493,20 @@ int CLI::Compile::exec(
   } else
     emit = Payload::Emit::Exe; // Emit an executable by default
 
+  auto ir_format = payload.ir_format().value_or(Program::IROutputFormat::Raw);
+
+  auto target = Target();
+  target.triple = payload.target_triple().value_or(Target::default_triple());
+  target.object_file_format = Target::object_file_format_of(target.triple);
+  target.cpu = payload.target_cpu().value_or("generic");
+
+  for (auto &feature : payload.target_features()) {
+    if (!target.features.empty())
+      target.features += ',';
+
+    target.features += feature;
+  }
+
   std::variant<std::filesystem::path, std::ostream *, std::monostate> output;
 
   if (emit.has_value()) {
@@ -299,7 +524,7 @@ int CLI::Compile::exec(
 
       switch (emit.value()) {
       case Payload::Emit::Exe:
-        output = path.replace_extension(".exe");
+        output = default_exe_path(path, target.object_file_format);
         break;
       case Payload::Emit::MLIR:
         output = path.replace_extension(".ml");
@@ -307,7 +532,14 @@ int CLI::Compile::exec(
       case Payload::Emit::LLIR:
         output = path.replace_extension(".ll");
         break;
+      case Payload::Emit::BC:
+        output = path.replace_extension(".bc");
+        break;
       }
+
+      // E.g. `main.ll.tar`.
+      if (ir_format == Program::IROutputFormat::Tar)
+        std::get<std::filesystem::path>(output) += ".tar";
     }
   } else {
     // Emitting is explicitly disabled...
@@ -336,16 +568,56 @@ int CLI::Compile::exec(
     }
   }
 
+  std::optional<_TimeTraceOutput> time_trace_output;
+
+  if (payload.time_trace() || payload.stats()) {
+    auto input_path = payload.input();
+    auto path = payload.time_trace();
+
+    if (path && path->empty())
+      path = std::filesystem::path(input_path).replace_extension(
+          ".time-trace.json");
+
+    time_trace_output.emplace(
+        path, payload.stats(), input_path.replace_extension(".stats.json"));
+  }
+
+  std::optional<_TraceLogOutput> trace_log_output;
+
+  if (auto path = payload.trace_log()) {
+    if (path->empty())
+      path = std::filesystem::path(payload.input()).replace_extension(".trace");
+
+    trace_log_output.emplace(*path);
+  }
+
   auto workspace = std::make_shared<Workspace>();
   workspace->root = std::filesystem::current_path();
   workspace->cache_dir = cache;
 
   Program::CompilationContext context;
-  context.target = Target();
-  context.target.object_file_format = Target::ObjectFileFormat::COFF;
+  context.target = target;
   context.entry_path = payload.input();
+  context.opt_level = payload.opt_level().value_or(0);
+  context.low_memory = payload.low_memory();
 
-  auto program = Program(context, workspace);
+  std::shared_ptr<Program> program;
+
+  if (_program_cache) {
+    // The last compilation stage, which the low-memory mode depends on.
+    std::string_view stage = "mlir";
+
+    if (emit == Payload::Emit::Exe)
+      stage = "obj";
+    else if (emit == Payload::Emit::LLIR || emit == Payload::Emit::BC)
+      stage = "llir";
+
+    program = _program_cache->get(context, workspace, stage);
+  } else
+    program = std::make_shared<Program>(context, workspace);
+
+  if (time_trace_output)
+    time_trace_output->programs.push_back(program);
 
   try {
     if (emit.has_value()) {
@@ -353,7 +625,7 @@ int CLI::Compile::exec(
       case Payload::Emit::Exe: {
         if (auto path = std::get_if<std::filesystem::path>(&output))
           try {
-            program.emit_exe(*path, {}, {});
+            program->emit_exe(*path, {}, {});
           } catch (LinkerFailure e) {
             Util::logger.error("Linker") << "Linkage failed:\n" << e.what();
             return 1;
@@ -365,37 +637,673 @@ int CLI::Compile::exec(
       }
       case Payload::Emit::MLIR: {
         if (std::get_if<std::monostate>(&output))
-          program.compile_mlir();
+          program->compile_mlir();
         else
-          program.emit_mlir(
+          program->emit_mlir(
               Util::Variant::downcast<
                   std::variant<std::filesystem::path, std::ostream *>>(output),
-              Program::IROutputFormat::Raw);
+              ir_format);
 
         break;
       }
       case Payload::Emit::LLIR:
         if (std::get_if<std::monostate>(&output))
-          program.compile_llir();
+          program->compile_llir();
         else
-          program.emit_llir(
+          program->emit_llir(
               Util::Variant::downcast<
                   std::variant<std::filesystem::path, std::ostream *>>(output),
-              Program::IROutputFormat::Raw);
+              ir_format);
+
+        break;
+      case Payload::Emit::BC:
+        if (std::get_if<std::monostate>(&output))
+          program->compile_llir();
+        else
+          program->emit_bc(
+              Util::Variant::downcast<
+                  std::variant<std::filesystem::path, std::ostream *>>(output),
+              ir_format);
 
         break;
       }
     } else {
-      program.compile_mlir();
+      program->compile_mlir();
     }
-  } catch (Panic panic) {
+  } catch (Panic &panic) {
+    // A partially compiled program shall not be reused.
+    if (_program_cache)
+      _program_cache->erase(program);
+
     _print(panic);
     return 1;
+  } catch (...) {
+    if (_program_cache)
+      _program_cache->erase(program);
+
+    throw;
   }
 
   return 0;
 }
 
+bool CLI::Run::Payload::parse(int argc, const char **argv) {
+  assert(!_parsed);
+
+  for (int i = 0; i < argc; i++) {
+    FNXC_TRACE("CLI") << "Parsing arg " << argv[i] << "\n";
+
+    // A help request.
+    if (Util::CLI::is_help(argv[i])) {
+      FNXC_TRACE("CLI") << "Requested run help\n";
+      return true;
+    }
+
+    // The rest of the arguments are passed to the program.
+    else if (!strcmp(argv[i], "--")) {
+      _program_args.assign(argv + i + 1, argv + argc);
+      break;
+    }
+
+    else if (auto v = CLI::_try_parse_verbosity(argv[i])) {
+      if (this->_logger_verbosity.has_value())
+        throw Util::CLI::Error("Already specified the logger verbosity option");
+      else
+        this->_logger_verbosity = v;
+    }
+
+    // Input path, the only positional argument.
+    else {
+      if (_input.has_value())
+        throw Util::CLI::Error("Already specified the input path");
+      else {
+        std::filesystem::path path(argv[i]);
+
+        if (path.empty())
+          throw Util::CLI::Error("Input path shall not be empty");
+
+        FNXC_TRACE("CLI") << "Set `input` to " << path << "\n";
+        _input = path;
+      }
+    }
+  }
+
+  if (!_input.has_value())
+    throw Util::CLI::Error("Missing input path");
+
+  _parsed = true;
+  return false;
+}
+
+int CLI::Run::exec(
+    int argc, const char **argv, const std::string progname) const {
+  auto payload = Payload();
+
+  if (payload.parse(argc, argv)) {
+    _display_help(progname);
+    return 0;
+  }
+
+  auto workspace = std::make_shared<Workspace>();
+  workspace->root = std::filesystem::current_path();
+
+  // The program runs on the host, thus making use of all its features.
+  auto target = Target();
+  target.triple = Target::default_triple();
+  target.object_file_format = Target::object_file_format_of(target.triple);
+  target.cpu = "native";
+
+  Program::CompilationContext context;
+  context.target = target;
+  context.entry_path = payload.input();
+
+  auto program = Program(context, workspace);
+
+  try {
+    return program.run(payload.program_args());
+  } catch (Panic &panic) {
+    _print(panic);
+    return 1;
+  }
+}
+
+void CLI::Run::_display_help(const std::string progname) const {
+  fmt::print(
+      std::cout,
+#ifdef _WIN32
+      "{0} run - Compile an Onyx program just-in-time and run it\n"
+      "\n"
+      "The program is compiled for the host machine in memory, lazily: a "
+      "function is only compiled upon its first call. No files are written."
+      "\n"
+      "\n"
+      "Usage:\n"
+      "\n"
+      "{0} run <file> [options] [-- <program arguments>]\n"
+      "{0} r <file> [options] [-- <program arguments>]\n"
+      "\n"
+      "Options:\n"
+      "\n"
+      "  /v<level>       Set verbosity level explicitly\n"
+      "  /?, /help, /h   Display help\n",
+#else
+      "{0} run - Compile an Onyx program just-in-time and run it\n"
+      "\n"
+      "The program is compiled for the host machine in memory, lazily: a "
+      "function is only compiled upon its first call. No files are written."
+      "\n"
+      "\n"
+      "Usage:\n"
+      "\n"
+      "{0} run <file> [options] [-- <program arguments>]\n"
+      "\n"
+      "Options:\n"
+      "\n"
+      "  -v<level>       Set verbosity level explicitly\n"
+      "  --help, -h      Display help\n",
+#endif
+      progname);
+}
+
+int CLI::Build::exec(
+    int argc, const char **argv, const std::string progname) const {
+#ifdef _WIN32
+  const static std::regex jobs_param_regex("\\/jobs=(\\d+)$");
+  const static std::regex jobs_flag_regex("\\/j(\\d+)$");
+  const static std::regex cache_param_regex("\\/cache=([\\w\\.\\/-]+)$");
+  const static char *no_cache_param = "/no-cache";
+  const static std::regex target_param_regex("\\/target=([\\w\\.-]+)$");
+  const static std::regex cpu_param_regex("\\/cpu=([\\w\\.-]+)$");
+  const static std::regex opt_flag_regex("\\/O([0-3])$");
+  const static char *low_memory_param = "/low-memory";
+#else
+  const static std::regex jobs_param_regex("--jobs=(\\d+)$");
+  const static std::regex jobs_flag_regex("-j(\\d+)$");
+  const static std::regex cache_param_regex("--cache=([\\w\\.\\/-]+)$");
+  const static char *no_cache_param = "--no-cache";
+  const static std::regex target_param_regex("--target=([\\w\\.-]+)$");
+  const static std::regex cpu_param_regex("--cpu=([\\w\\.-]+)$");
+  const static std::regex opt_flag_regex("-O([0-3])$");
+  const static char *low_memory_param = "--low-memory";
+#endif
+
+  std::cmatch regex_matches;
+  std::vector<std::filesystem::path> inputs;
+  unsigned jobs = 0;
+  unsigned opt_level = 0;
+  std::optional<std::filesystem::path> time_trace;
+  std::optional<std::filesystem::path> trace_log;
+  std::optional<_StatsFormat> stats;
+  bool low_memory = false;
+  bool no_cache = false;
+
+  auto workspace = std::make_shared<Workspace>();
+  workspace->root = std::filesystem::current_path();
+  workspace->cache_dir = std::filesystem::current_path() / "./.fnxccache/";
+
+  auto target = Target();
+  target.triple = Target::default_triple();
+
+  for (int i = 0; i < argc; i++) {
+    if (Util::CLI::is_help(argv[i])) {
+      _display_help(progname);
+      return 0;
+    } else if (
+        std::regex_match(argv[i], regex_matches, jobs_param_regex) ||
+        std::regex_match(argv[i], regex_matches, jobs_flag_regex)) {
+      jobs = std::stoul(regex_matches[1].str());
+    } else if (std::regex_match(argv[i], regex_matches, cache_param_regex)) {
+      workspace->cache_dir = regex_matches[1].str();
+    } else if (!strcmp(argv[i], no_cache_param)) {
+      no_cache = true;
+    } else if (std::regex_match(argv[i], regex_matches, target_param_regex)) {
+      target.triple = regex_matches[1].str();
+    } else if (std::regex_match(argv[i], regex_matches, cpu_param_regex)) {
+      target.cpu = regex_matches[1].str();
+    } else if (std::regex_match(argv[i], regex_matches, opt_flag_regex)) {
+      opt_level = std::stoul(regex_matches[1].str());
+    } else if (auto path = CLI::_try_parse_time_trace(argv[i])) {
+      time_trace = path;
+    } else if (auto path = CLI::_try_parse_trace_log(argv[i])) {
+      trace_log = path;
+    } else if (auto format = CLI::_try_parse_stats(argv[i])) {
+      stats = format;
+    } else if (!strcmp(argv[i], low_memory_param)) {
+      low_memory = true;
+    } else if (CLI::_try_parse_verbosity(argv[i])) {
+      // Accepted for consistency with the other commands.
+    } else {
+      std::filesystem::path path(argv[i]);
+
+      if (path.empty())
+        throw Util::CLI::Error("Input path shall not be empty");
+
+      inputs.push_back(path);
+    }
+  }
+
+  if (inputs.empty())
+    throw Util::CLI::Error("Missing input paths");
+
+  if (no_cache)
+    workspace->cache_dir.reset();
+
+  target.object_file_format = Target::object_file_format_of(target.triple);
+
+  std::vector<Workspace::Executable> executables;
+
+  for (auto &input : inputs) {
+    Program::CompilationContext context;
+    context.target = target;
+    context.entry_path = input;
+    context.opt_level = opt_level;
+    context.low_memory = low_memory;
+
+    auto exe_path = default_exe_path(input, target.object_file_format);
+
+    executables.push_back(Workspace::Executable{
+        std::make_shared<Program>(context, workspace), exe_path, {}, {}});
+  }
+
+  std::optional<_TimeTraceOutput> time_trace_output;
+
+  if (time_trace || stats) {
+    if (time_trace && time_trace->empty())
+      time_trace = "build.time-trace.json";
+
+    time_trace_output.emplace(time_trace, stats, "build.stats.json");
+
+    for (auto &executable : executables)
+      time_trace_output->programs.push_back(executable.program);
+  }
+
+  std::optional<_TraceLogOutput> trace_log_output;
+
+  if (trace_log)
+    trace_log_output.emplace(trace_log->empty() ? "build.trace" : *trace_log);
+
+  auto errors = workspace->build(executables, jobs);
+  int exit_code = 0;
+
+  for (size_t i = 0; i < errors.size(); i++) {
+    if (!errors[i])
+      continue;
+
+    exit_code = 1;
+    Util::logger.error("CLI") << "Failed to build " << inputs[i] << "\n";
+
+    try {
+      std::rethrow_exception(errors[i]);
+    } catch (Panic &panic) {
+      _print(panic);
+    } catch (LinkerFailure e) {
+      Util::logger.error("Linker") << "Linkage failed:\n" << e.what();
+    } catch (const char *e) {
+      std::cerr << e << "\n";
+    } catch (const std::string &e) {
+      std::cerr << e << "\n";
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << "\n";
+    }
+  }
+
+  return exit_code;
+}
+
+void CLI::Build::_display_help(const std::string progname) const {
+  fmt::print(
+      std::cout,
+#ifdef _WIN32
+      "{0} build - Build multiple Onyx programs at once\n"
+      "\n"
+      "Each input is an entry of its own executable, named after it. The "
+      "programs are built in parallel, and the modules they have in common "
+      "are only compiled once."
+      "\n"
+      "\n"
+      "Usage:\n"
+      "\n"
+      "{0} build <file>... [options]\n"
+      "{0} b <file>... [options]\n"
+      "\n"
+      "Options:\n"
+      "\n"
+      "  /jobs=<n>, /j<n>  Set the amount of parallel jobs; the amount of "
+      "hardware threads by default\n"
+      "  /cache=<path>     Set the cache directory\n"
+      "  /no-cache         Disable caching\n"
+      "  /target=<triple>  Set the target triple\n"
+      "  /cpu=<cpu>        Set the target CPU\n"
+      "  /O<level>         Set the optimization level, 0 to 3\n"
+      "  /time-trace[=<path>]\n"
+      "                    Write a Chrome trace of the compilation phases; "
+      "`build.time-trace.json` by default\n"
+      "  /trace-log[=<path>]\n"
+      "                    Record the binary trace log, `build.trace` by "
+      "default; see `{0} trace-dump`\n"
+      "  /stats[=json]     Print the compilation phases statistics, including "
+      "the hardware performance counters where available and the memory "
+      "usage; or write them to `build.stats.json`\n"
+      "  /low-memory       Release each module's intermediate representations "
+      "as soon as possible to lower the peak memory usage\n"
+      "  /v<level>         Set verbosity level explicitly\n"
+      "  /?, /help, /h     Display help\n",
+#else
+      "{0} build - Build multiple Onyx programs at once\n"
+      "\n"
+      "Each input is an entry of its own executable, named after it. The "
+      "programs are built in parallel, and the modules they have in common "
+      "are only compiled once."
+      "\n"
+      "\n"
+      "Usage:\n"
+      "\n"
+      "{0} build <file>... [options]\n"
+      "\n"
+      "Options:\n"
+      "\n"
+      "  --jobs=<n>, -j<n>  Set the amount of parallel jobs; the amount of "
+      "hardware threads by default\n"
+      "  --cache=<path>     Set the cache directory\n"
+      "  --no-cache         Disable caching\n"
+      "  --target=<triple>  Set the target triple\n"
+      "  --cpu=<cpu>        Set the target CPU\n"
+      "  -O<level>          Set the optimization level, 0 to 3\n"
+      "  --time-trace[=<path>]\n"
+      "                     Write a Chrome trace of the compilation phases; "
+      "`build.time-trace.json` by default\n"
+      "  --trace-log[=<path>]\n"
+      "                     Record the binary trace log, `build.trace` by "
+      "default; see `{0} trace-dump`\n"
+      "  --stats[=json]     Print the compilation phases statistics, including "
+      "the hardware performance counters where available and the memory "
+      "usage; or write them to `build.stats.json`\n"
+      "  --low-memory       Release each module's intermediate representations "
+      "as soon as possible to lower the peak memory usage\n"
+      "  -v<level>          Set verbosity level explicitly\n"
+      "  --help, -h         Display help\n",
+#endif
+      progname);
+}
+
+int CLI::Daemon::exec(
+    int argc, const char **argv, const std::string progname) const {
+#ifdef _WIN32
+  const static std::regex socket_param_regex("\\/socket=(.+)$");
+#else
+  const static std::regex socket_param_regex("--socket=(.+)$");
+#endif
+
+  std::cmatch regex_matches;
+  std::optional<std::filesystem::path> socket_path;
+
+  for (int i = 0; i < argc; i++) {
+    if (Util::CLI::is_help(argv[i])) {
+      _display_help(progname);
+      return 0;
+    } else if (std::regex_match(argv[i], regex_matches, socket_param_regex)) {
+      if (socket_path.has_value())
+        throw Util::CLI::Error("Already specified the socket option");
+
+      socket_path = regex_matches[1].str();
+    } else if (!CLI::_try_parse_verbosity(argv[i]))
+      throw Util::CLI::Error(
+          std::string("Unrecognized daemon option `") + argv[i] + "`");
+  }
+
+  NXC::Daemon daemon(socket_path.value_or(NXC::Daemon::default_socket_path()));
+  daemon.listen();
+}
+
+void CLI::Daemon::_display_help(const std::string progname) const {
+  fmt::print(
+      std::cout,
+#ifdef _WIN32
+      "{0} daemon - Launch a daemon instance\n"
+      "\n"
+      "The daemon keeps programs compiled in memory, so that a repeated "
+      "compilation only redoes the work affected by source modifications. "
+      "Once a daemon is running, `{0} compile` forwards requests to it."
+      "\n"
+      "\n"
+      "Usage:\n"
+      "\n"
+      "{0} daemon [options]\n"
+      "\n"
+      "Options:\n"
+      "\n"
+      "  /socket=<path>  Set the socket path\n"
+      "  /?, /help, /h   Display help\n",
+#else
+      "{0} daemon - Launch a daemon instance\n"
+      "\n"
+      "The daemon keeps programs compiled in memory, so that a repeated "
+      "compilation only redoes the work affected by source modifications. "
+      "Once a daemon is running, `{0} compile` forwards requests to it, "
+      "unless `--no-daemon` is set or the daemon is of another build."
+      "\n"
+      "\n"
+      "Usage:\n"
+      "\n"
+      "{0} daemon [options]\n"
+      "\n"
+      "Options:\n"
+      "\n"
+      "  --socket=<path>  Set the Unix socket path; `$FNXC_DAEMON_SOCKET`, "
+      "`$XDG_RUNTIME_DIR/fnxc.sock` or `/tmp/fnxc-<uid>.sock` by default\n"
+      "  --help, -h       Display help\n",
+#endif
+      progname);
+}
+
+int CLI::TraceDump::exec(
+    int argc, const char **argv, const std::string progname) const {
+  std::optional<std::filesystem::path> input;
+
+  for (int i = 0; i < argc; i++) {
+    if (Util::CLI::is_help(argv[i])) {
+      _display_help(progname);
+      return 0;
+    } else if (input.has_value())
+      throw Util::CLI::Error(
+          std::string("Unrecognized trace-dump option `") + argv[i] + "`");
+    else
+      input = argv[i];
+  }
+
+  if (!input.has_value())
+    throw Util::CLI::Error("Missing input path");
+
+  std::ifstream file(*input, std::ios::binary);
+
+  if (!file)
+    throw Util::CLI::Error("Could not open " + input->string());
+
+  try {
+    Util::TraceLog::dump(file, std::cout);
+  } catch (const Util::TraceLog::Error &e) {
+    throw Util::CLI::Error(e.what());
+  }
+
+  return 0;
+}
+
+void CLI::TraceDump::_display_help(const std::string progname) const {
+  fmt::print(
+      std::cout,
+      "{0} trace-dump - Decode a binary trace log\n"
+      "\n"
+      "The log is recorded by `{0} compile` or `{0} build` with the "
+      "trace-log option. The events are printed one per line, ordered by "
+      "time, as `[<seconds>][@<thread>][<context>] <name> <args>...`.\n"
+      "\n"
+      "Usage:\n"
+      "\n"
+      "{0} trace-dump <file>\n",
+      progname);
+}
+
+int CLI::LanguageServer::exec(
+    int argc, const char **argv, const std::string progname) const {
+  for (int i = 0; i < argc; i++) {
+    if (Util::CLI::is_help(argv[i])) {
+      fmt::print(
+          std::cout,
+          "{0} lsp - Launch the Onyx LSP instance\n"
+          "\n"
+          "The server communicates via stdio. Besides the standard methods, "
+          "it answers the `fnxc/stats` request with the edit latency "
+          "percentiles.\n"
+          "\n"
+          "Usage:\n"
+          "\n"
+          "{0} lsp\n",
+          progname);
+
+      return 0;
+    } else if (!CLI::_try_parse_verbosity(argv[i]))
+      throw Util::CLI::Error(
+          std::string("Unrecognized lsp option `") + argv[i] + "`");
+  }
+
+  return NXC::LSP::Server(std::cin, std::cout).run();
+}
+
+std::optional<std::filesystem::path>
+CLI::_try_parse_time_trace(const char *arg) {
+#ifdef _WIN32
+  const static std::regex regex("\\/time-trace(?:=(.+))?$");
+#else
+  const static std::regex regex("--time-trace(?:=(.+))?$");
+#endif
+
+  std::cmatch regex_matches;
+
+  if (std::regex_match(arg, regex_matches, regex))
+    return std::filesystem::path(regex_matches[1].str());
+  else
+    return std::nullopt;
+}
+
+std::optional<std::filesystem::path>
+CLI::_try_parse_trace_log(const char *arg) {
+#ifdef _WIN32
+  const static std::regex regex("\\/trace-log(?:=(.+))?$");
+#else
+  const static std::regex regex("--trace-log(?:=(.+))?$");
+#endif
+
+  std::cmatch regex_matches;
+
+  if (std::regex_match(arg, regex_matches, regex))
+    return std::filesystem::path(regex_matches[1].str());
+  else
+    return std::nullopt;
+}
+
+std::optional<CLI::_StatsFormat> CLI::_try_parse_stats(const char *arg) {
+#ifdef _WIN32
+  const static std::regex regex("\\/stats(?:=(text|json))?$");
+#else
+  const static std::regex regex("--stats(?:=(text|json))?$");
+#endif
+
+  std::cmatch regex_matches;
+
+  if (!std::regex_match(arg, regex_matches, regex))
+    return std::nullopt;
+  else if (regex_matches[1].str() == "json")
+    return _StatsFormat::JSON;
+  else
+    return _StatsFormat::Text;
+}
+
+CLI::_TimeTraceOutput::_TimeTraceOutput(
+    std::optional<std::filesystem::path> path,
+    std::optional<_StatsFormat> stats,
+    std::filesystem::path stats_path) :
+    path(path), stats(stats), stats_path(stats_path) {
+  Util::time_trace.clear();
+  Util::time_trace.enable(stats.has_value(), stats.has_value());
+
+  if (auto error = Util::time_trace.counters_error())
+    Util::logger.warn("CLI") << "Performance counters are unavailable: "
+                             << *error << "\n";
+}
+
+CLI::_TimeTraceOutput::~_TimeTraceOutput() {
+  Util::time_trace.disable();
+  Util::MemoryAccount::disable();
+
+  if (path) {
+    std::ofstream file(*path, std::ios::trunc);
+
+    if (file) {
+      Util::time_trace.write(file);
+      Util::logger.info("CLI") << "Written time trace to " << *path << "\n";
+    } else
+      Util::logger.error("CLI")
+          << "Failed to write time trace to " << *path << "\n";
+  }
+
+  if (stats != _StatsFormat::JSON) {
+    Util::logger.flush();
+    Util::time_trace.write_summary(std::cerr);
+    return;
+  }
+
+  // A module may be shared by multiple programs.
+  std::set<Module *> reported;
+  llvm::json::Array modules;
+
+  for (auto &program : programs)
+    for (auto &module : program->modules()) {
+      if (!reported.insert(module.get()).second)
+        continue;
+
+      auto memory = module->memory.stats();
+
+      modules.push_back(llvm::json::Object{
+          {"path", module->path.string()},
+          {"allocations", int64_t(memory.allocations)},
+          {"allocated_bytes", int64_t(memory.allocated_bytes)},
+          {"live_bytes", memory.live_bytes},
+          {"peak_bytes", memory.peak_bytes}});
+    }
+
+  std::ofstream file(stats_path, std::ios::trunc);
+
+  if (!file) {
+    Util::logger.error("CLI")
+        << "Failed to write stats to " << stats_path << "\n";
+
+    return;
+  }
+
+  file << "{\"peak_rss\":" << Util::MemoryAccount::peak_rss()
+       << ",\"phases\":";
+
+  Util::time_trace.write_summary_json(file);
+
+  {
+    llvm::raw_os_ostream stream(file);
+    stream << ",\"modules\":" << llvm::json::Value(std::move(modules));
+  }
+
+  file << "}\n";
+  Util::logger.info("CLI") << "Written stats to " << stats_path << "\n";
+}
+
+CLI::_TraceLogOutput::_TraceLogOutput(const std::filesystem::path &path) {
+  try {
+    Util::trace_log.open(path);
+  } catch (const Util::TraceLog::Error &e) {
+    throw Util::CLI::Error(e.what());
+  }
+}
+
+CLI::_TraceLogOutput::~_TraceLogOutput() { Util::trace_log.close(); }
+
 std::optional<Util::Logger::Verbosity>
 CLI::_try_parse_verbosity(const char *arg) {
 #ifdef _WIN32
@@ -406,7 +1314,12 @@ CLI::_try_parse_verbosity(const char *arg) {
   const static std::regex v_explicit_level_regex(
       "\\/v(T|D|I|W|E|F|N|t|d|i|w|e|f|n)$");
 #else
-#error Not implemented
+  const static std::regex v_fancy_regex("-(v{1,3})$");
+  const static std::regex q_fancy_regex("-(q{1,3})$");
+
+  const static std::regex v_explicit_index_regex("-v(\\d)$");
+  const static std::regex v_explicit_level_regex(
+      "-v(T|D|I|W|E|F|N|t|d|i|w|e|f|n)$");
 #endif
 
   std::cmatch regex_matches;
@@ -476,6 +1389,7 @@ void CLI::Compile::_display_help(
         "\n"
         "  /emit=mlir      Emit Onyx MLIR into a single folder\n"
         "  /emit=llir      Emit LLIR into a single folder\n"
+        "  /emit=bc        Emit LLVM bitcode into a single folder\n"
         "  /no-emit        Do not emit anything\n"
         "\n"
         "  /cache=<dir>    Specify cache directory path\n"
@@ -486,10 +1400,23 @@ void CLI::Compile::_display_help(
         "  /O2             Fairly balanced optimization, no debug\n"
         "  /O3             Apply maximum performance optimization\n"
         "\n"
+        "  /time-trace[=<path>]\n"
+        "                  Write a Chrome trace of the compilation phases, "
+        "`<input>.time-trace.json` by default, and print a summary\n"
+        "  /trace-log[=<path>]\n"
+        "                  Record the binary trace log, `<input>.trace` by "
+        "default; see `{0} trace-dump`\n"
+        "  /stats[=json]   Print the compilation phases statistics, including "
+        "the hardware performance counters where available and the memory "
+        "usage; or write them to `<input>.stats.json`\n"
+        "  /low-memory     Release each module's intermediate representations "
+        "as soon as possible to lower the peak memory usage\n"
+        "\n"
         "  /M<path>        Add an Onyx module import lookup path\n"
         "  /R<path>        Add an Onyx macro require lookup path\n"
         "\n"
         "  /t<target>      Set the compilation target triple\n"
+        "  /cpu=<cpu>      Set the compilation target CPU\n"
         "  /m<feature>     Set a compilation target feature\n"
         "\n"
         "  /D<value>       Define a C preprocessor macro\n"
@@ -554,7 +1481,8 @@ void CLI::Compile::_display_help(
         "\n"
         "The output format may be specified after a colon, e.g. "
         "`/emit=mlir:tar`; implicitly `raw` by default. The `raw` format "
-        "separates modules with 0x1c (file separator).\n"
+        "separates modules with 0x1c (file separator). The `tar` format "
+        "writes a tarball with a member per module, e.g. `<input>.ll.tar`.\n"
         "\n"
         "Usage:\n"
         "\n"
@@ -562,7 +1490,8 @@ void CLI::Compile::_display_help(
         "\n"
         "  /emit=exe,  /exe    Emit a single executable (default)\n"
         "  /emit=mlir, /emlir  Emit MLIR modules\n"
-        "  /emit=llir, /ellir  Emit LLIR modules\n",
+        "  /emit=llir, /ellir  Emit LLIR modules\n"
+        "  /emit=bc,   /ebc    Emit LLVM bitcode modules\n",
         progname);
     break;
   case Payload::HelpRequest::Cache:
@@ -579,6 +1508,28 @@ void CLI::Compile::_display_help(
         "  /no-cache                Disable caching completely\n",
         progname);
     break;
+  case Payload::HelpRequest::Target:
+    fmt::print(
+        std::cout,
+        "{0} compile /target - Set the compilation target\n"
+        "\n"
+        "By default, a program is compiled for a generic CPU of the "
+        "`x86_64-pc-win32-msvc` target. Objects compiled for different "
+        "targets are cached separately.\n"
+        "\n"
+        "Usage:\n"
+        "\n"
+        "  /target=<triple>, /t<triple>  Set the target triple\n"
+        "  /cpu=<cpu>                    Set the target CPU, e.g. `skylake`\n"
+        "    The special `native` value stands for the host CPU, including "
+        "all of its features.\n"
+        "  /m<feature>                   Enable a target feature, e.g. "
+        "`/mavx2`\n"
+        "  /m+<feature>, /m-<feature>    Enable or disable a target feature\n"
+        "    The option may be repeated. Explicit features take precedence "
+        "over the `native` ones.\n",
+        progname);
+    break;
   case Payload::HelpRequest::LoggerVerbosity:
     fmt::print(
         std::cout,
@@ -612,6 +1563,147 @@ void CLI::Compile::_display_help(
     break;
   }
 #else
+  switch (request) {
+  case Payload::HelpRequest::General:
+    fmt::print(
+        std::cout,
+        "{0} compile - Compile an Onyx program\n"
+        "\n"
+        "Usage:\n"
+        "\n"
+        "{0} compile <file> [options]\n"
+        "\n"
+        "Options:\n"
+        "\n"
+        "  --output=<file>, -o<file>  Specify output file path\n"
+        "  --output, -o               Output the build to stdout\n"
+        "  --no-output                Do not output anywhere\n"
+        "\n"
+        "  --emit=mlir                Emit Onyx MLIR\n"
+        "  --emit=llir                Emit LLIR\n"
+        "  --emit=bc                  Emit LLVM bitcode\n"
+        "  --no-emit                  Do not emit anything\n"
+        "\n"
+        "  --cache=<dir>, -C<dir>     Specify cache directory path\n"
+        "  --no-cache                 Disable caching completely\n"
+        "\n"
+        "  --target=<triple>, -t<triple>\n"
+        "                             Set the compilation target triple\n"
+        "  --cpu=<cpu>                Set the compilation target CPU\n"
+        "  -m<feature>                Set a compilation target feature\n"
+        "\n"
+        "  -O0                        Do not optimize (default)\n"
+        "  -O1, -O2, -O3              Optimize, from the least to the most\n"
+        "\n"
+        "  --time-trace[=<path>]      Write a Chrome trace of the compilation "
+        "phases, `<input>.time-trace.json` by default, and print a summary\n"
+        "  --trace-log[=<path>]       Record the binary trace log, "
+        "`<input>.trace` by default; see `{0} trace-dump`\n"
+        "  --stats[=json]             Print the compilation phases statistics, "
+        "including the hardware performance counters where available and the "
+        "memory usage; or write them to `<input>.stats.json`\n"
+        "  --low-memory               Release each module's intermediate "
+        "representations as soon as possible to lower the peak memory usage\n"
+        "  --no-daemon                Compile in-process even if a daemon is "
+        "running; see `{0} daemon`\n"
+        "\n"
+        "  -v, -vv, -vvv              Increase logging verbosity\n"
+        "  -q, -qq, -qqq              Decrease logging verbosity\n"
+        "  -v<level>                  Set verbosity level explicitly\n"
+        "\n"
+        "  --help, -h                 Display help\n",
+        progname);
+    break;
+  case Payload::HelpRequest::Output:
+    fmt::print(
+        std::cout,
+        "{0} compile --output - Specify output for compilation\n"
+        "\n"
+        "By default, a compiled program contents is written to a file at "
+        "`<input>` without extension for ELF targets, or `<input>.exe` for "
+        "COFF targets.\n"
+        "\n"
+        "Usage:\n"
+        "\n"
+        "  --output=<path>, -o<path>  Specify the output file path\n"
+        "  --output,        -o        Output to stdout\n"
+        "  --no-output                Disable the output compeletely\n",
+        progname);
+    break;
+  case Payload::HelpRequest::Emit:
+    fmt::print(
+        std::cout,
+        "{0} compile --emit - Set what's being emitted as a compilation "
+        "result\n"
+        "\n"
+        "By default, an Onyx program is written into a single executable "
+        "file in format defined by the compilation target.\n"
+        "\n"
+        "The IR output format may be specified after a colon, e.g. "
+        "`--emit=llir:tar`; implicitly `raw` by default. The `raw` format "
+        "separates modules with 0x1c (file separator). The `tar` format "
+        "writes a tarball with a member per module, e.g. `<input>.ll.tar`.\n"
+        "\n"
+        "Usage:\n"
+        "\n"
+        "  --emit=<emit format>[:<output format>]\n"
+        "\n"
+        "  --emit=exe   Emit a single executable (default)\n"
+        "  --emit=mlir  Emit MLIR modules\n"
+        "  --emit=llir  Emit LLIR modules\n"
+        "  --emit=bc    Emit LLVM bitcode modules\n",
+        progname);
+    break;
+  case Payload::HelpRequest::Cache:
+    fmt::print(
+        std::cout,
+        "{0} compile --cache - Set the directory for storing cache\n"
+        "\n"
+        "By default, the cache folder is `<pwd>/.fnxcache/`.\n"
+        "\n"
+        "Usage:\n"
+        "\n"
+        "  --cache=<path>, -C<path>  Specify the cache folder\n"
+        "  --no-cache                Disable caching completely\n",
+        progname);
+    break;
+  case Payload::HelpRequest::Target:
+    fmt::print(
+        std::cout,
+        "{0} compile --target - Set the compilation target\n"
+        "\n"
+        "By default, a program is compiled for a generic CPU of the host "
+        "target triple. ELF executables are linked against the host C "
+        "runtime (glibc, or musl for `*-linux-musl` triples).\n"
+        "\n"
+        "Usage:\n"
+        "\n"
+        "  --target=<triple>, -t<triple>  Set the target triple\n"
+        "  --cpu=<cpu>                    Set the target CPU, e.g. `native`\n"
+        "  -m<feature>                    Enable a target feature, e.g. "
+        "`-mavx2`\n"
+        "  -m+<feature>, -m-<feature>     Enable or disable a target "
+        "feature\n",
+        progname);
+    break;
+  case Payload::HelpRequest::LoggerVerbosity:
+    fmt::print(
+        std::cout,
+        "{0} compile -v - Set the logger verbosity\n"
+        "\n"
+        "Usage:\n"
+        "\n"
+        "  -v<L>  Where L is the desired verbosity level, e.g. `-vD` or `-v1`\n"
+        "\n"
+        "  -v     Set level to INFO (WARN - 1)\n"
+        "  -vv    Set level to DEBUG (WARN - 2)\n"
+        "  -vvv   Set level to TRACE (WARN - 3)\n"
+        "  -q     Set level to ERROR (WARN + 1)\n"
+        "  -qq    Set level to FATAL (WARN + 2)\n"
+        "  -qqq   Set level to NONE (WARN + 3)\n",
+        progname);
+    break;
+  }
 #endif
 };
 
@@ -626,8 +1718,13 @@ void CLI::_display_help(const std::string progname, const std::string version) {
       "Available commands:\n"
       "\n"
       "  compile <file>  Compile an Onyx program\n"
+      "  run <file>      Compile and run an Onyx program in-process\n"
+      "  build <file>... Build multiple Onyx programs at once\n"
       "  format <file>   Format an Onyx source file\n"
       "  daemon          Launch a daemon instance\n"
+      "  trace-dump <file>\n"
+      "                  Decode a binary trace log\n"
+      "  lsp             Launch the Onyx LSP instance\n"
       "\n"
       "  version         Print the compiler version\n"
       "  license         Print the license information\n"
@@ -641,13 +1738,18 @@ void CLI::_display_help(const std::string progname, const std::string version) {
       "Commands:\n"
       "\n"
       "  compile <file>  Compile an Onyx program\n"
+      "  run <file>      Compile and run an Onyx program in-process\n"
+      "  build <file>... Build multiple Onyx programs at once\n"
       "  parse <file>    Parse an Onyx source file AST\n"
       "  format <file>   Format an Onyx source file\n"
+      "  daemon          Launch a daemon instance\n"
+      "  trace-dump <file>\n"
+      "                  Decode a binary trace log\n"
       "  lsp             Launch the Onyx LSP instance\n"
       "\n"
       "Options:\n"
       "\n"
-      "  --help, -h      Display context-aware help\n";
+      "  --help, -h      Display context-aware help\n"
 #endif
       ,
       version,
@@ -0,0 +1,507 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+
+#include <fmt/format.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "fancysoft/nxc/cli.hh"
+#include "fancysoft/nxc/daemon.hh"
+#include "fancysoft/util/logger.hh"
+
+namespace Fancysoft::NXC {
+
+std::shared_ptr<Program> ProgramCache::get(
+    Program::CompilationContext ctx,
+    std::shared_ptr<Workspace> workspace,
+    std::string_view stage) {
+  auto entry_path = std::filesystem::absolute(ctx.entry_path);
+
+  // The target is not resolved yet, so that `native` is a part of the key.
+  auto key = fmt::format(
+      "{}\n{}\n{}\n{}\n{}\n{}\n{}",
+      entry_path.string(),
+      workspace->cache_dir.value_or("").string(),
+      ctx.target.triple,
+      ctx.target.cpu,
+      ctx.target.features,
+      ctx.opt_level,
+      ctx.low_memory ? stage : "");
+
+  auto found = _programs.find(key);
+
+  if (found != _programs.end()) {
+    if (found->second->refresh())
+      FNXC_DEBUG("Daemon") << "Refreshed program " << entry_path << "\n";
+    else
+      FNXC_DEBUG("Daemon") << "Reusing program " << entry_path << "\n";
+
+    return found->second;
+  }
+
+  FNXC_DEBUG("Daemon") << "Creating program " << entry_path << "\n";
+  ctx.entry_path = entry_path;
+  auto program = std::make_shared<Program>(ctx, workspace);
+  _programs[key] = program;
+
+  return program;
+}
+
+void ProgramCache::erase(const std::shared_ptr<Program> &program) {
+  std::erase_if(
+      _programs, [&program](auto &pair) { return pair.second == program; });
+}
+
+std::vector<std::shared_ptr<Workspace>> ProgramCache::workspaces() const {
+  std::vector<std::shared_ptr<Workspace>> result;
+
+  for (auto &[key, program] : _programs)
+    if (std::find(result.begin(), result.end(), program->workspace) ==
+        result.end())
+      result.push_back(program->workspace);
+
+  return result;
+}
+
+void Daemon::_report_pools() {
+  for (auto &workspace : _programs.workspaces()) {
+    for (auto &llvm_target : workspace->llvm_targets()) {
+      auto stats = llvm_target->target_machines.stats();
+
+      FNXC_DEBUG("Daemon") << fmt::format(
+          "Target machines of {} ({}): {}/{} created, {} hits, {} depot "
+          "hits, {} steals, {} waits ({:.3f}s), {} timeouts\n",
+          llvm_target->target_triple,
+          workspace->root.string(),
+          stats.size,
+          stats.max_size,
+          stats.hits,
+          stats.depot_hits,
+          stats.steals,
+          stats.waits,
+          std::chrono::duration<double>(stats.wait_time).count(),
+          stats.timeouts);
+    }
+  }
+}
+
+#ifndef _WIN32
+
+namespace {
+
+/// Write all the *size* bytes of *data* into *fd*. Return false on failure.
+bool write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    // Do not get killed by a `SIGPIPE` upon a closed connection.
+    auto written = send(fd, data, size, MSG_NOSIGNAL);
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return false;
+    }
+
+    data += written;
+    size -= written;
+  }
+
+  return true;
+}
+
+/// Read exactly *size* bytes from *fd* into *data*. Return false on failure.
+bool read_all(int fd, char *data, size_t size) {
+  while (size > 0) {
+    auto read = ::read(fd, data, size);
+
+    if (read < 0 && errno == EINTR)
+      continue;
+    else if (read <= 0)
+      return false;
+
+    data += read;
+    size -= read;
+  }
+
+  return true;
+}
+
+bool write_frame(int fd, char type, const char *data, uint32_t size) {
+  char header[5];
+  header[0] = type;
+  std::memcpy(header + 1, &size, sizeof(size));
+  return write_all(fd, header, sizeof(header)) && write_all(fd, data, size);
+}
+
+/// The maximum frame payload size. A request is only the arguments, and the
+/// output is sent in chunks, so a larger frame is malformed.
+constexpr uint32_t MaxFrameSize = 16 * 1024 * 1024;
+
+/// Read a frame. Return false on failure, or if the frame is too large.
+bool read_frame(int fd, char &type, std::string &payload) {
+  char header[5];
+
+  if (!read_all(fd, header, sizeof(header)))
+    return false;
+
+  uint32_t size;
+  type = header[0];
+  std::memcpy(&size, header + 1, sizeof(size));
+
+  if (size > MaxFrameSize) {
+    Util::logger.warn("Daemon")
+        << "Received a frame of " << size << " bytes, exceeding the limit\n";
+
+    return false;
+  }
+
+  payload.resize(size);
+
+  return read_all(fd, payload.data(), size);
+}
+
+/// A stream buffer writing its contents to a socket as frames of *type*.
+class FrameStreambuf : public std::streambuf {
+public:
+  FrameStreambuf(int fd, char type) : _fd(fd), _type(type) {
+    setp(_buffer, _buffer + sizeof(_buffer));
+  }
+
+  ~FrameStreambuf() { sync(); }
+
+protected:
+  int_type overflow(int_type ch) override {
+    if (sync() != 0)
+      return traits_type::eof();
+
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+
+    return traits_type::not_eof(ch);
+  }
+
+  int sync() override {
+    auto size = pptr() - pbase();
+
+    if (size > 0 && !write_frame(_fd, _type, pbase(), size))
+      return -1;
+
+    setp(_buffer, _buffer + sizeof(_buffer));
+    return 0;
+  }
+
+private:
+  int _fd;
+  char _type;
+  char _buffer[4096];
+};
+
+/// Redirect *stream* to *buffer* until destruction.
+struct RdbufGuard {
+  RdbufGuard(std::ostream &stream, std::streambuf *buffer) :
+      _stream(stream), _previous(stream.rdbuf(buffer)) {}
+
+  ~RdbufGuard() {
+    _stream.flush();
+    _stream.rdbuf(_previous);
+  }
+
+private:
+  std::ostream &_stream;
+  std::streambuf *_previous;
+};
+
+/// Return the identity of the compiler build, which is its executable path
+/// and modification time upon the first call. A rebuilt compiler thus differs
+/// from a daemon started before.
+const std::string &build_version() {
+  static const std::string version = []() -> std::string {
+    std::error_code err;
+    auto path = std::filesystem::read_symlink("/proc/self/exe", err);
+
+    if (err)
+      return "unknown";
+
+    auto time = std::filesystem::last_write_time(path, err);
+
+    if (err)
+      return path.string();
+
+    return fmt::format(
+        "{}@{}", path.string(), time.time_since_epoch().count());
+  }();
+
+  return version;
+}
+
+sockaddr_un make_address(const std::filesystem::path &path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  auto string = path.string();
+
+  if (string.size() >= sizeof(address.sun_path))
+    throw "The daemon socket path is too long: " + string;
+
+  std::memcpy(address.sun_path, string.c_str(), string.size());
+  return address;
+}
+
+} // namespace
+
+std::filesystem::path Daemon::default_socket_path() {
+  if (auto path = std::getenv("FNXC_DAEMON_SOCKET"))
+    return path;
+  else if (auto dir = std::getenv("XDG_RUNTIME_DIR"))
+    return std::filesystem::path(dir) / "fnxc.sock";
+  else
+    return std::filesystem::temp_directory_path() /
+           fmt::format("fnxc-{}.sock", getuid());
+}
+
+std::optional<int> Daemon::forward(
+    std::filesystem::path socket_path, std::vector<std::string> args) {
+  if (!std::filesystem::exists(socket_path))
+    return std::nullopt;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd < 0)
+    return std::nullopt;
+
+  auto address = make_address(socket_path);
+
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+    FNXC_DEBUG("Daemon")
+        << "Could not connect to " << socket_path << ": "
+        << std::strerror(errno) << "\n";
+
+    close(fd);
+    return std::nullopt;
+  }
+
+  // The socket may be in a shared directory, e.g. `/tmp`, thus served by
+  // another user's process, which shall not see the request.
+  ucred peer;
+  socklen_t peer_size = sizeof(peer);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_size) < 0 ||
+      peer.uid != getuid()) {
+    Util::logger.warn("Daemon")
+        << "The daemon at " << socket_path
+        << " is not run by the current user, compiling in-process\n";
+
+    close(fd);
+    return std::nullopt;
+  }
+
+  // A daemon of another build may compile differently.
+  auto &version = build_version();
+  char type;
+  std::string payload;
+
+  if (!write_frame(fd, 'V', version.data(), version.size()) ||
+      !read_frame(fd, type, payload) || type != 'V') {
+    close(fd);
+    throw std::string("Failed to handshake with the daemon");
+  }
+
+  if (payload != version) {
+    Util::logger.warn("Daemon")
+        << "The daemon at " << socket_path << " is of another build ("
+        << payload << "), compiling in-process; restart the daemon\n";
+
+    close(fd);
+    return std::nullopt;
+  }
+
+  FNXC_DEBUG("Daemon") << "Forwarding the request to " << socket_path << "\n";
+
+  std::string request = std::filesystem::current_path().string();
+  request += '\0';
+
+  for (auto &arg : args) {
+    request += arg;
+    request += '\0';
+  }
+
+  if (!write_frame(fd, 'R', request.data(), request.size())) {
+    close(fd);
+    throw std::string("Failed to send the request to the daemon");
+  }
+
+  while (read_frame(fd, type, payload)) {
+    switch (type) {
+    case 'O':
+      std::cout.write(payload.data(), payload.size());
+      break;
+    case 'E':
+      std::cerr.write(payload.data(), payload.size());
+      break;
+    case 'X': {
+      int32_t code;
+      std::memcpy(&code, payload.data(), sizeof(code));
+      close(fd);
+      std::cout.flush();
+      return code;
+    }
+    }
+  }
+
+  close(fd);
+  throw std::string("The daemon has unexpectedly closed the connection");
+}
+
+void Daemon::listen() {
+  // A request redirects `std::cerr` to the client, which would race with the
+  // background writer, and let it write a request's messages after the
+  // request is over. Synchronously, they are written by the request itself.
+  Util::logger.stop_async();
+
+  // Identified upon the start, as the executable may be replaced later.
+  auto &version = build_version();
+
+  int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (server < 0)
+    throw fmt::format("Failed to create a socket: {}", std::strerror(errno));
+
+  // A stale socket file is left by a killed daemon.
+  auto address = make_address(socket_path);
+  std::filesystem::remove(socket_path);
+
+  // Only the owner may connect, i.e. the socket is created as 0600, even if
+  // in a shared directory. The mask is set for the bind, so that there is
+  // no moment the socket is accessible to the others.
+  auto mask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+  auto bound = bind(server, (sockaddr *)&address, sizeof(address));
+  umask(mask);
+
+  if (bound < 0 || ::listen(server, 16) < 0)
+    throw fmt::format(
+        "Failed to listen at {}: {}",
+        socket_path.string(),
+        std::strerror(errno));
+
+  Util::logger.info("Daemon")
+      << "Listening at " << socket_path << " (" << version << ")\n";
+
+  while (true) {
+    int client = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+
+    if (client < 0) {
+      if (errno != EINTR)
+        Util::logger.error("Daemon")
+            << "Failed to accept a connection: " << std::strerror(errno)
+            << "\n";
+
+      continue;
+    }
+
+    try {
+      _serve(client);
+    } catch (std::exception &e) {
+      Util::logger.error("Daemon") << "Failed to serve: " << e.what() << "\n";
+    }
+
+    close(client);
+  }
+}
+
+void Daemon::_serve(int client) {
+  char type;
+  std::string request;
+
+  if (!read_frame(client, type, request) || type != 'V') {
+    Util::logger.warn("Daemon") << "Received a malformed handshake\n";
+    return;
+  }
+
+  // The client closes the connection if the versions differ.
+  auto &version = build_version();
+
+  if (!write_frame(client, 'V', version.data(), version.size()) ||
+      !read_frame(client, type, request))
+    return;
+
+  if (type != 'R') {
+    Util::logger.warn("Daemon") << "Received a malformed request\n";
+    return;
+  }
+
+  // The request is a NUL-separated list of the working directory and args.
+  std::vector<std::string> parts;
+  size_t begin = 0;
+
+  for (size_t i = 0; i < request.size(); i++) {
+    if (request[i] == '\0') {
+      parts.push_back(request.substr(begin, i - begin));
+      begin = i + 1;
+    }
+  }
+
+  if (parts.empty()) {
+    Util::logger.warn("Daemon") << "Received an empty request\n";
+    return;
+  }
+
+  std::error_code err;
+  std::filesystem::current_path(parts[0], err);
+
+  int32_t code;
+
+  if (err) {
+    auto message = "Failed to change directory to " + parts[0] + "\n";
+    write_frame(client, 'E', message.data(), message.size());
+    code = 1;
+  } else {
+    FNXC_DEBUG("Daemon") << "Serving a request in " << parts[0] << "\n";
+
+    // The first argument is the program name.
+    std::vector<const char *> argv = {"fnxc"};
+
+    for (size_t i = 1; i < parts.size(); i++)
+      argv.push_back(parts[i].c_str());
+
+    FrameStreambuf out_buffer(client, 'O'), err_buffer(client, 'E');
+    RdbufGuard out_guard(std::cout, &out_buffer);
+    RdbufGuard err_guard(std::cerr, &err_buffer);
+
+    code = CLI(&_programs).run(argv.size(), argv.data());
+  }
+
+  write_frame(client, 'X', (char *)&code, sizeof(code));
+  _report_pools();
+}
+
+#else
+
+std::filesystem::path Daemon::default_socket_path() {
+  return std::filesystem::temp_directory_path() / "fnxc.sock";
+}
+
+std::optional<int>
+Daemon::forward(std::filesystem::path, std::vector<std::string>) {
+  return std::nullopt;
+}
+
+void Daemon::listen() { throw "The daemon is not supported on Windows yet"; }
+
+void Daemon::_serve(int) {}
+
+#endif
+
+} // namespace Fancysoft::NXC
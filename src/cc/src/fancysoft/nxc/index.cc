@@ -0,0 +1,428 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include <fmt/format.h>
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include "fancysoft/nxc/index.hh"
+#include "fancysoft/util/logger.hh"
+
+namespace Fancysoft::NXC {
+
+namespace {
+
+/// Bumped upon any format change, so that stale files are ignored.
+const char magic[8] = {'F', 'N', 'X', 'C', 'I', 'D', 'X', '2'};
+
+/// A shard or merged file header, followed by the entries and then by the
+/// strings pool. All the numbers are native-endian.
+struct RawHeader {
+  char magic[8];
+
+  /// The source file hash for a shard, zero for the merged file.
+  uint64_t source_hash;
+
+  /// The amount of merged shards, zero for a shard.
+  uint32_t shard_count;
+
+  uint32_t entry_count;
+  uint32_t strings_size;
+
+  /// The absolute source file path in the pool for a shard, empty for the
+  /// merged file.
+  uint32_t source, source_size;
+
+  uint32_t reserved;
+};
+
+/// An entry with strings stored as offsets into the pool.
+struct RawEntry {
+  uint32_t name, name_size;
+  uint32_t path, path_size;
+  uint32_t decl_path, decl_path_size;
+  uint32_t description, description_size;
+  uint32_t row, col;
+  uint32_t decl_row, decl_col;
+  uint8_t kind;
+  uint8_t padding[3];
+};
+
+/// A validated view of a shard or merged file.
+struct View {
+  const RawHeader *header;
+  const RawEntry *entries;
+  const char *strings;
+
+  /// Return nothing if *buffer* is not a valid index file.
+  static std::optional<View> of(llvm::StringRef buffer) {
+    if (buffer.size() < sizeof(RawHeader))
+      return std::nullopt;
+
+    auto header = reinterpret_cast<const RawHeader *>(buffer.data());
+
+    if (std::memcmp(header->magic, magic, sizeof(magic)) ||
+        sizeof(RawHeader) + uint64_t(header->entry_count) * sizeof(RawEntry) +
+                header->strings_size !=
+            buffer.size())
+      return std::nullopt;
+
+    auto entries =
+        reinterpret_cast<const RawEntry *>(buffer.data() + sizeof(RawHeader));
+
+    return View{
+        header,
+        entries,
+        reinterpret_cast<const char *>(entries + header->entry_count)};
+  }
+
+  std::string_view source() const {
+    return string(header->source, header->source_size);
+  }
+
+  const RawEntry *begin() const { return entries; }
+  const RawEntry *end() const { return entries + header->entry_count; }
+
+  std::string_view string(uint32_t offset, uint32_t size) const {
+    if (uint64_t(offset) + size > header->strings_size)
+      return {};
+
+    return std::string_view(strings + offset, size);
+  }
+
+  Index::Entry read(const RawEntry &raw) const {
+    return Index::Entry{
+        (Index::Kind)raw.kind,
+        std::string(string(raw.name, raw.name_size)),
+        std::string(string(raw.path, raw.path_size)),
+        Position(raw.row, raw.col),
+        std::string(string(raw.decl_path, raw.decl_path_size)),
+        Position(raw.decl_row, raw.decl_col),
+        std::string(string(raw.description, raw.description_size))};
+  }
+};
+
+/// Serialize *entries* into the index file format. Equal strings (e.g.
+/// paths) are stored only once.
+std::string serialize(
+    const std::vector<Index::Entry> &entries,
+    uint64_t source_hash,
+    uint32_t shard_count,
+    const std::string &source = "") {
+  std::string strings;
+  std::map<std::string, uint32_t> offsets;
+
+  auto intern = [&](const std::string &string) {
+    auto found = offsets.find(string);
+
+    if (found != offsets.end())
+      return found->second;
+
+    uint32_t offset = strings.size();
+    strings += string;
+    offsets.emplace(string, offset);
+    return offset;
+  };
+
+  std::vector<RawEntry> raw_entries;
+  raw_entries.reserve(entries.size());
+
+  for (auto &entry : entries) {
+    RawEntry raw;
+    std::memset(&raw, 0, sizeof(raw));
+
+    auto path = entry.path.generic_string();
+    auto decl_path = entry.decl_path.generic_string();
+
+    raw.name = intern(entry.name);
+    raw.name_size = entry.name.size();
+    raw.path = intern(path);
+    raw.path_size = path.size();
+    raw.decl_path = intern(decl_path);
+    raw.decl_path_size = decl_path.size();
+    raw.description = intern(entry.description);
+    raw.description_size = entry.description.size();
+    raw.row = entry.position.row;
+    raw.col = entry.position.col;
+    raw.decl_row = entry.decl_position.row;
+    raw.decl_col = entry.decl_position.col;
+    raw.kind = (uint8_t)entry.kind;
+
+    raw_entries.push_back(raw);
+  }
+
+  RawHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.source_hash = source_hash;
+  header.shard_count = shard_count;
+  header.entry_count = raw_entries.size();
+  header.source = intern(source);
+  header.source_size = source.size();
+  header.strings_size = strings.size();
+
+  std::string buffer;
+  buffer.append(reinterpret_cast<char *>(&header), sizeof(header));
+  buffer.append(
+      reinterpret_cast<char *>(raw_entries.data()),
+      raw_entries.size() * sizeof(RawEntry));
+  buffer += strings;
+
+  return buffer;
+}
+
+/// Read the whole file at *path*, if readable.
+std::optional<std::string> read_file(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+
+  if (!file)
+    return std::nullopt;
+
+  return std::string(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/// Return the source file path of the shard at *path*, if readable, without
+/// reading its entries.
+std::optional<std::string>
+read_shard_source(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  RawHeader header;
+
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, magic, sizeof(magic)) ||
+      uint64_t(header.source) + header.source_size > header.strings_size)
+    return std::nullopt;
+
+  std::string source(header.source_size, '\0');
+  file.seekg(
+      sizeof(RawHeader) + uint64_t(header.entry_count) * sizeof(RawEntry) +
+      header.source);
+
+  if (!file.read(source.data(), source.size()))
+    return std::nullopt;
+
+  return source;
+}
+
+/// Write *contents* to *path* atomically, so that a concurrent reader never
+/// sees a partially written file.
+void write_file_atomically(
+    const std::filesystem::path &path, const std::string &contents) {
+  std::filesystem::create_directories(path.parent_path());
+
+  int fd;
+  llvm::SmallString<128> temp_path;
+  auto model = (path.parent_path() / "tmp-%%%%%%%%").string();
+
+  if (auto err = llvm::sys::fs::createUniqueFile(model, fd, temp_path))
+    throw "Failed to create an index file: " + err.message();
+
+  llvm::raw_fd_ostream stream(fd, true);
+  stream << contents;
+  stream.close();
+
+  // The stream would abort the process upon destruction with an error.
+  if (stream.has_error()) {
+    auto message = stream.error().message();
+    stream.clear_error();
+
+    std::error_code err;
+    std::filesystem::remove(temp_path.str().str(), err);
+
+    throw "Failed to write an index file: " + message;
+  }
+
+  std::filesystem::rename(temp_path.str().str(), path);
+}
+
+} // namespace
+
+std::optional<uint64_t> Index::hash_file(const std::filesystem::path &path) {
+  if (auto contents = read_file(path))
+    return llvm::xxHash64(*contents);
+  else
+    return std::nullopt;
+}
+
+Index::Index(std::filesystem::path dir) : dir(dir) {
+  std::filesystem::create_directories(dir / "shards");
+}
+
+bool Index::fresh(const std::filesystem::path &source, uint64_t hash) {
+  std::ifstream file(_shard_path(source), std::ios::binary);
+  RawHeader header;
+
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    return false;
+
+  return !std::memcmp(header.magic, magic, sizeof(magic)) &&
+         header.source_hash == hash;
+}
+
+void Index::update(
+    const std::filesystem::path &source,
+    uint64_t hash,
+    const std::vector<Entry> &entries) {
+  FNXC_DEBUG("Index")
+      << "Updating " << entries.size() << " entries of " << source << "\n";
+
+  write_file_atomically(
+      _shard_path(source),
+      serialize(
+          entries,
+          hash,
+          0,
+          std::filesystem::absolute(source).generic_string()));
+}
+
+void Index::remove(const std::filesystem::path &source) {
+  std::error_code err;
+  std::filesystem::remove(_shard_path(source), err);
+}
+
+void Index::commit() {
+  std::lock_guard lock(_mutex);
+
+  auto merged_path = _merged_path();
+  std::error_code err;
+  auto merged_time = std::filesystem::last_write_time(merged_path, err);
+  bool outdated = !!err;
+
+  std::vector<std::filesystem::path> shard_paths;
+
+  for (auto &shard : std::filesystem::directory_iterator(dir / "shards")) {
+    if (shard.path().extension() != ".idx")
+      continue;
+
+    // The entries of a deleted source file would be looked up forever.
+    auto source = read_shard_source(shard.path());
+
+    if (source && !source->empty() && !std::filesystem::exists(*source)) {
+      FNXC_DEBUG("Index") << "Removing the shard of deleted " << *source
+                          << "\n";
+
+      remove(*source);
+      outdated = true;
+      continue;
+    }
+
+    shard_paths.push_back(shard.path());
+
+    if (!outdated && shard.last_write_time() > merged_time)
+      outdated = true;
+  }
+
+  // The merged file may have been replaced by another process.
+  _merged.reset();
+
+  // A removed shard is detected by the count.
+  if (!outdated) {
+    _load();
+
+    auto view = _merged ? View::of(_merged->getBuffer()) : std::nullopt;
+    outdated = !view || view->header->shard_count != shard_paths.size();
+  }
+
+  if (!outdated)
+    return;
+
+  std::vector<Entry> entries;
+
+  for (auto &shard_path : shard_paths) {
+    auto contents = read_file(shard_path);
+    auto view = contents ? View::of(*contents) : std::nullopt;
+
+    if (!view) {
+      Util::logger.warn("Index") << "Ignoring malformed " << shard_path << "\n";
+      continue;
+    }
+
+    for (auto &raw : *view)
+      entries.push_back(view->read(raw));
+  }
+
+  std::stable_sort(
+      entries.begin(), entries.end(), [](auto &a, auto &b) {
+        return a.name < b.name;
+      });
+
+  FNXC_DEBUG("Index")
+      << "Merging " << entries.size() << " entries from " << shard_paths.size()
+      << " shards\n";
+
+  // Unmap before replacing the file.
+  _merged.reset();
+
+  write_file_atomically(
+      merged_path, serialize(entries, 0, shard_paths.size()));
+}
+
+std::vector<Index::Entry> Index::lookup(std::string_view name) {
+  std::lock_guard lock(_mutex);
+  _load();
+
+  auto view = _merged ? View::of(_merged->getBuffer()) : std::nullopt;
+
+  if (!view)
+    return {};
+
+  auto range = std::equal_range(
+      view->begin(),
+      view->end(),
+      name,
+      [&view](auto &a, auto &b) {
+        using T = std::decay_t<decltype(a)>;
+
+        if constexpr (std::is_same_v<T, RawEntry>)
+          return view->string(a.name, a.name_size) < b;
+        else
+          return a < view->string(b.name, b.name_size);
+      });
+
+  std::vector<Entry> entries;
+
+  for (auto it = range.first; it != range.second; it++)
+    entries.push_back(view->read(*it));
+
+  return entries;
+}
+
+std::filesystem::path
+Index::_shard_path(const std::filesystem::path &source) const {
+  auto key = std::filesystem::absolute(source).generic_string();
+  return dir / "shards" / fmt::format("{:016x}.idx", llvm::xxHash64(key));
+}
+
+std::filesystem::path Index::_merged_path() const { return dir / "index.bin"; }
+
+void Index::_load() {
+  if (_merged)
+    return;
+
+  auto path = _merged_path().string();
+  auto fd = llvm::sys::fs::openNativeFileForRead(path);
+
+  if (!fd) {
+    llvm::consumeError(fd.takeError());
+    return;
+  }
+
+  uint64_t size;
+
+  if (!llvm::sys::fs::file_size(path, size)) {
+    // Large enough files are memory-mapped rather than read.
+    auto buffer = llvm::MemoryBuffer::getOpenFile(*fd, path, size, false);
+
+    if (buffer)
+      _merged = std::move(*buffer);
+  }
+
+  llvm::sys::fs::closeFile(*fd);
+}
+
+} // namespace Fancysoft::NXC
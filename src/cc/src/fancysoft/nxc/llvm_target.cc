@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include <llvm/ADT/Triple.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include "fancysoft/nxc/llvm_target.hh"
+#include "fancysoft/util/logger.hh"
+
+namespace Fancysoft::NXC {
+
+LLVMTarget::LLVMTarget(const Target &target) :
+    target_machines(
+        [this]() { return create_target_machine(); },
+        std::max(1u, std::thread::hardware_concurrency())),
+    _cpu(target.cpu),
+    _features(target.features) {
+  // Targets of a workspace may be created concurrently.
+  static std::once_flag initialized;
+
+  std::call_once(initialized, []() {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmParsers();
+    llvm::InitializeAllAsmPrinters();
+  });
+
+  this->target_triple = target.triple;
+
+  std::string err;
+  _llvm_target = llvm::TargetRegistry::lookupTarget(target_triple, err);
+
+  if (!_llvm_target)
+    throw "Invalid target " + err;
+
+  // Put each function and datum into its own section, so that the linker can
+  // garbage-collect and fold them individually.
+  if (llvm::Triple(target_triple).isOSBinFormatELF()) {
+    _options.FunctionSections = true;
+    _options.DataSections = true;
+  }
+
+  this->target_machine = create_target_machine().release();
+
+  FNXC_DEBUG("LLVMTarget")
+      << "Configured target triple: "
+      << this->target_machine->getTargetTriple().getTriple()
+      << ", CPU: " << target.cpu << ", features: `" << target.features
+      << "`\n";
+}
+
+std::unique_ptr<llvm::TargetMachine>
+LLVMTarget::create_target_machine() const {
+  auto RM = llvm::Optional<llvm::Reloc::Model>();
+
+  return std::unique_ptr<llvm::TargetMachine>(
+      _llvm_target->createTargetMachine(
+          target_triple, _cpu, _features, _options, RM));
+}
+
+} // namespace Fancysoft::NXC
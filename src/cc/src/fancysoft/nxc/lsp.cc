@@ -0,0 +1,734 @@
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <thread>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "fancysoft/nxc/exception.hh"
+#include "fancysoft/nxc/lsp.hh"
+#include "fancysoft/nxc/onyx/file.hh"
+#include "fancysoft/nxc/target.hh"
+#include "fancysoft/nxc/workspace.hh"
+#include "fancysoft/util/logger.hh"
+#include "fancysoft/util/utf8.hh"
+
+namespace Fancysoft::NXC::LSP {
+
+namespace {
+
+// The JSON-RPC and LSP error codes.
+const int method_not_found = -32601;
+const int request_cancelled = -32800;
+const int content_modified = -32801;
+
+/// The maximum number of latency samples kept.
+const size_t max_latencies = 10000;
+
+/// The maximum message content length; a larger one is deemed malformed.
+const size_t max_content_length = 64 * 1024 * 1024;
+
+std::string id_key(const llvm::json::Value &id) {
+  return llvm::formatv("{0}", id).str();
+}
+
+/// Convert a `file://` *uri* to a path, decoding percent-escapes.
+/// A malformed escape is kept as-is.
+std::filesystem::path uri_to_path(llvm::StringRef uri) {
+  uri.consume_front("file://");
+  std::string path;
+
+  for (size_t i = 0; i < uri.size(); i++) {
+    if (uri[i] == '%' && i + 2 < uri.size() &&
+        llvm::isHexDigit(uri[i + 1]) && llvm::isHexDigit(uri[i + 2])) {
+      path += (char)(llvm::hexDigitValue(uri[i + 1]) * 16 +
+                     llvm::hexDigitValue(uri[i + 2]));
+      i += 2;
+    } else
+      path += uri[i];
+  }
+
+  return path;
+}
+
+std::string path_to_uri(const std::filesystem::path &path) {
+  std::string uri = "file://";
+
+  for (unsigned char ch : std::filesystem::absolute(path).generic_string()) {
+    if (isalnum(ch) || strchr("/-_.~:", ch))
+      uri += ch;
+    else
+      uri += llvm::formatv("%{0:X-2}", ch).str();
+  }
+
+  return uri;
+}
+
+/// Return the size of the UTF-8 sequence at *i* of *string*, at least one.
+size_t sequence_size_at(std::string_view string, size_t i) {
+  return std::max<size_t>(Util::UTF8::sequence_size(string[i]), 1);
+}
+
+/// Return the amount of code points in the UTF-8 *string*.
+uint32_t code_point_count(std::string_view string) {
+  uint32_t count = 0;
+
+  for (size_t i = 0; i < string.size(); i += sequence_size_at(string, i))
+    count++;
+
+  return count;
+}
+
+/// Return the amount of UTF-16 code units encoding the first *count* code
+/// points of the UTF-8 *line*. The ones past its end count as one each.
+uint32_t utf16_column(std::string_view line, uint32_t count) {
+  uint32_t units = 0;
+
+  for (size_t i = 0; count > 0 && i < line.size(); count--) {
+    auto size = sequence_size_at(line, i);
+    units += size == 4 ? 2 : 1;
+    i += size;
+  }
+
+  return units + count;
+}
+
+/// Return the amount of code points of the UTF-8 *line* encoded by its first
+/// *units* UTF-16 code units, the inverse of `utf16_column()`. A column
+/// within a surrogate pair is rounded down.
+uint32_t code_point_column(std::string_view line, uint32_t units) {
+  uint32_t count = 0;
+  size_t i = 0;
+
+  for (; units > 0 && i < line.size(); count++) {
+    auto size = sequence_size_at(line, i);
+    uint32_t width = size == 4 ? 2 : 1;
+
+    if (width > units)
+      return count;
+
+    units -= width;
+    i += size;
+  }
+
+  return count + units;
+}
+
+/// Split *text* into lines, without the line feeds.
+std::vector<std::string> split_lines(std::string_view text) {
+  std::vector<std::string> lines;
+  size_t begin = 0;
+
+  for (auto end = text.find('\n'); end != text.npos;
+       begin = end + 1, end = text.find('\n', begin))
+    lines.emplace_back(text.substr(begin, end - begin));
+
+  lines.emplace_back(text.substr(begin));
+  return lines;
+}
+
+/// Return an LSP position of the *position* within *lines*, the columns of
+/// which count code points, while LSP counts UTF-16 code units.
+llvm::json::Object
+to_json(Position position, const std::vector<std::string> &lines) {
+  std::string_view line;
+
+  if (position.row < lines.size())
+    line = lines[position.row];
+
+  return llvm::json::Object{
+      {"line", position.row},
+      {"character", utf16_column(line, position.col)}};
+}
+
+/// Return an LSP range within *lines* starting at *start*, *length* code
+/// points long.
+llvm::json::Object to_range(
+    Position start, uint32_t length, const std::vector<std::string> &lines) {
+  return llvm::json::Object{
+      {"start", to_json(start, lines)},
+      {"end", to_json(Position(start.row, start.col + length), lines)}};
+}
+
+} // namespace
+
+Server::Server(std::istream &input, std::ostream &output) :
+    _input(input), _output(output), _workspace(std::make_shared<Workspace>()) {
+  _workspace->root = std::filesystem::current_path();
+  _workspace->cache_dir = _workspace->root / "./.fnxccache/";
+}
+
+int Server::run() {
+  Util::logger.info("LSP") << "Starting the server\n";
+  std::thread reader(&Server::_read_loop, std::ref(_input), _inbox);
+
+  int exit_code;
+
+  while (true) {
+    _Message message;
+
+    {
+      std::unique_lock lock(_inbox->mutex);
+      _inbox->condition.wait(
+          lock, [this]() { return _inbox->eof || !_inbox->queue.empty(); });
+
+      if (_inbox->queue.empty()) {
+        // The client has gone without the `exit` notification.
+        exit_code = 1;
+        break;
+      }
+
+      message = std::move(_inbox->queue.front());
+      _inbox->queue.pop_front();
+    }
+
+    if (!_handle(message)) {
+      exit_code = _shutdown ? 0 : 1;
+      break;
+    }
+  }
+
+  // The reader stops upon the input end, which the client is expected to
+  // close after the `exit` notification. Unless it has, the reader is left
+  // blocked, only referring to the input and the shared inbox.
+  bool eof;
+
+  {
+    std::lock_guard lock(_inbox->mutex);
+    eof = _inbox->eof;
+  }
+
+  if (eof)
+    reader.join();
+  else
+    reader.detach();
+
+  Util::logger.info("LSP") << "Exiting with code " << exit_code << "\n";
+  return exit_code;
+}
+
+void Server::_read_loop(std::istream &input, std::shared_ptr<_Inbox> inbox) {
+  while (auto raw = _read_message(input)) {
+    auto parsed = llvm::json::parse(*raw);
+
+    if (!parsed) {
+      Util::logger.warn("LSP")
+          << "Malformed message: " << llvm::toString(parsed.takeError())
+          << "\n";
+
+      continue;
+    }
+
+    auto object = parsed->getAsObject();
+
+    if (!object)
+      continue;
+
+    std::lock_guard lock(inbox->mutex);
+
+    // A cancellation is handled immediately, ahead of the queue.
+    if (object->getString("method") == llvm::StringRef("$/cancelRequest")) {
+      if (auto params = object->getObject("params"))
+        if (auto id = params->get("id"))
+          inbox->cancelled_ids.insert(id_key(*id));
+
+      continue;
+    }
+
+    inbox->queue.push_back({std::move(*object), _Clock::now()});
+    inbox->condition.notify_one();
+  }
+
+  std::lock_guard lock(inbox->mutex);
+  inbox->eof = true;
+  inbox->condition.notify_one();
+}
+
+std::optional<std::string> Server::_read_message(std::istream &input) {
+  std::string line;
+  std::optional<size_t> content_length;
+
+  // The header section is terminated with an empty line.
+  while (std::getline(input, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    if (line.empty())
+      break;
+
+    const std::string header = "Content-Length: ";
+
+    if (line.starts_with(header)) {
+      size_t length;
+      auto begin = line.data() + header.size(), end = line.data() + line.size();
+      auto [ptr, ec] = std::from_chars(begin, end, length);
+
+      // A malformed header renders the stream unusable.
+      if (ec != std::errc() || ptr != end)
+        return std::nullopt;
+
+      content_length = length;
+    }
+  }
+
+  if (!input || !content_length)
+    return std::nullopt;
+
+  if (*content_length > max_content_length) {
+    Util::logger.warn("LSP")
+        << "Message of " << *content_length << " bytes exceeds the limit\n";
+
+    return std::nullopt;
+  }
+
+  std::string content(*content_length, '\0');
+  input.read(content.data(), content.size());
+
+  if (!input)
+    return std::nullopt;
+
+  return content;
+}
+
+void Server::_write_message(const llvm::json::Value &message) {
+  auto content = llvm::formatv("{0}", message).str();
+  _output << "Content-Length: " << content.size() << "\r\n\r\n" << content;
+  _output.flush();
+}
+
+void Server::_respond(const llvm::json::Value &id, llvm::json::Value result) {
+  _write_message(llvm::json::Object{
+      {"jsonrpc", "2.0"}, {"id", id}, {"result", std::move(result)}});
+}
+
+void Server::_respond_error(
+    const llvm::json::Value &id, int code, std::string message) {
+  _write_message(llvm::json::Object{
+      {"jsonrpc", "2.0"},
+      {"id", id},
+      {"error", llvm::json::Object{{"code", code}, {"message", message}}}});
+}
+
+void Server::_notify(std::string method, llvm::json::Value params) {
+  _write_message(llvm::json::Object{
+      {"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}});
+}
+
+bool Server::_has_queued_edit(const std::string &uri) const {
+  auto &queue = _inbox->queue;
+
+  return std::any_of(queue.begin(), queue.end(), [&uri](auto &message) {
+    if (message.body.getString("method") !=
+        llvm::StringRef("textDocument/didChange"))
+      return false;
+
+    auto params = message.body.getObject("params");
+    auto document = params ? params->getObject("textDocument") : nullptr;
+    return document && document->getString("uri") == llvm::StringRef(uri);
+  });
+}
+
+bool Server::_handle(_Message &message) {
+  auto method = message.body.getString("method").getValueOr("").str();
+  auto id = message.body.get("id");
+  auto params = message.body.getObject("params");
+
+  FNXC_DEBUG("LSP") << "Handling " << method << "\n";
+
+  std::string uri;
+  if (params)
+    if (auto document = params->getObject("textDocument"))
+      uri = document->getString("uri").getValueOr("").str();
+
+  // A request missing an ID, or parameters, could not be responded to.
+  static const std::set<std::string> requests = {
+      "initialize",
+      "shutdown",
+      "textDocument/hover",
+      "textDocument/definition",
+      "textDocument/references",
+      "fnxc/stats"};
+
+  if ((!id && requests.contains(method)) ||
+      (method.starts_with("textDocument/") && uri.empty())) {
+    Util::logger.warn("LSP") << "Dropping a malformed " << method << "\n";
+    return true;
+  }
+
+  {
+    std::lock_guard lock(_inbox->mutex);
+
+    if (id && _inbox->cancelled_ids.erase(id_key(*id))) {
+      _respond_error(*id, request_cancelled, "The request is cancelled");
+      return true;
+    }
+
+    // Skip the work which would be immediately outdated.
+    if (!uri.empty() && _has_queued_edit(uri)) {
+      if (method == "textDocument/didChange") {
+        FNXC_DEBUG("LSP") << "Skipping a stale edit of " << uri << "\n";
+        _skipped_edits_count++;
+        return true;
+      } else if (id) {
+        _respond_error(*id, content_modified, "The document is modified");
+        return true;
+      }
+    }
+  }
+
+  if (method == "initialize") {
+    _respond(
+        *id,
+        llvm::json::Object{
+            {"capabilities",
+             llvm::json::Object{
+                 {"textDocumentSync",
+                  llvm::json::Object{{"openClose", true}, {"change", 1}}},
+                 {"hoverProvider", true},
+                 {"definitionProvider", true},
+                 {"referencesProvider", true}}},
+            {"serverInfo", llvm::json::Object{{"name", "fnxc"}}}});
+  } else if (method == "shutdown") {
+    _shutdown = true;
+    _respond(*id, nullptr);
+  } else if (method == "exit") {
+    return false;
+  } else if (method == "textDocument/didOpen") {
+    auto document = params->getObject("textDocument");
+
+    _update(
+        uri,
+        document->getInteger("version").getValueOr(0),
+        document->getString("text").getValueOr("").str());
+  } else if (method == "textDocument/didChange") {
+    auto document = params->getObject("textDocument");
+    auto changes = params->getArray("contentChanges");
+
+    // With the full synchronization, the last change is the whole text.
+    if (changes && !changes->empty())
+      if (auto change = changes->back().getAsObject())
+        _update(
+            uri,
+            document->getInteger("version").getValueOr(0),
+            change->getString("text").getValueOr("").str());
+
+    _record_latency(message.received_at);
+  } else if (method == "textDocument/didClose") {
+    _documents.erase(uri);
+
+    _notify(
+        "textDocument/publishDiagnostics",
+        llvm::json::Object{
+            {"uri", uri}, {"diagnostics", llvm::json::Array{}}});
+  } else if (method == "textDocument/hover") {
+    _respond(*id, _hover(*params));
+  } else if (method == "textDocument/definition") {
+    _respond(*id, _definition(*params));
+  } else if (method == "textDocument/references") {
+    _respond(*id, _references(*params));
+  } else if (method == "fnxc/stats") {
+    _respond(*id, _stats());
+  } else if (id) {
+    _respond_error(*id, method_not_found, "Unsupported method " + method);
+  }
+
+  return true;
+}
+
+void Server::_update(std::string uri, int64_t version, std::string text) {
+  auto found = _documents.find(uri);
+
+  if (found == _documents.end()) {
+    auto path = uri_to_path(uri);
+
+    Program::CompilationContext context;
+    context.target.triple = Target::default_triple();
+    context.target.object_file_format =
+        Target::object_file_format_of(context.target.triple);
+    context.entry_path = path;
+
+    auto program = std::make_shared<Program>(context, _workspace);
+    found = _documents.emplace(uri, _Document{path, version, program}).first;
+  }
+
+  auto &document = found->second;
+  document.version = version;
+  document.lines = split_lines(text);
+  document.program->set_source(document.path, std::move(text));
+
+  llvm::json::Array diagnostics;
+  std::map<std::filesystem::path, std::vector<std::string>> lines;
+
+  auto diagnose = [&](const Panic &panic) {
+    llvm::json::Object diagnostic{
+        {"severity", 1}, {"source", "fnxc"}, {"message", panic.what()}};
+
+    auto resolved =
+        panic.placement ? panic.placement->resolve() : std::nullopt;
+
+    diagnostic["range"] = to_range(
+        resolved ? resolved->second : Position(),
+        resolved ? 1 : 0,
+        resolved ? _lines(resolved->first, lines) : document.lines);
+
+    llvm::json::Array related;
+
+    for (auto &note : panic.notes) {
+      if (!note.placement)
+        continue;
+
+      if (auto note_resolved = note.placement->resolve())
+        related.push_back(llvm::json::Object{
+            {"location",
+             llvm::json::Object{
+                 {"uri", path_to_uri(note_resolved->first)},
+                 {"range",
+                  to_range(
+                      note_resolved->second,
+                      1,
+                      _lines(note_resolved->first, lines))}}},
+            {"message", note.message}});
+    }
+
+    if (!related.empty())
+      diagnostic["relatedInformation"] = std::move(related);
+
+    diagnostics.push_back(std::move(diagnostic));
+  };
+
+  try {
+    document.program->compile_mlir();
+  } catch (Panic &panic) {
+    // A module parsed despite panics reports all of them at once.
+    if (auto panics = dynamic_cast<Panics *>(&panic)) {
+      for (auto &each : panics->panics)
+        diagnose(each);
+    } else {
+      diagnose(panic);
+    }
+  } catch (std::exception &e) {
+    diagnostics.push_back(llvm::json::Object{
+        {"severity", 1},
+        {"source", "fnxc"},
+        {"message", std::string("Internal error: ") + e.what()},
+        {"range", to_range(Position(), 0, {})}});
+  } catch (const std::string &e) {
+    diagnostics.push_back(llvm::json::Object{
+        {"severity", 1},
+        {"source", "fnxc"},
+        {"message", "Internal error: " + e},
+        {"range", to_range(Position(), 0, {})}});
+  }
+
+  _notify(
+      "textDocument/publishDiagnostics",
+      llvm::json::Object{
+          {"uri", uri},
+          {"version", version},
+          {"diagnostics", std::move(diagnostics)}});
+}
+
+std::optional<MLIR::Reference>
+Server::_find_reference(const llvm::json::Object &params) {
+  auto document = params.getObject("textDocument");
+  auto position = params.getObject("position");
+
+  if (!document || !position)
+    return std::nullopt;
+
+  auto found = _documents.find(document->getString("uri").getValueOr("").str());
+
+  if (found == _documents.end())
+    return std::nullopt;
+
+  auto module = found->second.program->module(found->second.path);
+
+  if (!module || !module->compiled())
+    return std::nullopt;
+
+  auto row = position->getInteger("line").getValueOr(-1);
+  auto &lines = found->second.lines;
+
+  if (row < 0 || row >= (int64_t)lines.size())
+    return std::nullopt;
+
+  auto col = code_point_column(
+      lines[row], position->getInteger("character").getValueOr(0));
+
+  for (auto &reference : module->mlir()->references()) {
+    auto use = reference.use.resolve();
+
+    if (use && use->first == found->second.path && use->second.row == row &&
+        col >= use->second.col &&
+        col < use->second.col + code_point_count(reference.id))
+      return reference;
+  }
+
+  return std::nullopt;
+}
+
+llvm::json::Value Server::_hover(const llvm::json::Object &params) {
+  auto reference = _find_reference(params);
+
+  if (!reference)
+    return nullptr;
+
+  return llvm::json::Object{
+      {"contents",
+       llvm::json::Object{
+           {"kind", "markdown"},
+           {"value", "```\n" + reference->description + "\n```"}}}};
+}
+
+llvm::json::Value Server::_definition(const llvm::json::Object &params) {
+  auto reference = _find_reference(params);
+
+  if (!reference)
+    return nullptr;
+
+  auto declaration = reference->declaration.resolve();
+
+  if (!declaration)
+    return nullptr;
+
+  std::map<std::filesystem::path, std::vector<std::string>> lines;
+
+  return llvm::json::Object{
+      {"uri", path_to_uri(declaration->first)},
+      {"range",
+       to_range(
+           declaration->second,
+           code_point_count(reference->id),
+           _lines(declaration->first, lines))}};
+}
+
+llvm::json::Value Server::_references(const llvm::json::Object &params) {
+  auto reference = _find_reference(params);
+
+  if (!reference)
+    return nullptr;
+
+  auto declaration = reference->declaration.resolve();
+
+  if (!declaration)
+    return nullptr;
+
+  auto declaration_path = std::filesystem::absolute(declaration->first);
+  auto context = params.getObject("context");
+  bool include_declaration =
+      context && context->getBoolean("includeDeclaration").getValueOr(false);
+
+  // Open documents take precedence over the index, which may be outdated.
+  std::set<std::filesystem::path> open_paths;
+  std::set<std::pair<std::filesystem::path, Position>> locations;
+
+  auto add = [&](std::filesystem::path path, Position position, bool is_decl) {
+    if (!is_decl || include_declaration)
+      locations.emplace(std::filesystem::absolute(path), position);
+  };
+
+  for (auto &[uri, document] : _documents) {
+    auto module = document.program->module(document.path);
+
+    if (!module || !module->compiled())
+      continue;
+
+    open_paths.insert(std::filesystem::absolute(document.path));
+
+    for (auto &ref : module->mlir()->references()) {
+      auto decl = ref.declaration.resolve();
+      auto use = ref.use.resolve();
+
+      if (ref.id == reference->id && decl && use &&
+          std::filesystem::absolute(decl->first) == declaration_path &&
+          decl->second == declaration->second)
+        add(use->first, use->second, ref.is_declaration);
+    }
+  }
+
+  if (auto index = _workspace->index()) {
+    for (auto &entry : index->lookup(reference->id)) {
+      if (!open_paths.count(entry.path) &&
+          entry.decl_path == declaration_path &&
+          entry.decl_position == declaration->second)
+        add(entry.path, entry.position, entry.is_declaration());
+    }
+  }
+
+  llvm::json::Array result;
+  std::map<std::filesystem::path, std::vector<std::string>> lines;
+  auto length = code_point_count(reference->id);
+
+  for (auto &[path, position] : locations)
+    result.push_back(llvm::json::Object{
+        {"uri", path_to_uri(path)},
+        {"range", to_range(position, length, _lines(path, lines))}});
+
+  return result;
+}
+
+const std::vector<std::string> &Server::_lines(
+    const std::filesystem::path &path,
+    std::map<std::filesystem::path, std::vector<std::string>> &cache) const {
+  auto absolute = std::filesystem::absolute(path);
+  auto found = cache.find(absolute);
+
+  if (found != cache.end())
+    return found->second;
+
+  auto &lines = cache[absolute];
+
+  for (auto &[uri, document] : _documents)
+    if (std::filesystem::absolute(document.path) == absolute)
+      return lines = document.lines;
+
+  std::ifstream file(absolute, std::ios::binary);
+
+  if (file)
+    lines = split_lines(std::string(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>()));
+
+  return lines;
+}
+
+void Server::_record_latency(_Clock::time_point received_at) {
+  auto latency =
+      std::chrono::duration<double, std::milli>(_Clock::now() - received_at);
+
+  FNXC_DEBUG("LSP") << "Edit latency: " << latency.count() << "ms\n";
+
+  _edits_count++;
+  _latencies.push_back(latency.count());
+
+  if (_latencies.size() > max_latencies)
+    _latencies.pop_front();
+}
+
+llvm::json::Value Server::_stats() const {
+  std::vector<double> sorted(_latencies.begin(), _latencies.end());
+  std::sort(sorted.begin(), sorted.end());
+
+  auto percentile = [&sorted](double p) -> llvm::json::Value {
+    if (sorted.empty())
+      return nullptr;
+
+    auto index = std::min<size_t>(p * sorted.size(), sorted.size() - 1);
+    return sorted[index];
+  };
+
+  return llvm::json::Object{
+      {"edits", (int64_t)_edits_count},
+      {"skipped_edits", (int64_t)_skipped_edits_count},
+      {"latency_ms",
+       llvm::json::Object{
+           {"p50", percentile(0.5)},
+           {"p90", percentile(0.9)},
+           {"p99", percentile(0.99)},
+           {"max", sorted.empty() ? llvm::json::Value(nullptr) : sorted.back()},
+       }}};
+}
+
+} // namespace Fancysoft::NXC::LSP
@@ -11,13 +11,14 @@
 #include "fancysoft/nxc/exception.hh"
 #include "fancysoft/nxc/mlir.hh"
 #include "fancysoft/util/logger.hh"
+#include "fancysoft/util/trace_log.hh"
 #include "fancysoft/util/variant.hh"
 #include "llvm/Support/raw_os_ostream.h"
 
 namespace Fancysoft::NXC {
 
 MLIR::MLIR(const Onyx::AST *ast, Program *program) {
-  Util::logger.trace("MLIR") << "MLIR()\n";
+  FNXC_TRACE("MLIR") << "MLIR()\n";
 
   for (auto &node : ast->children()) {
     std::visit(
@@ -28,6 +29,11 @@ MLIR::MLIR(const Onyx::AST *ast, Program *program) {
                             T,
                             std::shared_ptr<Onyx::AST::ExternDirective>>) {
             _top_level_scope->compile_extern_directive(arg);
+          } else if constexpr (std::is_same_v<
+                                   T,
+                                   std::shared_ptr<
+                                       Onyx::AST::ImportDirective>>) {
+            // Only orders the modules, see `Module::dependencies()`.
           } else if constexpr (std::is_same_v<
                                    T,
                                    std::shared_ptr<Onyx::AST::VarDecl>>) {
@@ -41,6 +47,10 @@ MLIR::MLIR(const Onyx::AST *ast, Program *program) {
                                    std::shared_ptr<
                                        Onyx::AST::ExplicitSafetyStatement>>) {
             _top_level_scope->compile_rval(arg);
+          } else if constexpr (std::is_same_v<
+                                   T,
+                                   std::shared_ptr<Onyx::AST::Error>>) {
+            // Already reported by the parser, see `Unit::panics()`.
           } else
             throw Unimplemented();
         },
@@ -49,28 +59,30 @@ MLIR::MLIR(const Onyx::AST *ast, Program *program) {
 }
 
 void MLIR::write(std::ostream &out) const {
-  Util::logger.trace("MLIR") << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE("MLIR") << __builtin_FUNCTION() << "()\n";
   _top_level_scope->write(out);
 }
 
 void MLIR::lower(llvm::Module *module) const {
-  Util::logger.trace("MLIR") << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE("MLIR") << __builtin_FUNCTION() << "()\n";
   _top_level_scope->lower(module);
 }
 
+const std::vector<MLIR::Reference> &MLIR::references() const {
+  return _top_level_scope->references;
+}
+
 #pragma region _CStringLiteral
 
 void MLIR::_CStringLiteral::write(std::ostream &out) const {
-  Util::logger.trace({"MLIR", "_CStringLiteral"})
-      << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CStringLiteral"}) << __builtin_FUNCTION() << "()\n";
 
   out << "$\"" << this->value << '"';
 }
 
 llvm::Value *
 MLIR::_CStringLiteral::lower(llvm::Module *module, llvm::IRBuilder<> *builder) {
-  Util::logger.trace({"MLIR", "_CStringLiteral"})
-      << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CStringLiteral"}) << __builtin_FUNCTION() << "()\n";
 
   auto constant = builder->CreateGlobalString(this->value);
   // constant.
@@ -82,7 +94,7 @@ MLIR::_CStringLiteral::lower(llvm::Module *module, llvm::IRBuilder<> *builder) {
 #pragma region _CTypeRef
 
 MLIR::_CTypeRef MLIR::_CTypeRef::compile(std::shared_ptr<C::AST::TypeRef> ast) {
-  Util::logger.trace({"MLIR", "_CTypeRef"})
+  FNXC_TRACE({"MLIR", "_CTypeRef"})
       << __builtin_FUNCTION() << '(' << ast->trace() << ")\n";
 
   auto built_in_type = _search_c_built_in_type(ast->id_token.id);
@@ -97,7 +109,7 @@ MLIR::_CTypeRef MLIR::_CTypeRef::compile(std::shared_ptr<C::AST::TypeRef> ast) {
 }
 
 void MLIR::_CTypeRef::write(std::ostream &out) const {
-  Util::logger.trace({"MLIR", "_CTypeRef"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CTypeRef"}) << __builtin_FUNCTION() << "()\n";
 
   _write(this->type, out);
 
@@ -106,7 +118,7 @@ void MLIR::_CTypeRef::write(std::ostream &out) const {
 }
 
 llvm::Type *MLIR::_CTypeRef::lower(llvm::Module *module) const {
-  Util::logger.trace({"MLIR", "_CTypeRef"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CTypeRef"}) << __builtin_FUNCTION() << "()\n";
 
   switch (this->type) {
   case _CBuiltInType::Void: {
@@ -134,7 +146,7 @@ llvm::Type *MLIR::_CTypeRef::lower(llvm::Module *module) const {
 
 MLIR::_CFuncDecl::ArgDecl MLIR::_CFuncDecl::ArgDecl::compile(
     std::shared_ptr<const C::AST::FuncDecl::ArgDecl> ast) {
-  Util::logger.trace({"MLIR", "_CFuncDecl", "ArgDecl"})
+  FNXC_TRACE({"MLIR", "_CFuncDecl", "ArgDecl"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   auto type = _CTypeRef::compile(ast->type_node);
@@ -147,7 +159,7 @@ MLIR::_CFuncDecl::ArgDecl MLIR::_CFuncDecl::ArgDecl::compile(
 }
 
 llvm::Type *MLIR::_CFuncDecl::ArgDecl::lower(llvm::Module *module) const {
-  Util::logger.trace({"MLIR", "_CFuncDecl", "ArgDecl"})
+  FNXC_TRACE({"MLIR", "_CFuncDecl", "ArgDecl"})
       << __builtin_FUNCTION() << "()\n";
 
   return this->type.lower(module);
@@ -155,7 +167,7 @@ llvm::Type *MLIR::_CFuncDecl::ArgDecl::lower(llvm::Module *module) const {
 
 MLIR::_CFuncDecl
 MLIR::_CFuncDecl::compile(std::shared_ptr<const C::AST::FuncDecl> ast) {
-  Util::logger.trace({"MLIR", "_CFuncDecl"})
+  FNXC_TRACE({"MLIR", "_CFuncDecl"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   auto return_type = _CTypeRef::compile(ast->return_type_node);
@@ -192,7 +204,7 @@ MLIR::_CFuncDecl::compile(std::shared_ptr<const C::AST::FuncDecl> ast) {
 }
 
 void MLIR::_CFuncDecl::write(std::ostream &out, unsigned indent) const {
-  Util::logger.trace({"MLIR", "_CFuncDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CFuncDecl"}) << __builtin_FUNCTION() << "()\n";
 
   out << std::string(indent, '\t');
   out << "decl ";
@@ -212,8 +224,17 @@ void MLIR::_CFuncDecl::write(std::ostream &out, unsigned indent) const {
   out << ")\n";
 }
 
+std::string MLIR::_CFuncDecl::describe() const {
+  std::stringstream stream;
+  write(stream);
+
+  auto string = stream.str();
+  string.pop_back(); // The trailing newline
+  return string;
+}
+
 llvm::Function *MLIR::_CFuncDecl::lower(llvm::Module *module) const {
-  Util::logger.trace({"MLIR", "_CFuncDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CFuncDecl"}) << __builtin_FUNCTION() << "()\n";
 
   std::vector<llvm::Type *> llvm_args;
 
@@ -248,7 +269,7 @@ llvm::Function *MLIR::_CFuncDecl::lower(llvm::Module *module) const {
 #pragma region _CCall
 
 void MLIR::_CCall::write(std::ostream &out, unsigned indent) const {
-  Util::logger.trace({"MLIR", "_CCall"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CCall"}) << __builtin_FUNCTION() << "()\n";
 
   out << std::string(indent, '\t');
   out << "call @" << this->callee->id << '(';
@@ -268,7 +289,7 @@ void MLIR::_CCall::write(std::ostream &out, unsigned indent) const {
 
 llvm::Value *
 MLIR::_CCall::lower(llvm::Module *module, llvm::IRBuilder<> *builder) const {
-  Util::logger.trace({"MLIR", "_CCall"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_CCall"}) << __builtin_FUNCTION() << "()\n";
 
   llvm::Function *llvm_function = module->getFunction(this->callee->id);
 
@@ -303,13 +324,13 @@ MLIR::_CCall::lower(llvm::Module *module, llvm::IRBuilder<> *builder) const {
 #pragma region _VarRef
 
 void MLIR::_VarRef::write(std::ostream &out) const {
-  Util::logger.trace({"MLIR", "_VarRef"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarRef"}) << __builtin_FUNCTION() << "()\n";
   out << '%' << decl->id;
 }
 
 llvm::Value *
 MLIR::_VarRef::lower(llvm::Module *module, llvm::IRBuilder<> *builder) const {
-  Util::logger.trace({"MLIR", "_VarRef"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarRef"}) << __builtin_FUNCTION() << "()\n";
   assert(this->decl->_llvm_ref);
   return this->decl->_llvm_ref;
 }
@@ -321,7 +342,7 @@ MLIR::_VarRef::lower(llvm::Module *module, llvm::IRBuilder<> *builder) const {
 template <>
 void MLIR::_VarDecl::write<MLIR::_TopLevelScope>(
     std::ostream &out, unsigned indent) const {
-  Util::logger.trace({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
 
   // TODO: A top-level variable declaration is global if exported.
   //
@@ -342,7 +363,7 @@ void MLIR::_VarDecl::write<MLIR::_TopLevelScope>(
 template <>
 llvm::Value *MLIR::_VarDecl::lower<MLIR::_TopLevelScope>(
     llvm::Module *module, llvm::IRBuilder<> *builder) {
-  Util::logger.trace({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
 
   // TODO: A top-level variable declaration is global if exported.
   //
@@ -353,19 +374,27 @@ llvm::Value *MLIR::_VarDecl::lower<MLIR::_TopLevelScope>(
 template <>
 void MLIR::_VarDecl::write<MLIR::_Block>(
     std::ostream &out, unsigned indent) const {
-  Util::logger.trace({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
   _write_local(out, indent);
 }
 
 template <>
 llvm::Value *MLIR::_VarDecl::lower<MLIR::_Block>(
     llvm::Module *module, llvm::IRBuilder<> *builder) {
-  Util::logger.trace({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
   return _lower_to_local(module, builder);
 }
 
+std::string MLIR::_VarDecl::describe() const {
+  std::stringstream stream;
+  stream << "local ";
+  std::visit([&stream](auto type) { type.write(stream); }, this->type);
+  stream << " %" << this->id;
+  return stream.str();
+}
+
 void MLIR::_VarDecl::_write_local(std::ostream &out, unsigned indent) const {
-  Util::logger.trace({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
 
   out << std::string(indent, '\t');
   out << "local ";
@@ -382,7 +411,7 @@ void MLIR::_VarDecl::_write_local(std::ostream &out, unsigned indent) const {
 
 llvm::Value *MLIR::_VarDecl::_lower_to_local(
     llvm::Module *module, llvm::IRBuilder<> *builder) {
-  Util::logger.trace({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_VarDecl"}) << __builtin_FUNCTION() << "()\n";
 
   if (!(this->_llvm_ref)) {
     if (this->value.has_value()) {
@@ -428,7 +457,7 @@ llvm::Value *MLIR::_VarDecl::_lower_to_local(
 #pragma region _Assignment
 
 void MLIR::_Assignment::write(std::ostream &out, unsigned indent) const {
-  Util::logger.trace({"MLIR", "_Assignment"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_Assignment"}) << __builtin_FUNCTION() << "()\n";
   out << std::string(indent, '\t');
   out << '%' << this->lvalue.decl->id << " = ";
   std::visit([&out](auto &val) { val->write(out); }, this->rvalue);
@@ -436,13 +465,13 @@ void MLIR::_Assignment::write(std::ostream &out, unsigned indent) const {
 }
 
 void MLIR::_Assignment::write_rvalue(std::ostream &out) const {
-  Util::logger.trace({"MLIR", "_Assignment"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_Assignment"}) << __builtin_FUNCTION() << "()\n";
   std::visit([&out](auto &rval) { rval->write(out); }, this->rvalue);
 }
 
 llvm::Value *MLIR::_Assignment::lower(
     llvm::Module *module, llvm::IRBuilder<> *builder) const {
-  Util::logger.trace({"MLIR", "_Assignment"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_Assignment"}) << __builtin_FUNCTION() << "()\n";
   llvm::StoreInst *llvm_result;
 
   std::visit(
@@ -475,13 +504,13 @@ llvm::Value *MLIR::_Assignment::lower(
 #pragma region _PointerOf
 
 void MLIR::_PointerOf::write(std::ostream &out) const {
-  Util::logger.trace({"MLIR", "_PointerOf"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_PointerOf"}) << __builtin_FUNCTION() << "()\n";
   out << "pointerof(%" << this->value.decl->id << ")";
 }
 
 llvm::Value *MLIR::_PointerOf::lower(
     llvm::Module *module, llvm::IRBuilder<> *builder) const {
-  Util::logger.trace({"MLIR", "_PointerOf"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_PointerOf"}) << __builtin_FUNCTION() << "()\n";
   // TODO:
 }
 
@@ -491,10 +520,11 @@ llvm::Value *MLIR::_PointerOf::lower(
 
 std::shared_ptr<MLIR::_VarDecl>
 MLIR::_Scope::compile_var_decl(std::shared_ptr<Onyx::AST::VarDecl> ast) {
-  Util::logger.trace({"MLIR", "_Scope"})
+  FNXC_TRACE({"MLIR", "_Scope"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   auto id = ast->id_token.id;
+  FNXC_TRACE_EVENT("MLIR/_Scope", "compile_var_decl", id);
 
   if (auto previous = _search_var_decl(id))
     throw Panic(
@@ -511,6 +541,15 @@ MLIR::_Scope::compile_var_decl(std::shared_ptr<Onyx::AST::VarDecl> ast) {
     auto decl = std::make_shared<_VarDecl>(ast, id, restriction, move(rval));
     _add_expr(decl);
 
+    auto placement = ast->id_token.placement;
+    _add_reference(
+        {Reference::Kind::Variable,
+         true,
+         placement,
+         placement,
+         id,
+         decl->describe()});
+
     return decl;
   } else if (ast->type_restriction) {
     throw Unimplemented();
@@ -523,7 +562,7 @@ MLIR::_Scope::compile_var_decl(std::shared_ptr<Onyx::AST::VarDecl> ast) {
 
 std::shared_ptr<MLIR::_CCall>
 MLIR::_Scope::compile_c_call(std::shared_ptr<Onyx::AST::CCall> ast) {
-  Util::logger.trace({"MLIR", "_Scope"})
+  FNXC_TRACE({"MLIR", "_Scope"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   if (this->safety > Safety::Unsafe)
@@ -533,6 +572,7 @@ MLIR::_Scope::compile_c_call(std::shared_ptr<Onyx::AST::CCall> ast) {
         ast->callee.placement);
 
   auto callee_id = ast->callee.id;
+  FNXC_TRACE_EVENT("MLIR/_Scope", "compile_c_call", callee_id);
   std::shared_ptr<_CFuncDecl> c_func_decl = _search_c_func_decl(callee_id);
 
   if (!c_func_decl)
@@ -540,6 +580,14 @@ MLIR::_Scope::compile_c_call(std::shared_ptr<Onyx::AST::CCall> ast) {
         "Use of undeclared C function `" + callee_id + "`",
         ast->callee.placement);
 
+  _add_reference(
+      {Reference::Kind::CFunction,
+       false,
+       ast->callee.placement,
+       c_func_decl->ast->id_token.placement,
+       callee_id,
+       c_func_decl->describe()});
+
   std::vector<_RVal> args;
 
   for (auto &arg : ast->arguments) {
@@ -556,7 +604,7 @@ MLIR::_Scope::compile_c_call(std::shared_ptr<Onyx::AST::CCall> ast) {
 MLIR::_RVal MLIR::_Scope::compile_rval(Onyx::AST::RVal ast) {
   std::visit(
       [](auto &ast) {
-        Util::logger.trace({"MLIR", "_Scope"})
+        FNXC_TRACE({"MLIR", "_Scope"})
             << "compile_rval(" << ast->trace() << ")\n";
       },
       ast);
@@ -583,6 +631,14 @@ MLIR::_RVal MLIR::_Scope::compile_rval(Onyx::AST::RVal ast) {
     auto id = id_token.id;
 
     if (auto var_decl = _search_var_decl(id)) {
+      _add_reference(
+          {Reference::Kind::Variable,
+           false,
+           id_token.placement,
+           var_decl->ast->id_token.placement,
+           id,
+           var_decl->describe()});
+
       return std::make_unique<_VarRef>(var_decl);
     } else {
       throw Panic(
@@ -596,7 +652,7 @@ MLIR::_RVal MLIR::_Scope::compile_rval(Onyx::AST::RVal ast) {
 
 MLIR::_RVal MLIR::_Scope::compile_rval(
     std::shared_ptr<Onyx::AST::ExplicitSafetyStatement> ast) {
-  Util::logger.trace({"MLIR", "_Scope"})
+  FNXC_TRACE({"MLIR", "_Scope"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   auto scope = this->_create_child<_Block>(ast->safety(), this->storage);
@@ -610,7 +666,7 @@ MLIR::_RVal MLIR::_Scope::compile_rval(
 
 void MLIR::_Scope::compile_extern_directive(
     std::shared_ptr<Onyx::AST::ExternDirective> ast) {
-  Util::logger.trace({"MLIR", "_Scope"})
+  FNXC_TRACE({"MLIR", "_Scope"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   // TODO: What if it contains `#include`?
@@ -618,7 +674,7 @@ void MLIR::_Scope::compile_extern_directive(
 }
 
 void MLIR::_Scope::compile_c_ast(const C::AST *ast) {
-  Util::logger.trace({"MLIR", "_Scope"})
+  FNXC_TRACE({"MLIR", "_Scope"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   for (auto &child : ast->chidren()) {
@@ -637,7 +693,7 @@ void MLIR::_Scope::compile_c_ast(const C::AST *ast) {
 }
 
 MLIR::_TypeRestriction MLIR::_Scope::_infer(_RVal *hint) {
-  Util::logger.trace({"MLIR", "_Scope"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_Scope"}) << __builtin_FUNCTION() << "()\n";
 
   if (auto c_string_literal =
           std::get_if<std::unique_ptr<_CStringLiteral>>(hint)) {
@@ -648,10 +704,9 @@ MLIR::_TypeRestriction MLIR::_Scope::_infer(_RVal *hint) {
 }
 
 std::shared_ptr<MLIR::_VarDecl> MLIR::_Scope::_search_var_decl(std::string id) {
-  Util::logger.trace({"MLIR", "_Scope"})
-      << __builtin_FUNCTION() << "(" << id << ")\n";
+  FNXC_TRACE({"MLIR", "_Scope"}) << __builtin_FUNCTION() << "(" << id << ")\n";
 
-  if (auto ptr = *Util::Map::get_if(_var_decl_index, id))
+  if (auto ptr = Util::Map::get_if(_var_decl_index, id).value_or(nullptr))
     return ptr;
   else if (parent)
     return parent->_search_var_decl(id);
@@ -661,10 +716,9 @@ std::shared_ptr<MLIR::_VarDecl> MLIR::_Scope::_search_var_decl(std::string id) {
 
 std::shared_ptr<MLIR::_CFuncDecl>
 MLIR::_Scope::_search_c_func_decl(std::string id) {
-  Util::logger.trace({"MLIR", "_Scope"})
-      << __builtin_FUNCTION() << "(" << id << ")\n";
+  FNXC_TRACE({"MLIR", "_Scope"}) << __builtin_FUNCTION() << "(" << id << ")\n";
 
-  auto ptr = *Util::Map::get_if(_c_func_decls, id);
+  auto ptr = Util::Map::get_if(_c_func_decls, id).value_or(nullptr);
 
   if (!ptr && parent)
     return parent->_search_c_func_decl(id);
@@ -674,7 +728,7 @@ MLIR::_Scope::_search_c_func_decl(std::string id) {
 
 void MLIR::_Scope::_add_c_func_decl(
     std::shared_ptr<const C::AST::FuncDecl> ast) {
-  Util::logger.trace({"MLIR", "_Scope"})
+  FNXC_TRACE({"MLIR", "_Scope"})
       << __builtin_FUNCTION() << "(" << ast->trace() << ")\n";
 
   C::Token::Id id_token = ast->id_token;
@@ -688,10 +742,28 @@ void MLIR::_Scope::_add_c_func_decl(
 
   auto ptr = std::make_shared<_CFuncDecl>(_CFuncDecl::compile(ast));
   _c_func_decls[id] = ptr;
+
+  _add_reference(
+      {Reference::Kind::CFunction,
+       true,
+       id_token.placement,
+       id_token.placement,
+       id,
+       ptr->describe()});
+}
+
+void MLIR::_Scope::_add_reference(Reference reference) {
+  _Scope *scope = this;
+
+  while (scope->parent)
+    scope = scope->parent.get();
+
+  static_cast<_TopLevelScope *>(scope)->references.push_back(
+      std::move(reference));
 }
 
 void MLIR::_Scope::_add_expr(_Expr expr) {
-  Util::logger.trace({"MLIR", "_Scope"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_Scope"}) << __builtin_FUNCTION() << "()\n";
 
   if (auto var_decl = std::get_if<std::shared_ptr<_VarDecl>>(&expr)) {
     _var_decl_index[var_decl->get()->id] = *var_decl;
@@ -705,8 +777,7 @@ void MLIR::_Scope::_add_expr(_Expr expr) {
 #pragma region _TopLevelScope
 
 void MLIR::_TopLevelScope::write(std::ostream &out) const {
-  Util::logger.trace({"MLIR", "_TopLevelScope"})
-      << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_TopLevelScope"}) << __builtin_FUNCTION() << "()\n";
 
   for (auto &decl : _c_func_decls) {
     decl.second->write(out);
@@ -732,8 +803,7 @@ void MLIR::_TopLevelScope::write(std::ostream &out) const {
 }
 
 void MLIR::_TopLevelScope::lower(llvm::Module *module) const {
-  Util::logger.trace({"MLIR", "_TopLevelScope"})
-      << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_TopLevelScope"}) << __builtin_FUNCTION() << "()\n";
 
   for (auto &decl : _c_func_decls) {
     decl.second->lower(module);
@@ -796,7 +866,7 @@ void MLIR::_TopLevelScope::lower(llvm::Module *module) const {
 
 llvm::Value *
 MLIR::_Block::lower(llvm::Module *module, llvm::IRBuilder<> *builder) const {
-  Util::logger.trace({"MLIR", "_Block"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_Block"}) << __builtin_FUNCTION() << "()\n";
 
   llvm::Value *last_value;
 
@@ -818,7 +888,7 @@ MLIR::_Block::lower(llvm::Module *module, llvm::IRBuilder<> *builder) const {
 }
 
 void MLIR::_Block::write(std::ostream &out, unsigned indent) const {
-  Util::logger.trace({"MLIR", "_Block"}) << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE({"MLIR", "_Block"}) << __builtin_FUNCTION() << "()\n";
 
   for (auto &expr : this->_exprs) {
     std::visit(
@@ -24,12 +24,33 @@ void AST::inspect(std::ostream &stream, unsigned short indent) const {
   stream << "\n";
 }
 
+void AST::Error::inspect(std::ostream &stream, unsigned short indent) const {
+  fmt::print(
+      stream,
+      "{0}{1}\n{2}Panic: {3}\n",
+      node_prefix(indent),
+      node_name(),
+      attribute_prefix(indent),
+      this->panic.what());
+}
+
 void AST::ExternDirective::inspect(
     std::ostream &stream, unsigned short indent) const {
   fmt::print(stream, "{0}{1}\n", node_prefix(indent), node_name());
   this->block->ast()->inspect(stream, indent + 1);
 }
 
+void AST::ImportDirective::inspect(
+    std::ostream &stream, unsigned short indent) const {
+  fmt::print(
+      stream,
+      "{0}{1}\n{2}Path: {3}\n",
+      node_prefix(indent),
+      node_name(),
+      attribute_prefix(indent),
+      this->path.Token::inspect());
+}
+
 // void AST::StringLiteral::inspect(
 //     std::ostream &stream, unsigned short indent) const {
 //   fmt::print(
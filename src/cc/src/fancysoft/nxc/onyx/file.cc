@@ -3,32 +3,56 @@
 #include "fancysoft/nxc/onyx/file.hh"
 #include "fancysoft/nxc/onyx/parser.hh"
 #include "fancysoft/util/logger.hh"
+#include "fancysoft/util/time_trace.hh"
+#include "fancysoft/util/trace_log.hh"
 
 namespace Fancysoft::NXC::Onyx {
 
 Position File::parse() {
   assert(!_parsed);
-  Util::logger.debug("File") << "Parsing " << this->path << "\n";
+  FNXC_DEBUG("File") << "Parsing " << this->path << "\n";
+  Util::TimeTrace::Scope scope("Parse", [this]() { return path.string(); });
+
+  if (_encoding_error) {
+    auto end = Position(_encoding_error->row, _encoding_error->col + 1);
+
+    throw Panic(
+        "Invalid UTF-8 sequence",
+        Placement(shared_from_this(), Location(*_encoding_error, end)));
+  }
 
   auto lexer = std::make_shared<Lexer>(shared_from_this());
   Parser parser(lexer);
 
   _ast = move(parser.parse());
+
+  for (auto &panic : parser.panics())
+    _panics.push_back(panic);
+
+  for (auto &node : _ast->children())
+    if (auto import =
+            std::get_if<std::shared_ptr<AST::ImportDirective>>(&node))
+      _dependencies.push_back(resolve_import((*import)->path.string));
+
   _parsed = true;
 
-  Util::logger.trace("File") << "Parsed " << this->path << "\n";
+  FNXC_TRACE("File") << "Parsed " << this->path << "\n";
+  FNXC_TRACE_EVENT("File", "parsed", path.string());
   return lexer->cursor();
 }
 
 void File::compile() {
   assert(!compiled());
-  Util::logger.debug("File") << "Compiling " << this->path << "\n";
+  FNXC_DEBUG("File") << "Compiling " << this->path << "\n";
 
   if (!_parsed)
     parse();
 
+  Util::TimeTrace::Scope scope("MLIR", [this]() { return path.string(); });
+
   _mlir = std::make_unique<MLIR>(_ast.get(), _program);
-  Util::logger.trace("File") << "Compiled " << this->path << "\n";
+  FNXC_TRACE("File") << "Compiled " << this->path << "\n";
+  FNXC_TRACE_EVENT("File", "compiled", path.string());
 }
 
 } // namespace Fancysoft::NXC::Onyx
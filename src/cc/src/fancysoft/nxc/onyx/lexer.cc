@@ -30,12 +30,14 @@ Util::Coro::Generator<Token::Any> Lexer::lex() noexcept {
         continue;
       }
 
-      // Either a keyword or an identifier.
-      else if (_is_latin_lowercase() || _is('_')) {
+      // Either a keyword or an identifier, which may contain non-ASCII
+      // code points.
+      else if (_is_latin_lowercase() || _is('_') || _is_non_ascii()) {
         std::stringbuf buf;
 
-        while (_is_latin_lowercase() || _is({'_', '!', '?'}) || _is_decimal()) {
-          buf.sputc(_code_point);
+        while (_is_latin_lowercase() || _is({'_', '!', '?'}) ||
+               _is_decimal() || _is_non_ascii()) {
+          _append_code_point(buf);
           _advance();
         }
 
@@ -71,7 +73,7 @@ Util::Coro::Generator<Token::Any> Lexer::lex() noexcept {
           std::stringbuf buf;
 
           while (_is_latin_alpha() || _is_decimal() || _is('_')) {
-            buf.sputc(_code_point);
+            _append_code_point(buf);
             _advance();
           }
 
@@ -85,7 +87,7 @@ Util::Coro::Generator<Token::Any> Lexer::lex() noexcept {
         std::stringbuf buf;
 
         while (_is_op()) {
-          buf.sputc(_code_point);
+          _append_code_point(buf);
           _advance();
         }
 
@@ -113,8 +115,8 @@ Util::Coro::Generator<Token::Any> Lexer::lex() noexcept {
         continue;
       }
     } while (!_is_eof());
-  } catch (std::exception &e) {
-    _exception = e;
+  } catch (std::exception &) {
+    _exception = std::current_exception();
     co_return;
   }
 };
@@ -124,7 +126,7 @@ std::string Lexer::_lex_string_literal_content(char terminator) {
   bool escaped = false;
 
   while (!(_is(terminator) && !escaped)) {
-    buf.sputc(_code_point);
+    _append_code_point(buf);
     _advance();
     escaped = _is('\\');
   }
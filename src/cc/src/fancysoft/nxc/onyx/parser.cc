@@ -13,100 +13,155 @@ std::unique_ptr<AST> Parser::parse() {
   auto ast = std::make_unique<AST>();
 
   while (!_lexer_done()) {
-    if (_is_punct({Token::Punct::HSpace, Token::Punct::Newline})) {
-      _advance();
-      continue;
+    try {
+      _parse_top_level(*ast);
+    } catch (Panic &panic) {
+      ast->add_child(std::make_shared<AST::Error>(panic));
+      _recover(panic);
+      _synchronize();
     }
+  }
 
-    // An `extern` statement.
-    else if (auto token = _if_keyword(Token::Keyword::Extern)) {
-      _lexer->_unread(); // HACK: Unread whatever followed `extern`
+  _recover_lexer();
+  FNXC_DEBUG(_debug_name()) << "Done parsing\n";
 
-      auto placement = Placement(_lexer->unit, _lexer->cursor());
-      auto c_block = std::make_shared<C::Block>(
-          C::Block(placement, _lexer->unit->source_stream()));
+  return ast;
+}
 
-      // Need to offset the lexer, because a C block is a part
-      // of the source file being lexed.
-      //
-      auto offset = c_block->parse();
-      _lexer->offset(offset);
-      c_block->placement.location.end = _lexer->cursor();
+void Parser::_parse_top_level(AST &ast) {
+  if (_is_punct({Token::Punct::HSpace, Token::Punct::Newline})) {
+    _advance();
+    return;
+  }
 
-      auto node =
-          std::make_shared<AST::ExternDirective>(token.value(), c_block);
+  // An `extern` statement.
+  else if (auto token = _if_keyword(Token::Keyword::Extern)) {
+    _lexer->_unread(); // HACK: Unread whatever followed `extern`
 
-      _debug_parsed(node->node_name());
-      ast->add_child(AST::TopLevelNode(node));
+    auto placement = Placement(_lexer->unit, _lexer->cursor());
+    auto c_block = std::make_shared<C::Block>(
+        C::Block(placement, _lexer->unit->source_stream()));
 
-      _advance();
-      continue;
-    }
+    // Need to offset the lexer, because a C block is a part
+    // of the source file being lexed.
+    //
+    auto offset = c_block->parse();
+    _lexer->offset(offset);
+    c_block->placement.location.end = _lexer->cursor();
 
-    // A variable definition.
-    else if (
-        auto keyword =
-            _if_keyword({Token::Keyword::Let, Token::Keyword::Final})) {
-      _advance();
-      _as_punct(Token::Punct::HSpace);
+    // The C parser has recovered from its own panics.
+    for (auto &panic : c_block->panics())
+      _recover(panic);
 
-      auto id = _next_as<Token::Id>();
+    auto node = std::make_shared<AST::ExternDirective>(token.value(), c_block);
 
-      _advance();
-      _skip_space();
+    _debug_parsed(node->node_name());
+    ast.add_child(AST::TopLevelNode(node));
 
-      if (auto op = _if<Token::Op>()) {
-        if (op->op == "=") {
-          _advance(); // Consume `=`
-          _skip_space();
+    _advance();
+    return;
+  }
 
-          auto rval = _parse_rval();
+  // An `import` directive, e.g. `import "./foo.nx"`.
+  else if (auto keyword = _if_keyword(Token::Keyword::Import)) {
+    _advance();
+    _as_punct(Token::Punct::HSpace);
 
-          auto node = std::make_shared<AST::VarDecl>(
-              keyword.value(), id, nullptr, rval);
+    auto path = _next_as<Token::StringLiteral>();
+    auto node = std::make_shared<AST::ImportDirective>(keyword.value(), path);
 
-          _debug_parsed(node->node_name());
-          ast->add_child(node);
+    _debug_parsed(node->node_name());
+    ast.add_child(AST::TopLevelNode(node));
+
+    _advance();
+    return;
+  }
+
+  // A variable definition.
+  else if (
+      auto keyword =
+          _if_keyword({Token::Keyword::Let, Token::Keyword::Final})) {
+    _advance();
+    _as_punct(Token::Punct::HSpace);
+
+    auto id = _next_as<Token::Id>();
+
+    _advance();
+    _skip_space();
+
+    if (auto op = _if<Token::Op>()) {
+      if (op->op == "=") {
+        _advance(); // Consume `=`
+        _skip_space();
+
+        auto rval = _parse_rval();
+
+        auto node = std::make_shared<AST::VarDecl>(
+            keyword.value(), id, nullptr, rval);
 
-          continue;
-        } else {
-          throw Panic("Unexpected operator", op->placement);
-        }
-      } else {
-        auto node = std::make_shared<AST::VarDecl>(keyword.value(), id);
         _debug_parsed(node->node_name());
-        ast->add_child(node);
-        continue;
+        ast.add_child(node);
+
+        return;
+      } else {
+        throw Panic("Unexpected operator", op->placement);
       }
+    } else {
+      auto node = std::make_shared<AST::VarDecl>(keyword.value(), id);
+      _debug_parsed(node->node_name());
+      ast.add_child(node);
+      return;
     }
+  }
 
-    // An explicit safety region statement beginning with an explicit
-    // safety keyword, e.g. `unsafe!`.
-    else if (
-        auto keyword = _if_keyword(
-            {Token::Keyword::UnsafeBang, Token::Keyword::FragileBang})) {
-      _advance();
-      _as_punct(Token::Punct::HSpace);
+  // An explicit safety region statement beginning with an explicit
+  // safety keyword, e.g. `unsafe!`.
+  else if (
+      auto keyword = _if_keyword(
+          {Token::Keyword::UnsafeBang, Token::Keyword::FragileBang})) {
+    _advance();
+    _as_punct(Token::Punct::HSpace);
 
-      auto rval = _parse_rval();
-      auto node =
-          std::make_shared<AST::ExplicitSafetyStatement>(keyword.value(), rval);
+    auto rval = _parse_rval();
+    auto node =
+        std::make_shared<AST::ExplicitSafetyStatement>(keyword.value(), rval);
 
-      _debug_parsed(node->node_name());
-      ast->add_child(node);
+    _debug_parsed(node->node_name());
+    ast.add_child(node);
 
-      _advance();
-      continue;
-    }
+    _advance();
+    return;
+  }
 
-    else {
-      throw _unexpected();
-    }
+  else {
+    throw _unexpected();
   }
+}
 
-  Util::logger.debug(_debug_name()) << "Done parsing\n";
+void Parser::_synchronize() {
+  static const std::set<Token::Keyword::Kind> top_level_keywords = {
+      Token::Keyword::Extern,
+      Token::Keyword::Import,
+      Token::Keyword::Let,
+      Token::Keyword::Final,
+      Token::Keyword::UnsafeBang,
+      Token::Keyword::FragileBang};
 
-  return ast;
+  // At least the offending token is skipped, so that the parsing progresses.
+  bool skipped = false;
+
+  while (!_lexer_done()) {
+    if (_is_newline()) {
+      _advance();
+      return;
+    }
+
+    if (skipped && _is_keyword(top_level_keywords))
+      return;
+
+    _advance();
+    skipped = true;
+  }
 }
 
 AST::RVal Parser::_parse_rval() {
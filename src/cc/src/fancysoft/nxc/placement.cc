@@ -39,4 +39,16 @@ void Placement::debug(std::ostream &stream) const {
   }
 }
 
+std::optional<std::pair<std::filesystem::path, Position>>
+Placement::resolve() const {
+  if (auto file = dynamic_cast<Onyx::File *>(unit.get())) {
+    return std::make_pair(file->path, location.start);
+  } else if (auto block = dynamic_cast<C::Block *>(unit.get())) {
+    if (auto parent = block->placement.resolve())
+      return std::make_pair(parent->first, parent->second + location.start);
+  }
+
+  return std::nullopt;
+}
+
 } // namespace Fancysoft::NXC
@@ -1,220 +1,1087 @@
 #include <fmt/ostream.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/TargetProcess/TargetExecutionUtils.h>
+#include <llvm/MC/SubtargetFeature.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 
 #include <lld/Common/Driver.h>
 #include <memory>
 #include <ostream>
 #include <sstream>
+#include <thread>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "fancysoft/nxc/exception.hh"
 #include "fancysoft/nxc/onyx/file.hh"
 #include "fancysoft/nxc/program.hh"
+#include "fancysoft/util/executor.hh"
 #include "fancysoft/util/logger.hh"
+#include "fancysoft/util/tar.hh"
+#include "fancysoft/util/thread_pool.hh"
+#include "fancysoft/util/time_trace.hh"
 
 namespace Fancysoft::NXC {
 
 Program::Program(CompilationContext ctx, std::shared_ptr<Workspace> workspace) :
     _compilation_ctx(ctx), workspace(workspace) {
-  auto module = std::make_shared<Onyx::File>(ctx.entry_path, this);
-  _modules[ctx.entry_path] = module;
-  _entry_module = module;
+  _compilation_ctx.target = ctx.target.resolve();
+  _add_entry_module();
+}
+
+bool Program::refresh() {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+
+  bool modified = false;
+
+  for (auto &source : _source_write_times) {
+    std::error_code err;
+    auto time = std::filesystem::last_write_time(source.first, err);
+
+    if (err || time != source.second) {
+      FNXC_DEBUG("Program")
+          << "Source file " << source.first << " has been modified\n";
+
+      modified = true;
+      break;
+    }
+  }
+
+  if (modified) {
+    // The objects may still be being written from the old modules.
+    _await_obj_cache_writes();
+
+    _entry_module.reset();
+    _modules.clear();
+    _source_write_times.clear();
+    _add_entry_module();
+  }
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+  return modified;
+}
+
+void Program::set_source(std::filesystem::path path, std::string source) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "(" << path << ")\n";
+
+  // The objects may still be being written from the old module.
+  _await_obj_cache_writes();
+
+  auto module = std::make_shared<Onyx::File>(path, std::move(source), this);
+  _modules[path] = module;
+
+  // An in-memory source is never considered modified on the disk.
+  _source_write_times.erase(path);
+
+  if (path == _compilation_ctx.entry_path)
+    _entry_module = module;
+}
+
+std::shared_ptr<Onyx::File>
+Program::module(std::filesystem::path path) const {
+  auto found = _modules.find(path);
+  return found == _modules.end() ? nullptr : found->second;
+}
+
+std::vector<std::shared_ptr<Onyx::File>> Program::modules() const {
+  std::vector<std::shared_ptr<Onyx::File>> modules;
+
+  for (auto &pair : _modules)
+    modules.push_back(pair.second);
+
+  return modules;
+}
+
+void Program::_add_entry_module() {
+  _entry_module = _add_module(_compilation_ctx.entry_path);
+}
+
+std::shared_ptr<Onyx::File>
+Program::_add_module(const std::filesystem::path &path) {
+  auto module = workspace->module(path, _module_cache_key(), [&path]() {
+    return std::make_shared<Onyx::File>(path, nullptr);
+  });
+
+  _modules[path] = module;
+
+  // A missing file is reported upon parsing.
+  std::error_code err;
+  auto time = std::filesystem::last_write_time(path, err);
+  _source_write_times[path] = err ? decltype(time)::min() : time;
+
+  return module;
+}
+
+std::string Program::_module_cache_key() const {
+  auto &ctx = _compilation_ctx;
+  return fmt::format("{}-O{}", ctx.target.cache_key(), ctx.opt_level);
 }
 
 void Program::compile_mlir() {
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+
+  if (_run_pipeline(_Stage::MLIR))
+    _update_index();
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
+
+void Program::_update_index() try {
+  auto index = workspace->index();
 
-  if (!_entry_module->compiled())
-    _entry_module->compile();
+  if (!index)
+    return;
 
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "() exit\n";
+  bool updated = _index_pending.exchange(false);
+
+  for (auto &[path, module] : _modules) {
+    // Already indexed if released.
+    if (!module->mlir())
+      continue;
+
+    if (_index_module(*index, path, *module))
+      updated = true;
+  }
+
+  if (updated)
+    index->commit();
+} catch (const std::string &err) {
+  // The index is an aid to tooling, so a failure shall not fail the build.
+  Util::logger.warn("Program") << "Failed to update the index: " << err << "\n";
+} catch (const std::exception &err) {
+  Util::logger.warn("Program")
+      << "Failed to update the index: " << err.what() << "\n";
 }
 
+bool Program::_index_module(
+    Index &index, const std::filesystem::path &path, Onyx::File &module) {
+  // In-memory sources are indexed once saved.
+  if (!module.mlir())
+    return false;
+
+  {
+    std::lock_guard lock(_modules_mutex);
+
+    if (!_source_write_times.count(path))
+      return false;
+  }
+
+  auto hash = Index::hash_file(path);
+
+  if (!hash || index.fresh(path, *hash))
+    return false;
+
+  std::vector<Index::Entry> entries;
+
+  for (auto &ref : module.mlir()->references()) {
+    auto use = ref.use.resolve();
+    auto decl = ref.declaration.resolve();
+
+    if (!use || !decl)
+      continue;
+
+    Index::Kind kind;
+
+    switch (ref.kind) {
+    case MLIR::Reference::Kind::Variable:
+      kind = ref.is_declaration ? Index::Kind::VarDecl : Index::Kind::VarRef;
+      break;
+    case MLIR::Reference::Kind::CFunction:
+      kind =
+          ref.is_declaration ? Index::Kind::CFuncDecl : Index::Kind::CFuncRef;
+      break;
+    }
+
+    entries.push_back(Index::Entry{
+        kind,
+        ref.id,
+        std::filesystem::absolute(use->first),
+        use->second,
+        std::filesystem::absolute(decl->first),
+        decl->second,
+        ref.description});
+  }
+
+  index.update(path, *hash, entries);
+  return true;
+}
+
+namespace {
+
+/// Return the *ir* of the *module*, throwing if it has been released in the
+/// low-memory mode.
+template <typename T>
+T &retained(T *ir, const Onyx::File &module, const char *name) {
+  if (!ir)
+    throw std::string("The ") + name + " of " + module.path.string() +
+        " has been released in the low-memory mode";
+
+  return *ir;
+}
+
+} // namespace
+
 void Program::emit_mlir(
     std::variant<std::filesystem::path, std::ostream *> out,
     IROutputFormat format) {
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
   compile_mlir();
 
+  _emit_ir(out, format, ".ml", [](Onyx::File &module) {
+    std::ostringstream stream;
+    retained(module.mlir(), module, "MLIR").write(stream);
+    return stream.str();
+  });
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
+
+void Program::compile_llir() {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+
+  if (_run_pipeline(_Stage::Optimize))
+    _update_index();
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
+
+void Program::emit_llir(
+    std::variant<std::filesystem::path, std::ostream *> out,
+    IROutputFormat format) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+  compile_llir();
+
+  _emit_ir(out, format, ".ll", [](Onyx::File &module) {
+    std::string buffer;
+    llvm::raw_string_ostream stream(buffer);
+    retained(module.llir(), module, "LLIR").print(stream, nullptr, true, true);
+    return std::move(stream.str());
+  });
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
+
+void Program::emit_bc(
+    std::variant<std::filesystem::path, std::ostream *> out,
+    IROutputFormat format) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+  compile_llir();
+
+  _emit_ir(out, format, ".bc", [](Onyx::File &module) {
+    std::string buffer;
+    llvm::raw_string_ostream stream(buffer);
+    llvm::WriteBitcodeToFile(retained(module.llir(), module, "LLIR"), stream);
+    return std::move(stream.str());
+  });
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
+
+void Program::emit_exe(
+    std::filesystem::path exe_path,
+    std::vector<std::filesystem::path> lib_paths,
+    std::vector<std::string> linked_libs) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+  _compile_obj();
+  _link(exe_path, lib_paths, linked_libs);
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
+
+int Program::run(std::vector<std::string> args) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+  compile_llir();
+
+  auto &target = _compilation_ctx.target;
+  auto triple = llvm::Triple(target.triple);
+  auto host = llvm::Triple(llvm::sys::getProcessTriple());
+
+  if (triple.getArch() != host.getArch() || triple.getOS() != host.getOS())
+    throw "Can not run a program compiled for " + target.triple +
+        " on the " + host.str() + " host";
+
+  auto jtmb = llvm::orc::JITTargetMachineBuilder(triple);
+  jtmb.setCPU(target.cpu);
+  jtmb.addFeatures(llvm::SubtargetFeatures(target.features).getFeatures());
+
+  auto jit = llvm::orc::LLLazyJITBuilder()
+                 .setJITTargetMachineBuilder(std::move(jtmb))
+                 .create();
+
+  if (!jit)
+    throw "Failed to create a JIT: " + llvm::toString(jit.takeError());
+
+  // Only compile the requested function upon its first call.
+  (*jit)->setPartitionFunction(
+      llvm::orc::CompileOnDemandLayer::compileRequested);
+
+  auto host_symbols =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          (*jit)->getDataLayout().getGlobalPrefix());
+
+  if (!host_symbols)
+    throw "Failed to load host process symbols: " +
+        llvm::toString(host_symbols.takeError());
+
+  (*jit)->getMainJITDylib().addGenerator(std::move(*host_symbols));
+
+  // The JIT takes ownership of the modules, thus clone them so that the
+  // program may be re-run or emitted later on.
+  for (auto &module : _modules) {
+    llvm::orc::ThreadSafeContext context;
+    std::unique_ptr<llvm::Module> clone;
+
+    {
+      // The module may be shared with a concurrently built program.
+      std::lock_guard lock(module.second->mutex);
+      auto &llir = retained(module.second->llir(), *module.second, "LLIR");
+      context = module.second->llvm_context();
+      auto context_lock = context.getLock();
+      clone = llvm::CloneModule(llir);
+    }
+
+    if (auto err = (*jit)->addLazyIRModule(
+            llvm::orc::ThreadSafeModule(std::move(clone), context)))
+      throw "Failed to add module " + module.first.string() +
+          " to the JIT: " + llvm::toString(std::move(err));
+  }
+
+  auto main = (*jit)->lookup("main");
+
+  if (!main)
+    throw "Failed to look up `main`: " + llvm::toString(main.takeError());
+
+  FNXC_DEBUG("Program") << "Running `main` in-process\n";
+
+  auto main_ptr = llvm::jitTargetAddressToFunction<int (*)(int, char *[])>(
+      main->getAddress());
+
+  Util::TimeTrace::Scope scope("Run");
+  auto progname = _compilation_ctx.entry_path.string();
+  auto exit_code =
+      llvm::orc::runAsMain(main_ptr, args, llvm::StringRef(progname));
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+  return exit_code;
+}
+
+namespace {
+
+/// Serialize the *module* on a worker of the *executor*. The module lock is
+/// held, as the module may be shared with a concurrently built program, as
+/// well as its LLVM context lock, as the context may be shared with the JIT.
+Util::Coro::Task<std::string> serialize_on(
+    Util::Coro::Executor &executor,
+    Onyx::File &module,
+    const std::function<std::string(Onyx::File &)> &serialize) {
+  co_await executor.schedule();
+  std::lock_guard lock(module.mutex);
+
+  auto context = module.llvm_context();
+  std::optional<llvm::orc::ThreadSafeContext::Lock> context_lock;
+
+  if (context.getContext())
+    context_lock.emplace(context.getLock());
+
+  co_return serialize(module);
+}
+
+/// Add the *module* serialized on the *executor* to the *archive* as a member
+/// named *name*, as soon as it is serialized.
+Util::Coro::Task<> archive_on(
+    Util::Coro::Executor &executor,
+    Util::Tar::Writer &archive,
+    std::string name,
+    Onyx::File &module,
+    const std::function<std::string(Onyx::File &)> &serialize) {
+  auto contents = co_await serialize_on(executor, module, serialize);
+  archive.add(name, contents);
+}
+
+} // namespace
+
+void Program::_emit_ir(
+    std::variant<std::filesystem::path, std::ostream *> out,
+    IROutputFormat format,
+    const char *extension,
+    std::function<std::string(Onyx::File &)> serialize) {
+  Util::TimeTrace::Scope scope("EmitIR", extension);
+  std::unique_ptr<std::ofstream> file;
+  std::ostream *output;
+
+  if (auto path = std::get_if<std::filesystem::path>(&out)) {
+    file = std::make_unique<std::ofstream>(
+        *path, std::ios::trunc | std::ios::binary);
+    output = file.get();
+  } else {
+    output = std::get<std::ostream *>(out);
+  }
+
+  // Bounded by the shared executor workers rather than a thread per module.
+  auto &executor = Util::Coro::Executor::shared();
+
   switch (format) {
   case IROutputFormat::Raw: {
-    Util::logger.debug("Program") << "Emitting MLIR, raw\n";
+    FNXC_DEBUG("Program") << "Emitting " << extension << ", raw\n";
 
-    std::unique_ptr<std::ofstream> file;
-    std::ostream *output;
+    // Serialize in parallel, but write in the modules order.
+    std::vector<Util::Coro::Task<std::string>> tasks;
 
-    if (auto path = std::get_if<std::filesystem::path>(&out)) {
-      file = std::make_unique<std::ofstream>(*path, std::ios::trunc);
-      output = file.get();
-    } else {
-      output = std::get<std::ostream *>(out);
-    }
+    for (auto &module : _modules)
+      tasks.push_back(serialize_on(executor, *module.second, serialize));
 
     bool first = true;
-    for (auto &module : _modules) {
+    for (auto &serialized :
+         executor.block_on(Util::Coro::when_all(std::move(tasks)))) {
       if (first)
         first = false;
       else
         *output << '\x1C';
 
-      module.second->mlir()->write(*output);
+      *output << serialized;
     }
 
-    Util::logger.trace("Program") << "Successfully emitted MLIR\n";
+    break;
+  }
+  case IROutputFormat::Tar: {
+    FNXC_DEBUG("Program") << "Emitting " << extension << ", tar\n";
+
+    // A member is written as soon as it is serialized.
+    Util::Tar::Writer archive(*output);
+    std::vector<Util::Coro::Task<>> tasks;
+
+    for (auto &module : _modules) {
+      auto name = module.first;
+      name.replace_extension(extension);
+
+      tasks.push_back(archive_on(
+          executor,
+          archive,
+          name.relative_path().generic_string(),
+          *module.second,
+          serialize));
+    }
+
+    executor.block_on(Util::Coro::when_all(std::move(tasks)));
+
+    archive.finish();
+    break;
   }
   }
 
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "() exit\n";
+  output->flush();
+  FNXC_TRACE("Program") << "Successfully emitted " << extension << "\n";
 }
 
-void Program::compile_llir() {
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "()\n";
-  compile_mlir();
+void Program::_compile_obj() {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
 
-  if (!_llvm_ctx)
-    _llvm_ctx = std::make_unique<_LLVMContext>();
+  if (_run_pipeline(_Stage::Codegen))
+    _update_index();
 
-  for (auto &mlir_module : _modules) {
-    if (mlir_module.second->lowered())
-      continue;
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
 
-    auto llvm_module = std::make_unique<llvm::Module>(
-        mlir_module.first.string(), *_llvm_ctx->raw_context);
+namespace {
+
+/// Moves modules through the compilation stages on an executor, each as
+/// soon as it may, so that e.g. a module is assembled while another is still
+/// being parsed. A module is compiled to MLIR once all the modules it depends
+/// on are; the other stages only depend on the module's own previous stage.
+/// Thus the wall time approaches the critical path of the dependency graph.
+///
+/// A module's dependencies are known once it is parsed, and those not in the
+/// pipeline yet join it right away, so that they are parsed while the others
+/// go through the later stages.
+///
+/// A module goes through the stages in a coroutine, which is suspended while
+/// awaiting its dependencies rather than blocking a worker.
+template <typename Stage> class Pipeline {
+public:
+  /// Run a *stage* of the module at *path*.
+  using Action = std::function<void(Stage, const std::filesystem::path &)>;
+
+  /// Return the paths of the modules which a parsed module depends on.
+  using Dependencies = std::function<std::vector<std::filesystem::path>(
+      const std::filesystem::path &)>;
+
+  /// Called for a *dependency* of the *dependent* module before it joins
+  /// the pipeline. May throw to fail the dependent.
+  using Discover = std::function<void(
+      const std::filesystem::path &dependent,
+      const std::filesystem::path &dependency)>;
+
+  /// Schedule *paths* and the modules they depend on, transitively, to go
+  /// through the stages until the *last* one.
+  Pipeline(
+      const std::vector<std::filesystem::path> &paths,
+      Stage last,
+      Action action,
+      Dependencies dependencies,
+      Discover discover) :
+      _paths(paths),
+      _last(last),
+      _action(action),
+      _dependencies(dependencies),
+      _discover(discover) {}
+
+  /// Run the pipeline, blocking until it is done. Rethrows the first error,
+  /// in which case the pending work is abandoned.
+  void run(Util::Coro::Executor &executor) {
+    _executor = &executor;
+    std::vector<Util::Coro::Task<>> tasks;
+
+    for (auto &path : _paths)
+      if (auto node = _join(path))
+        tasks.push_back(_run(*node));
+
+    try {
+      executor.block_on(Util::Coro::when_all(std::move(tasks)));
+    } catch (Util::Coro::Executor::Deadlock &) {
+      // Some modules would await each other forever.
+      throw std::string("Cyclic module dependency");
+    }
+  }
+
+  /// Return the paths of the modules which have joined the pipeline.
+  std::vector<std::filesystem::path> paths() const {
+    std::lock_guard lock(_mutex);
+    std::vector<std::filesystem::path> paths;
 
-    llvm_module->setTargetTriple(_llvm_ctx->target_triple);
-    llvm_module->setDataLayout(_llvm_ctx->target_machine->createDataLayout());
+    for (auto &[path, node] : _nodes)
+      paths.push_back(path);
 
-    mlir_module.second->lower(move(llvm_module));
+    return paths;
   }
 
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "() exit\n";
-}
+private:
+  struct Node {
+    std::filesystem::path path;
 
-void Program::emit_llir(
-    std::variant<std::filesystem::path, std::ostream *> out,
-    IROutputFormat format) {
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "()\n";
-  compile_llir();
+    /// Set once compiled to MLIR, or failed before.
+    std::optional<Util::Coro::Event> mlir_compiled;
+  };
 
-  switch (format) {
-  case IROutputFormat::Raw: {
-    Util::logger.debug("Program") << "Emitting LLIR, raw\n";
+  const std::vector<std::filesystem::path> _paths;
+  const Stage _last;
+  Action _action;
+  Dependencies _dependencies;
+  Discover _discover;
 
-    std::unique_ptr<std::ofstream> file;
-    std::ostream *output;
+  Util::Coro::Executor *_executor = nullptr;
 
-    if (auto path = std::get_if<std::filesystem::path>(&out)) {
-      file = std::make_unique<std::ofstream>(*path, std::ios::trunc);
-      output = file.get();
-    } else {
-      output = std::get<std::ostream *>(out);
-    }
+  /// Guards the nodes, which are added while running.
+  mutable std::mutex _mutex;
 
-    auto llvm_ostream = llvm::raw_os_ostream(*output);
+  std::map<std::filesystem::path, Node> _nodes;
 
-    bool first = true;
-    for (auto &module : _modules) {
-      if (first)
-        first = false;
-      else
-        *output << '\x1C';
+  /// Set upon the first error, so that the pending stages are skipped.
+  std::atomic<bool> _failed = false;
+
+  /// Add a node for *path* unless added already, in which case return null.
+  /// A *dependent* is discovered to depend on it.
+  Node *_join(
+      const std::filesystem::path &path,
+      const std::filesystem::path *dependent = nullptr) {
+    std::lock_guard lock(_mutex);
+
+    if (_nodes.count(path))
+      return nullptr;
 
-      module.second->llir()->print(llvm_ostream, nullptr, true, true);
+    if (dependent)
+      _discover(*dependent, path);
+
+    auto &node = _nodes[path];
+    node.path = path;
+    node.mlir_compiled.emplace(*_executor);
+
+    return &node;
+  }
+
+  Util::Coro::Task<> _run(Node &node) {
+    co_await _executor->schedule();
+
+    std::vector<Util::Coro::Task<>> tasks;
+    std::exception_ptr error;
+
+    try {
+      if (!_failed) {
+        _action(Stage::Parse, node.path);
+
+        for (auto &dependency : _dependencies(node.path))
+          if (auto joined = _join(dependency, &node.path))
+            tasks.push_back(_run(*joined));
+      }
+    } catch (...) {
+      // The dependents would skip their stages.
+      _failed = true;
+      error = std::current_exception();
     }
 
-    Util::logger.trace("Program") << "Successfully emitted LLIR\n";
+    // The joined dependencies are run even if failed, so that they are
+    // skipped, setting their events.
+    tasks.push_back(_compile(node));
+    co_await Util::Coro::when_all(std::move(tasks));
+
+    if (error)
+      std::rethrow_exception(error);
   }
+
+  Util::Coro::Task<> _compile(Node &node) {
+    try {
+      if (!_failed) {
+        for (auto &dependency : _dependencies(node.path)) {
+          Node *found;
+
+          {
+            std::lock_guard lock(_mutex);
+            found = &_nodes.at(dependency);
+          }
+
+          co_await *found->mlir_compiled;
+        }
+      }
+
+      if (!_failed)
+        _action(Stage::MLIR, node.path);
+    } catch (...) {
+      _failed = true;
+      node.mlir_compiled->set();
+      throw;
+    }
+
+    node.mlir_compiled->set();
+
+    for (auto stage : {Stage::Lower, Stage::Optimize, Stage::Codegen}) {
+      if (stage > _last || _failed)
+        break;
+
+      _action(stage, node.path);
+    }
   }
+};
+
+/// Return the placement of the import of the *dependency* by the *module*,
+/// unless its AST is released.
+std::optional<Placement> import_placement(
+    Onyx::File &module, const std::filesystem::path &dependency) {
+  if (auto ast = module.ast())
+    for (auto &node : ast->children())
+      if (auto import =
+              std::get_if<std::shared_ptr<Onyx::AST::ImportDirective>>(&node))
+        if (module.resolve_import((*import)->path.string) == dependency)
+          return (*import)->path.placement;
+
+  return std::nullopt;
+}
+
+} // namespace
+
+void Program::_prune_modules(
+    const std::vector<std::filesystem::path> &reachable) {
+  std::set<std::filesystem::path> kept(reachable.begin(), reachable.end());
+
+  for (auto it = _modules.begin(); it != _modules.end();) {
+    if (kept.count(it->first)) {
+      it++;
+      continue;
+    }
 
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "() exit\n";
+    FNXC_DEBUG("Program") << "Pruned module " << it->first << "\n";
+    _source_write_times.erase(it->first);
+    it = _modules.erase(it);
+  }
 }
 
-void Program::emit_exe(
-    std::filesystem::path exe_path,
-    std::vector<std::filesystem::path> lib_paths,
-    std::vector<std::string> linked_libs) {
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "()\n";
-  _compile_obj();
-  _link(exe_path, lib_paths, linked_libs);
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "() exit\n";
+bool Program::_run_pipeline(_Stage last) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+  Util::TimeTrace::Scope scope(
+      "Pipeline", [this]() { return _compilation_ctx.entry_path.string(); });
+
+  if (last >= _Stage::Lower && !_llvm_ctx)
+    _llvm_ctx = workspace->llvm_target(_compilation_ctx.target);
+
+  auto module_at = [&](const std::filesystem::path &path) -> Onyx::File & {
+    std::lock_guard lock(_modules_mutex);
+    return *_modules.at(path);
+  };
+
+  std::atomic<bool> compiled = false;
+  auto low_memory = _compilation_ctx.low_memory;
+  auto index = low_memory ? workspace->index() : nullptr;
+
+  // A stage is run with the module lock held, as the module may be shared
+  // with a concurrently built program which could have already run it.
+  auto action = [&](_Stage stage, const auto &path) {
+    auto &module = module_at(path);
+    std::lock_guard lock(module.mutex);
+    Util::MemoryAccount::Scope memory_scope(module.memory);
+
+    switch (stage) {
+    case _Stage::Parse:
+      if (!module.parsed())
+        module.parse();
+
+      break;
+    case _Stage::MLIR:
+      if (!module.compiled()) {
+        if (module.panics().empty()) {
+          module.compile();
+        } else {
+          // A module parsed with panics is compiled on the best-effort
+          // basis, so that e.g. an editor resolves what has been parsed.
+          try {
+            module.compile();
+          } catch (Panic &) {
+          }
+        }
+
+        compiled = true;
+
+        if (low_memory && module.panics().empty()) {
+          // Index before the MLIR is released. As in `_update_index()`,
+          // a failure shall not fail the build.
+          if (index) {
+            try {
+              if (_index_module(*index, path, module))
+                _index_pending = true;
+            } catch (const std::string &err) {
+              Util::logger.warn("Program")
+                  << "Failed to index " << path << ": " << err << "\n";
+            } catch (const std::exception &err) {
+              Util::logger.warn("Program")
+                  << "Failed to index " << path << ": " << err.what()
+                  << "\n";
+            }
+          }
+
+          module.release_ast();
+        }
+      }
+
+      // Yet it fails the pipeline, reporting all of them at once.
+      if (!module.panics().empty())
+        throw Panics(module.panics());
+
+      break;
+    case _Stage::Lower:
+      if (!module.lowered())
+        module.lower(
+            path.string(),
+            _llvm_ctx->target_triple,
+            _llvm_ctx->target_machine->createDataLayout());
+
+      // Modules do not refer to each other's MLIR yet, see `dependencies()`.
+      if (low_memory && module.mlir())
+        module.release_mlir();
+
+      break;
+    case _Stage::Optimize:
+      if (!module.optimized()) {
+        // The context is shared with the JIT, if running.
+        auto context_lock = module.llvm_context().getLock();
+
+        // A target machine is not thread-safe.
+        auto target_machine = _llvm_ctx->target_machines.lease();
+        module.optimize(_compilation_ctx.opt_level, target_machine.get());
+      }
+
+      break;
+    case _Stage::Codegen:
+      if (!module.assembled()) {
+        auto context_lock = module.llvm_context().getLock();
+        auto target_machine = _llvm_ctx->target_machines.lease();
+        module.assemble(target_machine.get());
+
+        FNXC_DEBUG("Program")
+            << "Compiled object for " << path << " ("
+            << module.obj().size() << " bytes)\n";
+
+        _write_obj_cache(path, module.obj());
+
+        if (low_memory)
+          module.release_llir();
+      }
+
+      break;
+    }
+  };
+
+  auto dependencies = [&](const auto &path) {
+    auto &module = module_at(path);
+    std::lock_guard lock(module.mutex);
+    return module.dependencies();
+  };
+
+  // An imported module is either known already, e.g. set from memory, or
+  // read from the disk.
+  auto discover = [&](const auto &dependent, const auto &dependency) {
+    std::lock_guard lock(_modules_mutex);
+
+    if (_modules.count(dependency))
+      return;
+
+    if (!std::filesystem::exists(dependency)) {
+      auto &module = *_modules.at(dependent);
+      std::lock_guard module_lock(module.mutex);
+
+      throw Panic(
+          "Imported file " + dependency.string() + " does not exist",
+          import_placement(module, dependency));
+    }
+
+    FNXC_DEBUG("Program") << "Discovered module " << dependency << "\n";
+    _add_module(dependency);
+  };
+
+  Pipeline<_Stage> pipeline(
+      {_compilation_ctx.entry_path}, last, action, dependencies, discover);
+
+  // Shared, so that concurrently built programs don't multiply the workers.
+  pipeline.run(Util::Coro::Executor::shared());
+
+  // The modules not imported anymore are neither compiled nor linked.
+  _prune_modules(pipeline.paths());
+
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+  return compiled;
 }
 
-Program::_LLVMContext::_LLVMContext() :
-    raw_context(std::make_unique<llvm::LLVMContext>()) {
-  llvm::InitializeAllTargetInfos();
-  llvm::InitializeAllTargets();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmParsers();
-  llvm::InitializeAllAsmPrinters();
+void Program::_write_obj_cache(
+    const std::filesystem::path &module_path, llvm::StringRef obj) {
+  if (!workspace->cache_dir)
+    return;
 
-  // this->target_triple = llvm::sys::getProcessTriple();
-  this->target_triple = "x86_64-pc-win32-msvc";
+  // The module outlives the write, as the program awaits it on destruction.
+  auto obj_path = this->obj_path(module_path);
+  std::lock_guard lock(_obj_cache_writes_mutex);
 
-  std::string err;
-  auto target = llvm::TargetRegistry::lookupTarget(target_triple, err);
+  // The writes of all the programs share a bounded pool rather than take a
+  // thread per module; being I/O-bound, a few writers suffice.
+  static Util::ThreadPool writers(4);
+
+  _obj_cache_writes.push_back(
+      writers.submit([obj_path, obj]() -> std::optional<std::string> {
+        std::error_code err;
+        auto file = llvm::raw_fd_ostream(
+            obj_path.string(), err, llvm::sys::fs::OF_None);
 
-  if (!target)
-    throw "Invalid target " + err;
+        if (err)
+          return "Failed to open file at " + obj_path.string() + ": " +
+                 err.message();
 
-  auto cpu = "generic";
-  auto features = "";
+        file << obj;
+        file.close();
 
-  llvm::TargetOptions opt;
-  auto RM = llvm::Optional<llvm::Reloc::Model>();
-  this->target_machine =
-      target->createTargetMachine(target_triple, cpu, features, opt, RM);
+        if (file.has_error()) {
+          file.clear_error();
+          return "Failed to write file at " + obj_path.string();
+        }
 
-  Util::logger.debug("Program")
-      << "Configured target triple: "
-      << this->target_machine->getTargetTriple().getTriple() << "\n";
+        return std::nullopt;
+      }));
 }
 
-void Program::_compile_obj() {
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "()\n";
-  compile_llir();
+void Program::_await_obj_cache_writes() {
+  std::lock_guard lock(_obj_cache_writes_mutex);
+
+  for (auto &write : _obj_cache_writes) {
+    if (auto err = write.get())
+      Util::logger.warn("Program") << *err << "\n";
+  }
+
+  _obj_cache_writes.clear();
+}
+
+Program::~Program() { _await_obj_cache_writes(); }
+
+namespace {
+
+/// Exposes in-memory object files to the linker, which only accepts paths.
+/// On Linux, an object is backed by an anonymous memory file accessible via
+/// `/proc/self/fd`, so that it never touches the disk. Otherwise, it is
+/// written to a temporary file. The objects are released on destruction.
+class ObjectHandoff {
+public:
+  ~ObjectHandoff() {
+#ifdef __linux__
+    for (auto fd : _fds)
+      close(fd);
+#endif
+
+    for (auto &path : _temp_paths) {
+      std::error_code err;
+      std::filesystem::remove(path, err);
+    }
+  }
+
+  /// Return a path to read the object *contents* named *name* from.
+  std::string add(const std::string &name, llvm::StringRef contents) {
+#ifdef __linux__
+    int fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+
+    if (fd >= 0) {
+      _fds.push_back(fd);
+      llvm::raw_fd_ostream stream(fd, false);
+      stream << contents;
+      stream.flush();
+
+      if (!stream.has_error())
+        return "/proc/self/fd/" + std::to_string(fd);
+
+      stream.clear_error();
+    }
+
+    FNXC_DEBUG("Program")
+        << "Could not create a memory file for " << name
+        << ", falling back to a temporary file\n";
+#endif
+
+    llvm::SmallString<128> path;
+    int temp_fd;
+
+    if (auto err =
+            llvm::sys::fs::createTemporaryFile(name, "o", temp_fd, path))
+      throw "Failed to create a temporary object file: " + err.message();
+
+    _temp_paths.push_back(path.str().str());
+    llvm::raw_fd_ostream stream(temp_fd, true);
+    stream << contents;
+    stream.close();
+
+    if (stream.has_error()) {
+      stream.clear_error();
+      throw "Failed to write temporary object file at " + _temp_paths.back();
+    }
+
+    return _temp_paths.back();
+  }
+
+private:
+#ifdef __linux__
+  std::vector<int> _fds;
+#endif
+  std::vector<std::string> _temp_paths;
+};
+
+} // namespace
+
+void Program::_link(
+    std::filesystem::path exe_path,
+    std::vector<std::filesystem::path> lib_paths,
+    std::vector<std::string> linked_libs) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+  Util::TimeTrace::Scope scope("Link", [&]() { return exe_path.string(); });
+
+  ObjectHandoff handoff;
+  std::vector<std::string> obj_paths;
 
-  llvm::legacy::PassManager pass;
-  auto file_type = llvm::CGFT_ObjectFile;
+#ifndef __linux__
+  // Without memory files, prefer the already written cached objects.
+  if (workspace->cache_dir)
+    _await_obj_cache_writes();
+#endif
 
   for (auto &module : _modules) {
-    auto obj_path = _obj_path(module.first);
+#ifndef __linux__
+    if (workspace->cache_dir) {
+      // A shared module's object may be still being written by another
+      // program, which is only awaited by that program.
+      auto obj_path = this->obj_path(module.first);
+      std::error_code err;
+
+      if (std::filesystem::file_size(obj_path, err) ==
+              module.second->obj().size() &&
+          !err) {
+        obj_paths.push_back(obj_path.string());
+        continue;
+      }
+    }
+#endif
 
-    std::error_code err;
-    auto file =
-        llvm::raw_fd_ostream(obj_path.string(), err, llvm::sys::fs::OF_None);
+    auto name = module.first.stem().string();
+    obj_paths.push_back(handoff.add(name, module.second->obj()));
+  }
 
-    if (err)
-      throw "Failed to open file at " + obj_path.string() + ": " +
-          err.message();
+  switch (_compilation_ctx.target.object_file_format) {
+  case Target::ObjectFileFormat::COFF:
+    _link_coff(exe_path, obj_paths, lib_paths, linked_libs);
+    break;
+  case Target::ObjectFileFormat::ELF:
+    _link_elf(exe_path, obj_paths, lib_paths, linked_libs);
+    break;
+  }
 
-    if (_llvm_ctx->target_machine->addPassesToEmitFile(
-            pass, file, nullptr, file_type))
-      throw "The target machine can't emit a file of this type";
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "() exit\n";
+}
 
-    Util::logger.trace("Program")
-        << "Compiling object file at " << obj_path << "\n";
+/// Invoke an lld *driver* with *args*, where the first argument is the linker
+/// flavor name. Throws `LinkerFailure` with the captured error output.
+///
+/// The lld library is not reentrant, as it keeps its configuration, error
+/// handler and symbol table in globals. Thus the programs built in parallel
+/// (see `Workspace::build()`) are linked one at a time.
+static void invoke_lld(
+    const std::vector<std::string> &args,
+    bool (*driver)(
+        llvm::ArrayRef<const char *>,
+        bool,
+        llvm::raw_ostream &,
+        llvm::raw_ostream &)) {
+  FNXC_DEBUG("Program") << fmt::format(
+      "Linker args: {}\n", fmt::join(args, " "));
 
-    pass.run(*module.second->llir());
-    file.flush();
+  std::vector<const char *> char_args;
 
-    Util::logger.debug("Program")
-        << "Compiled object file at " << obj_path << "\n";
+  for (auto &arg : args) {
+    char_args.push_back(arg.c_str());
   }
 
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "() exit\n";
+  std::string err;
+  llvm::raw_os_ostream sout(Util::logger.debug("Linker") << "Output:\n");
+  llvm::raw_string_ostream serr(err);
+
+  static std::mutex mutex;
+  std::unique_lock lock(mutex);
+
+  bool success = driver(char_args, false, sout, serr);
+  lock.unlock();
+
+  serr.flush();
+
+  if (!success) {
+    throw LinkerFailure(err);
+  } else if (!err.empty()) {
+    Util::logger.warn("Linker") << err;
+  }
 }
 
-void Program::_link(
+void Program::_link_coff(
     std::filesystem::path exe_path,
+    const std::vector<std::string> &obj_paths,
     std::vector<std::filesystem::path> lib_paths,
     std::vector<std::string> linked_libs) {
-  Util::logger.trace("Program") << __builtin_FUNCTION() << "()\n";
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
 
   lib_paths.push_back("C:\\Program Files (x86)\\Windows "
                       "Kits\\10\\Lib\\10.0.18362.0\\ucrt\\x64");
@@ -227,18 +1094,20 @@ void Program::_link(
   linked_libs.push_back("ucrt");
   linked_libs.push_back("cmt");
 
-  std::vector<std::string> args;
+  std::vector<std::string> args = {"lld-link"};
 
-  if (auto lto_cache_dir = workspace->lto_cache_dir())
-    args.push_back("/lldltocache:\"" + lto_cache_dir->string() + "\"");
+  if (auto lto_cache_dir = workspace->lto_cache_dir()) {
+    auto dir = lto_cache_dir.value() / _compilation_ctx.target.cache_key();
+    std::filesystem::create_directories(dir);
+    args.push_back("/lldltocache:\"" + dir.string() + "\"");
+  }
 
   // args.push_back("/entry:__nx_implicit_main");
   args.push_back("/subsystem:console");
   args.push_back("/out:" + exe_path.string());
 
-  for (auto &module : _modules) {
-    auto obj_path = _obj_path(module.first);
-    args.push_back(obj_path.string());
+  for (auto &obj_path : obj_paths) {
+    args.push_back(obj_path);
   }
 
   for (auto path : lib_paths) {
@@ -252,32 +1121,213 @@ void Program::_link(
   // args.push_back("C:\\Program Files (x86)\\Windows "
   //                "Kits\\10\\Lib\\10.0.18362.0\\ucrt\\x64\\libucrt.lib");
 
-  fmt::print(
-      Util::logger.debug("Program"), "Linker args: {}\n", fmt::join(args, " "));
+  invoke_lld(args, lld::coff::link);
+}
 
-  std::vector<const char *> char_args;
+namespace {
 
-  for (auto &arg : args) {
-    char_args.push_back(arg.c_str());
+/// The C runtime files to link an ELF executable with.
+struct ELFRuntime {
+  /// Whether is it the musl libc (linked statically) instead of glibc.
+  bool musl;
+
+  /// Directories containing the C runtime and the libc.
+  std::vector<std::filesystem::path> lib_dirs;
+
+  std::filesystem::path crt1, crti, crtn;
+
+  /// GCC's `crtbegin.o` and `crtend.o`, if found.
+  std::optional<std::filesystem::path> crtbegin, crtend;
+
+  /// The program interpreter, only set for glibc.
+  std::optional<std::filesystem::path> dynamic_linker;
+};
+
+} // namespace
+
+/// Find the first existing file named *name* within *dirs*.
+static std::optional<std::filesystem::path>
+find_file(const std::vector<std::filesystem::path> &dirs, const char *name) {
+  for (auto &dir : dirs) {
+    auto path = dir / name;
+
+    if (std::filesystem::exists(path))
+      return path;
   }
 
-  std::stringstream ssout;
-  std::stringstream sserr;
+  return std::nullopt;
+}
 
-  llvm::raw_os_ostream sout(Util::logger.debug("Linker") << "Output:\n");
-  llvm::raw_os_ostream serr(std::cerr); // TODO: Capture the output
+/// Find the latest GCC installation directory containing `crtbegin.o`,
+/// e.g. `/usr/lib/gcc/x86_64-linux-gnu/12/`.
+static std::optional<std::filesystem::path> find_gcc_crt_dir() {
+  std::optional<std::filesystem::path> latest;
+  unsigned long latest_version = 0;
 
-  bool success = !!lld::coff::link(char_args, false, sout, serr);
+  for (auto gcc_dir :
+       {"/usr/lib/gcc/x86_64-linux-gnu", "/usr/lib/gcc/x86_64-pc-linux-gnu"}) {
+    std::error_code err;
+    auto it = std::filesystem::directory_iterator(gcc_dir, err);
 
-  if (!success) {
-    throw LinkerFailure(sserr.str());
+    if (err)
+      continue;
+
+    for (auto &entry : it) {
+      auto version = strtoul(entry.path().filename().c_str(), nullptr, 10);
+
+      if (version >= latest_version &&
+          std::filesystem::exists(entry.path() / "crtbegin.o")) {
+        latest_version = version;
+        latest = entry.path();
+      }
+    }
+  }
+
+  return latest;
+}
+
+/// Discover the C runtime for an x86-64 Linux *triple*.
+static ELFRuntime discover_elf_runtime(const llvm::Triple &triple) {
+  if (triple.getArch() != llvm::Triple::x86_64 || !triple.isOSLinux())
+    throw "Unsupported ELF target " + triple.str();
+
+  ELFRuntime runtime;
+  runtime.musl = triple.isMusl();
+
+  std::vector<std::filesystem::path> candidates;
+
+  if (runtime.musl) {
+    candidates = {
+        "/usr/lib/musl/lib",
+        "/usr/local/musl/lib",
+        "/usr/lib/x86_64-linux-musl",
+        "/usr/lib"};
+  } else {
+    candidates = {
+        "/usr/lib/x86_64-linux-gnu",
+        "/lib/x86_64-linux-gnu",
+        "/usr/lib64",
+        "/lib64",
+        "/usr/lib",
+        "/lib"};
+
+    runtime.dynamic_linker = find_file(
+        {"/lib64", "/lib/x86_64-linux-gnu", "/usr/lib64"},
+        "ld-linux-x86-64.so.2");
+
+    if (!runtime.dynamic_linker)
+      throw LinkerFailure("Could not find the glibc dynamic linker");
+  }
+
+  for (auto &dir : candidates) {
+    if (std::filesystem::is_directory(dir))
+      runtime.lib_dirs.push_back(dir);
   }
+
+  for (auto [path, name] : {
+           std::make_pair(&runtime.crt1, "crt1.o"),
+           std::make_pair(&runtime.crti, "crti.o"),
+           std::make_pair(&runtime.crtn, "crtn.o"),
+       }) {
+    if (auto found = find_file(runtime.lib_dirs, name))
+      *path = found.value();
+    else
+      throw LinkerFailure(
+          fmt::format("Could not find `{}` for {}", name, triple.str()));
+  }
+
+  // The GCC runtime objects are not needed by the Onyx runtime itself, but
+  // they are required for C libraries relying on `__dso_handle` et al.
+  if (auto gcc_dir = find_gcc_crt_dir()) {
+    runtime.crtbegin = gcc_dir.value() / "crtbegin.o";
+    runtime.crtend = gcc_dir.value() / "crtend.o";
+  }
+
+  return runtime;
+}
+
+void Program::_link_elf(
+    std::filesystem::path exe_path,
+    const std::vector<std::string> &obj_paths,
+    std::vector<std::filesystem::path> lib_paths,
+    std::vector<std::string> linked_libs) {
+  FNXC_TRACE("Program") << __builtin_FUNCTION() << "()\n";
+
+  auto runtime =
+      discover_elf_runtime(llvm::Triple(_compilation_ctx.target.triple));
+
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::string> args = {
+      "ld.lld",
+      "-m",
+      "elf_x86_64",
+      fmt::format("--threads={}", threads),
+      "--gc-sections",
+      "--icf=all",
+      "--build-id",
+      "--eh-frame-hdr",
+      "--hash-style=gnu",
+      "-z",
+      "relro",
+  };
+
+  if (runtime.musl) {
+    args.push_back("-static");
+  } else {
+    args.push_back("-dynamic-linker");
+    args.push_back(runtime.dynamic_linker->string());
+  }
+
+  if (auto lto_cache_dir = workspace->lto_cache_dir()) {
+    auto dir = lto_cache_dir.value() / _compilation_ctx.target.cache_key();
+    std::filesystem::create_directories(dir);
+    args.push_back("--thinlto-cache-dir=" + dir.string());
+  }
+
+  args.push_back("-o");
+  args.push_back(exe_path.string());
+
+  args.push_back(runtime.crt1.string());
+  args.push_back(runtime.crti.string());
+
+  if (runtime.crtbegin)
+    args.push_back(runtime.crtbegin->string());
+
+  for (auto &path : lib_paths) {
+    args.push_back("-L" + path.string());
+  }
+
+  for (auto &dir : runtime.lib_dirs) {
+    args.push_back("-L" + dir.string());
+  }
+
+  for (auto &obj_path : obj_paths) {
+    args.push_back(obj_path);
+  }
+
+  for (auto &lib : linked_libs) {
+    args.push_back("-l" + lib);
+  }
+
+  args.push_back("-lc");
+
+  if (runtime.crtend)
+    args.push_back(runtime.crtend->string());
+
+  args.push_back(runtime.crtn.string());
+
+  invoke_lld(args, lld::elf::link);
 }
 
 std::filesystem::path
-Program::_obj_path(std::filesystem::path module_path) const {
-  auto dir =
-      workspace->cache_dir.value() / "./obj/" / module_path.parent_path();
+Program::obj_path(std::filesystem::path module_path) const {
+  // An absolute path would replace the whole prefix if appended as is.
+  auto relative =
+      std::filesystem::absolute(module_path).lexically_normal().relative_path();
+
+  auto dir = workspace->cache_dir.value() / "./obj/" / _module_cache_key() /
+             relative.parent_path();
   std::filesystem::create_directories(dir);
   auto path = dir / module_path.stem();
   path.replace_extension(".o");
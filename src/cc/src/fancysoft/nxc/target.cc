@@ -0,0 +1,70 @@
+#include <fmt/format.h>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/xxhash.h>
+
+#include "fancysoft/nxc/target.hh"
+#include "fancysoft/util/logger.hh"
+
+namespace Fancysoft::NXC {
+
+std::string Target::default_triple() {
+#ifdef _WIN32
+  return "x86_64-pc-win32-msvc";
+#else
+  return llvm::sys::getProcessTriple();
+#endif
+}
+
+Target::ObjectFileFormat
+Target::object_file_format_of(const std::string &triple) {
+  auto llvm_triple = llvm::Triple(triple);
+
+  if (llvm_triple.isOSBinFormatCOFF())
+    return ObjectFileFormat::COFF;
+  else if (llvm_triple.isOSBinFormatELF())
+    return ObjectFileFormat::ELF;
+  else
+    throw "Unsupported object file format for " + triple;
+}
+
+Target Target::resolve() const {
+  if (cpu != "native")
+    return *this;
+
+  Target resolved = *this;
+  resolved.cpu = llvm::sys::getHostCPUName().str();
+
+  std::string host_features;
+  llvm::StringMap<bool> features_map;
+
+  if (llvm::sys::getHostCPUFeatures(features_map)) {
+    for (auto &feature : features_map) {
+      if (!host_features.empty())
+        host_features += ',';
+
+      host_features += (feature.second ? '+' : '-');
+      host_features += feature.first().str();
+    }
+  } else {
+    Util::logger.warn("Target")
+        << "Could not detect host CPU features, only the CPU name is used\n";
+  }
+
+  if (features.empty())
+    resolved.features = host_features;
+  else if (!host_features.empty())
+    resolved.features = host_features + ',' + features;
+
+  FNXC_DEBUG("Target") << "Resolved native CPU to `" << resolved.cpu << "`\n";
+
+  return resolved;
+}
+
+std::string Target::cache_key() const {
+  return fmt::format("{}-{}-{:016x}", triple, cpu, llvm::xxHash64(features));
+}
+
+} // namespace Fancysoft::NXC
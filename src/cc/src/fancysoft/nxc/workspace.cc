@@ -0,0 +1,93 @@
+#include "fancysoft/nxc/workspace.hh"
+#include "fancysoft/nxc/llvm_target.hh"
+#include "fancysoft/nxc/onyx/file.hh"
+#include "fancysoft/nxc/program.hh"
+#include "fancysoft/util/logger.hh"
+#include "fancysoft/util/thread_pool.hh"
+
+namespace Fancysoft::NXC {
+
+std::shared_ptr<Onyx::File> Workspace::module(
+    const std::filesystem::path &path,
+    const std::string &key,
+    std::function<std::shared_ptr<Onyx::File>()> create) {
+  std::error_code err;
+  auto write_time = std::filesystem::last_write_time(path, err);
+
+  // A missing file is reported upon parsing.
+  if (err)
+    write_time = decltype(write_time)::min();
+
+  std::lock_guard lock(_mutex);
+  auto &shared = _modules[{std::filesystem::absolute(path), key}];
+
+  if (auto module = shared.module.lock()) {
+    if (shared.write_time == write_time) {
+      FNXC_DEBUG("Workspace")
+          << "Sharing module " << path << " for " << key << "\n";
+
+      return module;
+    }
+  }
+
+  auto module = create();
+  shared = _SharedModule{module, write_time};
+
+  return module;
+}
+
+std::shared_ptr<LLVMTarget> Workspace::llvm_target(const Target &target) {
+  std::lock_guard lock(_mutex);
+  auto &llvm_target = _llvm_targets[target.cache_key()];
+
+  if (!llvm_target)
+    llvm_target = std::make_shared<LLVMTarget>(target);
+
+  return llvm_target;
+}
+
+std::vector<std::shared_ptr<LLVMTarget>> Workspace::llvm_targets() {
+  std::lock_guard lock(_mutex);
+  std::vector<std::shared_ptr<LLVMTarget>> result;
+
+  for (auto &[key, llvm_target] : _llvm_targets)
+    result.push_back(llvm_target);
+
+  return result;
+}
+
+std::vector<std::exception_ptr>
+Workspace::build(const std::vector<Executable> &executables, unsigned jobs) {
+  FNXC_TRACE("Workspace") << __builtin_FUNCTION() << "()\n";
+
+  Util::ThreadPool pool(jobs);
+
+  FNXC_DEBUG("Workspace")
+      << "Building " << executables.size() << " executables with "
+      << pool.size() << " jobs\n";
+
+  // A program waits for a shared module stage being run by another one.
+  std::vector<std::future<void>> builds;
+
+  for (auto &executable : executables)
+    builds.push_back(pool.submit([&executable]() {
+      executable.program->emit_exe(
+          executable.exe_path, executable.lib_paths, executable.linked_libs);
+    }));
+
+  std::vector<std::exception_ptr> errors;
+
+  for (auto &build : builds) {
+    try {
+      build.get();
+      errors.push_back(nullptr);
+    } catch (...) {
+      errors.push_back(std::current_exception());
+    }
+  }
+
+  FNXC_TRACE("Workspace") << __builtin_FUNCTION() << "() exit\n";
+  return errors;
+}
+
+} // namespace Fancysoft::NXC
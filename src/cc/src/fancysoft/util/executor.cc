@@ -0,0 +1,147 @@
+#include <algorithm>
+
+#include "fancysoft/util/executor.hh"
+
+namespace Fancysoft::Util::Coro {
+
+namespace {
+
+/// The executor and the index of the worker running on this thread, if any.
+thread_local Executor *current_executor = nullptr;
+thread_local size_t current_index = 0;
+
+} // namespace
+
+Executor::Executor(unsigned size) {
+  if (!size)
+    size = std::max(1u, std::thread::hardware_concurrency());
+
+  _workers.reserve(size);
+
+  for (unsigned i = 0; i < size; i++)
+    _workers.push_back(std::make_unique<_Worker>());
+
+  // Started once all the deques exist, as they are stolen from.
+  for (unsigned i = 0; i < size; i++)
+    _workers[i]->thread = std::thread(&Executor::_work, this, i);
+}
+
+Executor &Executor::shared() {
+  static Executor executor;
+  return executor;
+}
+
+Executor::~Executor() {
+  {
+    std::lock_guard lock(_mutex);
+    _stopping = true;
+  }
+
+  _work_available.notify_all();
+
+  for (auto &worker : _workers)
+    worker->thread.join();
+}
+
+void Executor::post(__FNXC__CORO_NS::coroutine_handle<> handle) {
+  _outstanding.fetch_add(1);
+
+  if (current_executor == this) {
+    auto &worker = *_workers[current_index];
+    std::lock_guard lock(worker.mutex);
+    worker.deque.push_back(handle);
+  } else {
+    std::lock_guard lock(_injected_mutex);
+    _injected.push_back(handle);
+  }
+
+  // Either a worker going to sleep sees the coroutine, or it is notified.
+  _queued.fetch_add(1);
+
+  if (_sleeping.load()) {
+    std::lock_guard lock(_mutex);
+    _work_available.notify_one();
+  }
+}
+
+__FNXC__CORO_NS::coroutine_handle<> Executor::_take(size_t index) {
+  if (!_queued.load(std::memory_order_relaxed))
+    return nullptr;
+
+  auto pop = [this](std::mutex &mutex, auto &deque, bool back)
+      -> __FNXC__CORO_NS::coroutine_handle<> {
+    std::lock_guard lock(mutex);
+
+    if (deque.empty())
+      return nullptr;
+
+    __FNXC__CORO_NS::coroutine_handle<> handle;
+
+    if (back) {
+      handle = deque.back();
+      deque.pop_back();
+    } else {
+      handle = deque.front();
+      deque.pop_front();
+    }
+
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    return handle;
+  };
+
+  auto &own = *_workers[index];
+
+  if (auto handle = pop(own.mutex, own.deque, true))
+    return handle;
+
+  if (auto handle = pop(_injected_mutex, _injected, false))
+    return handle;
+
+  for (size_t i = 1; i < _workers.size(); i++) {
+    auto &victim = *_workers[(index + i) % _workers.size()];
+
+    if (auto handle = pop(victim.mutex, victim.deque, false))
+      return handle;
+  }
+
+  return nullptr;
+}
+
+void Executor::_work(size_t index) {
+  current_executor = this;
+  current_index = index;
+
+  while (true) {
+    auto handle = _take(index);
+
+    if (!handle) {
+      std::unique_lock lock(_mutex);
+
+      if (_stopping)
+        return;
+
+      _sleeping.fetch_add(1);
+      _work_available.wait(
+          lock, [this]() { return _stopping || _queued.load(); });
+      _sleeping.fetch_sub(1);
+
+      continue;
+    }
+
+    handle.resume();
+
+    if (_outstanding.fetch_sub(1) == 1) {
+      std::lock_guard lock(_mutex);
+      _idle.notify_all();
+    }
+  }
+}
+
+void Executor::_finish(bool &done) {
+  // Notified under the lock, as the executor may be destroyed right after.
+  std::lock_guard lock(_mutex);
+  done = true;
+  _idle.notify_all();
+}
+
+} // namespace Fancysoft::Util::Coro
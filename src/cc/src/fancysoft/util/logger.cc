@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <assert.h>
 #include <chrono>
+#include <cstring>
 #include <ctime>
-#include <iomanip>
+#include <map>
 #include <ostream>
+#include <streambuf>
 #include <thread>
 
 #include "fancysoft/util/logger.hh"
@@ -29,32 +32,314 @@ const char *Logger::verbosity_to_string(Verbosity verbosity) {
   }
 }
 
+namespace {
+std::atomic<uint64_t> next_id = 0;
+} // namespace
+
+struct Logger::_Ring {
+  const std::unique_ptr<char[]> buffer;
+  const size_t size;
+
+  /// The total amount of bytes written, only modified by the producer.
+  std::atomic<size_t> head = 0;
+
+  /// The total amount of bytes read, only modified by the consumer.
+  std::atomic<size_t> tail = 0;
+
+  _Ring(size_t size) : buffer(std::make_unique<char[]>(size)), size(size) {}
+
+  size_t used() const {
+    return head.load(std::memory_order_relaxed) -
+        tail.load(std::memory_order_relaxed);
+  }
+
+  /// Check if a *message* would ever fit.
+  bool fits(std::string_view message) const {
+    return sizeof(uint32_t) + message.size() <= size;
+  }
+
+  /// Try putting a *message*, returning false if there is not enough space.
+  bool try_push(std::string_view message) {
+    uint32_t length = message.size();
+    auto h = head.load(std::memory_order_relaxed);
+    auto t = tail.load(std::memory_order_acquire);
+
+    if (size - (h - t) < sizeof(length) + length)
+      return false;
+
+    _copy_in(h, &length, sizeof(length));
+    _copy_in(h + sizeof(length), message.data(), length);
+    head.store(h + sizeof(length) + length, std::memory_order_release);
+
+    return true;
+  }
+
+  /// Pass each pending message to *callback*, returning false if none.
+  template <typename F> bool pop_all(F callback) {
+    auto t = tail.load(std::memory_order_relaxed);
+    auto h = head.load(std::memory_order_acquire);
+
+    if (t == h)
+      return false;
+
+    std::string message;
+
+    while (t != h) {
+      uint32_t length;
+      _copy_out(t, &length, sizeof(length));
+      message.resize(length);
+      _copy_out(t + sizeof(length), message.data(), length);
+      callback(message);
+      t += sizeof(length) + length;
+    }
+
+    tail.store(t, std::memory_order_release);
+    return true;
+  }
+
+private:
+  void _copy_in(size_t position, const void *data, size_t length) {
+    position %= size;
+    auto first = std::min(length, size - position);
+    memcpy(buffer.get() + position, data, first);
+    memcpy(buffer.get(), (const char *)data + first, length - first);
+  }
+
+  void _copy_out(size_t position, void *data, size_t length) const {
+    position %= size;
+    auto first = std::min(length, size - position);
+    memcpy(data, buffer.get() + position, first);
+    memcpy((char *)data + first, buffer.get(), length - first);
+  }
+};
+
+class Logger::_ThreadStream : private std::streambuf, public std::ostream {
+public:
+  _ThreadStream(Logger &logger) : std::ostream(this), _logger(logger) {}
+
+  /// Set for an error message, see `Logger::_commit()`.
+  bool urgent = false;
+
+  /// Output the pending message, if any.
+  void commit() {
+    if (_message.empty())
+      return;
+
+    _logger._commit(_message, _ring, urgent);
+    _message.clear();
+  }
+
+private:
+  Logger &_logger;
+  std::string _message;
+
+  /// Created upon the first message in the async mode.
+  std::shared_ptr<_Ring> _ring;
+
+  // A message is complete once it ends with a newline.
+  //
+
+  int overflow(int ch) override {
+    if (ch == EOF)
+      return 0;
+
+    _message.push_back(ch);
+
+    if (ch == '\n')
+      commit();
+
+    return ch;
+  }
+
+  std::streamsize xsputn(const char *data, std::streamsize length) override {
+    _message.append(data, length);
+
+    if (length && data[length - 1] == '\n')
+      commit();
+
+    return length;
+  }
+
+  int sync() override {
+    commit();
+    return 0;
+  }
+};
+
 Logger::Logger(Verbosity verbosity, std::ostream &output) :
-    verbosity(verbosity), _output(output) {}
+    verbosity(verbosity), _output(output), _id(next_id++) {}
+
+Logger::~Logger() { stop_async(); }
+
+void Logger::start_async(size_t buffer_size) {
+  std::lock_guard lock(_mutex);
+
+  if (_async.load(std::memory_order_relaxed))
+    return;
+
+  _ring_size = buffer_size;
+  _stopping = false;
+  _async.store(true, std::memory_order_release);
+  _writer = std::thread(&Logger::_write_loop, this);
+}
+
+void Logger::stop_async() {
+  {
+    std::lock_guard lock(_mutex);
+
+    if (!_async.load(std::memory_order_relaxed))
+      return;
+
+    _async.store(false, std::memory_order_release);
+  }
+
+  {
+    std::lock_guard lock(_writer_mutex);
+    _stopping = true;
+  }
+
+  _writer_wakeup.notify_one();
+  _writer.join();
+
+  // A message could have been put after the writer's final drain.
+  _drain();
+}
+
+std::ostream &Logger::_begin(
+    Verbosity level,
+    std::variant<const char *, std::vector<const char *>> context) {
+  // A logger may be used from a thread it outlives, thus never touched in
+  // the stream destructor; the id is not reused.
+  thread_local std::map<uint64_t, std::unique_ptr<_ThreadStream>> streams;
+  auto &stream = streams[_id];
+
+  if (!stream)
+    stream = std::make_unique<_ThreadStream>(*this);
+  else
+    stream->commit(); // An unterminated previous message
+
+  stream->urgent = level >= Verbosity::Error;
+  _output_header(*stream, level, context);
+  return *stream;
+}
+
+void Logger::_commit(
+    std::string_view message, std::shared_ptr<_Ring> &ring, bool urgent) {
+  if (_async.load(std::memory_order_acquire) && !urgent) {
+    if (!ring) {
+      std::lock_guard lock(_mutex);
+      ring = std::make_shared<_Ring>(_ring_size);
+      _rings.push_back(ring);
+    }
+
+    if (ring->fits(message)) {
+      bool pushed;
+
+      while (!(pushed = ring->try_push(message)) &&
+             _async.load(std::memory_order_acquire)) {
+        _writer_wakeup.notify_one();
+        std::this_thread::yield();
+      }
+
+      if (pushed) {
+        if (ring->used() > ring->size / 2)
+          _writer_wakeup.notify_one();
+
+        return;
+      }
+
+      // The writer has stopped, write synchronously instead.
+    }
+  }
+
+  // The pending messages of the thread go first, so that the order is kept.
+  // The rings are only read with the lock held, thus safe to read here.
+  if (ring)
+    _drain();
+
+  std::lock_guard lock(_mutex);
+  _output << message;
+}
+
+void Logger::flush() {
+  _drain();
+
+  std::lock_guard lock(_mutex);
+  _output.flush();
+}
+
+bool Logger::_drain() {
+  std::vector<std::shared_ptr<_Ring>> rings;
+
+  {
+    std::lock_guard lock(_mutex);
+
+    // Drop the rings of the finished threads once drained.
+    std::erase_if(_rings, [](auto &ring) {
+      return ring.use_count() == 1 && !ring->used();
+    });
+
+    rings = _rings;
+  }
+
+  bool any = false;
+
+  for (auto &ring : rings) {
+    std::lock_guard lock(_mutex);
+
+    if (ring->pop_all([this](auto &message) { _output << message; }))
+      any = true;
+  }
+
+  if (any) {
+    std::lock_guard lock(_mutex);
+    _output.flush();
+  }
+
+  return any;
+}
+
+void Logger::_write_loop() {
+  while (true) {
+    if (_drain())
+      continue;
+
+    std::unique_lock lock(_writer_mutex);
+
+    if (_stopping)
+      break;
+
+    // The producers only notify once a ring is half-full.
+    _writer_wakeup.wait_for(lock, std::chrono::milliseconds(10));
+  }
+
+  _drain();
+}
 
 void Logger::_output_header(
+    std::ostream &output,
     Verbosity level,
     std::variant<const char *, std::vector<const char *>> context) {
-  _output << '[';
+  output << '[';
 
   switch (level) {
   case Verbosity::Trace:
-    _output << "T";
+    output << "T";
     break;
   case Verbosity::Debug:
-    _output << "D";
+    output << "D";
     break;
   case Verbosity::Info:
-    _output << "I";
+    output << "I";
     break;
   case Verbosity::Warn:
-    _output << "W";
+    output << "W";
     break;
   case Verbosity::Error:
-    _output << "E";
+    output << "E";
     break;
   case Verbosity::Fatal:
-    _output << "F";
+    output << "F";
     break;
   case Verbosity::None:
     assert(false);
@@ -62,71 +347,88 @@ void Logger::_output_header(
   }
 
   if (enable_thread_id_output) {
-    _output << "][@" << std::hex << std::this_thread::get_id() << std::dec;
+    output << "][@" << std::hex << std::this_thread::get_id() << std::dec;
   }
 
   if (enable_time_output) {
-    _output << "][";
-    _output_time();
+    output << "][";
+    _output_time(output);
   }
 
-  _output << ']';
+  output << ']';
 
   std::visit(
-      [this](auto &ctx) {
+      [&output](auto &ctx) {
         using T = std::decay_t<decltype(ctx)>;
 
         if constexpr (std::is_same_v<T, const char *>) {
           if (ctx)
-            _output << '[' << ctx << ']';
+            output << '[' << ctx << ']';
         } else if constexpr (std::is_same_v<T, std::vector<const char *>>) {
-          _output << '[';
+          output << '[';
 
           bool first = true;
           for (auto &c : ctx) {
             if (first)
               first = false;
             else
-              _output << '/';
+              output << '/';
 
-            _output << c;
+            output << c;
           }
-          _output << ']';
+          output << ']';
         } else
           static_assert(
               Util::Variant::always_false_v<T>, "non-exhaustive visitor!");
       },
       context);
 
-  _output << " ";
+  output << " ";
 }
 
-void Logger::_output_time() {
+void Logger::_output_time(std::ostream &output) {
   using namespace std::chrono;
 
+  // Formatting the local time is expensive, thus only done once a second.
+  thread_local time_t cached_second = -1;
+  thread_local char cached[16];
+
   auto now = system_clock::now();
+  auto second = system_clock::to_time_t(now);
+
+  if (second != cached_second) {
+    std::tm tm;
+
+#ifdef _WIN32
+    localtime_s(&tm, &second);
+#else
+    localtime_r(&second, &tm);
+#endif
+
+    strftime(cached, sizeof(cached), "%H:%M:%S", &tm);
+    cached_second = second;
+  }
+
   auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
-  auto a = system_clock::to_time_t(now);
-  std::tm b = *std::localtime(&a);
 
-  _output << std::put_time(&b, "%H:%M:%S");
-  _output << '.' << std::setfill('0') << std::setw(3) << ms.count();
+  char millis[8];
+  snprintf(millis, sizeof(millis), ".%03d", (int)ms.count());
+
+  output << cached << millis;
 }
 
 #define IMPL_LOG(LEVEL, VERBOSITY)                                             \
   std::ostream &Logger::LEVEL(const char *context) {                           \
-    if (verbosity <= Logger::Verbosity::VERBOSITY) {                           \
-      _output_header(Logger::Verbosity::VERBOSITY, context);                   \
-      return _output;                                                          \
-    } else                                                                     \
+    if (verbosity <= Logger::Verbosity::VERBOSITY)                             \
+      return _begin(Logger::Verbosity::VERBOSITY, context);                    \
+    else                                                                       \
       return _null_stream;                                                     \
   }                                                                            \
                                                                                \
   std::ostream &Logger::LEVEL(const std::vector<const char *> context) {       \
-    if (verbosity <= Logger::Verbosity::VERBOSITY) {                           \
-      _output_header(Logger::Verbosity::VERBOSITY, context);                   \
-      return _output;                                                          \
-    } else                                                                     \
+    if (verbosity <= Logger::Verbosity::VERBOSITY)                             \
+      return _begin(Logger::Verbosity::VERBOSITY, context);                    \
+    else                                                                       \
       return _null_stream;                                                     \
   }
 
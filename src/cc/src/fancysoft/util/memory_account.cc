@@ -0,0 +1,307 @@
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#include <sys/resource.h>
+#else
+#include <malloc.h>
+#include <sys/resource.h>
+#endif
+
+#include "fancysoft/util/memory_account.hh"
+
+namespace Fancysoft::Util {
+
+namespace {
+
+std::atomic<bool> enabled_ = false;
+
+/// Shall be trivial, so that accessing it never allocates.
+struct ThreadState {
+  uint64_t allocations;
+  uint64_t allocated_bytes;
+  int64_t live_bytes;
+  MemoryAccount *account;
+};
+
+thread_local ThreadState thread_state = {};
+
+size_t usable_size(void *pointer, [[maybe_unused]] size_t alignment) {
+#if defined(_WIN32)
+  if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    return _aligned_msize(pointer, alignment, 0);
+  else
+    return _msize(pointer);
+#elif defined(__APPLE__)
+  return malloc_size(pointer);
+#else
+  return malloc_usable_size(pointer);
+#endif
+}
+
+void account_allocation(void *pointer, size_t alignment) {
+  if (!enabled_.load(std::memory_order_relaxed))
+    return;
+
+  auto size = usable_size(pointer, alignment);
+  auto &state = thread_state;
+  state.allocations++;
+  state.allocated_bytes += size;
+  state.live_bytes += size;
+
+  if (state.account)
+    state.account->_allocated(size);
+}
+
+void account_deallocation(void *pointer, size_t alignment) {
+  if (!enabled_.load(std::memory_order_relaxed))
+    return;
+
+  auto size = usable_size(pointer, alignment);
+  auto &state = thread_state;
+  state.live_bytes -= size;
+
+  if (state.account)
+    state.account->_freed(size);
+}
+
+void *try_allocate(size_t size, size_t alignment) {
+  if (!size)
+    size = 1;
+
+  void *pointer;
+
+  while (true) {
+#if defined(_WIN32)
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+      pointer = _aligned_malloc(size, alignment);
+    else
+      pointer = std::malloc(size);
+#else
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+      if (posix_memalign(&pointer, alignment, size))
+        pointer = nullptr;
+    } else
+      pointer = std::malloc(size);
+#endif
+
+    if (pointer)
+      break;
+
+    if (auto handler = std::get_new_handler())
+      handler();
+    else
+      return nullptr;
+  }
+
+  account_allocation(pointer, alignment);
+  return pointer;
+}
+
+void *allocate(size_t size, size_t alignment) {
+  if (auto pointer = try_allocate(size, alignment))
+    return pointer;
+  else
+    throw std::bad_alloc();
+}
+
+void deallocate(void *pointer, size_t alignment) {
+  if (!pointer)
+    return;
+
+  account_deallocation(pointer, alignment);
+
+#if defined(_WIN32)
+  if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    return _aligned_free(pointer);
+#endif
+
+  std::free(pointer);
+}
+
+} // namespace
+
+MemoryAccount::Stats
+MemoryAccount::Stats::operator-(const Stats &other) const {
+  return Stats{
+      allocations - other.allocations,
+      allocated_bytes - other.allocated_bytes,
+      live_bytes - other.live_bytes,
+      peak_bytes};
+}
+
+MemoryAccount::Scope::Scope(MemoryAccount &account) :
+    _previous(thread_state.account) {
+  thread_state.account = &account;
+}
+
+MemoryAccount::Scope::~Scope() { thread_state.account = _previous; }
+
+void MemoryAccount::enable() {
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void MemoryAccount::disable() {
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+bool MemoryAccount::enabled() {
+  return enabled_.load(std::memory_order_relaxed);
+}
+
+MemoryAccount::Stats MemoryAccount::thread_stats() {
+  auto &state = thread_state;
+  return Stats{state.allocations, state.allocated_bytes, state.live_bytes, 0};
+}
+
+uint64_t MemoryAccount::peak_rss() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return counters.PeakWorkingSetSize;
+  else
+    return 0;
+#else
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+
+#if defined(__APPLE__)
+  return usage.ru_maxrss; // In bytes
+#else
+  return usage.ru_maxrss * 1024; // In kilobytes
+#endif
+#endif
+}
+
+MemoryAccount::Stats MemoryAccount::stats() const {
+  return Stats{
+      _allocations.load(std::memory_order_relaxed),
+      _allocated_bytes.load(std::memory_order_relaxed),
+      _live_bytes.load(std::memory_order_relaxed),
+      _peak_bytes.load(std::memory_order_relaxed)};
+}
+
+void MemoryAccount::_allocated(uint64_t bytes) {
+  _allocations.fetch_add(1, std::memory_order_relaxed);
+  _allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+  int64_t live =
+      _live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  auto peak = _peak_bytes.load(std::memory_order_relaxed);
+
+  while (live > peak && !_peak_bytes.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed))
+    ;
+}
+
+void MemoryAccount::_freed(uint64_t bytes) {
+  _live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+} // namespace Fancysoft::Util
+
+// The replaceable global allocation functions.
+//
+
+namespace {
+using Fancysoft::Util::allocate;
+using Fancysoft::Util::deallocate;
+using Fancysoft::Util::try_allocate;
+constexpr size_t default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+} // namespace
+
+void *operator new(size_t size) { return allocate(size, default_alignment); }
+
+void *operator new[](size_t size) {
+  return allocate(size, default_alignment);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return try_allocate(size, default_alignment);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return try_allocate(size, default_alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  return allocate(size, size_t(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return allocate(size, size_t(alignment));
+}
+
+void *operator new(
+    size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return try_allocate(size, size_t(alignment));
+}
+
+void *operator new[](
+    size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return try_allocate(size, size_t(alignment));
+}
+
+void operator delete(void *pointer) noexcept {
+  deallocate(pointer, default_alignment);
+}
+
+void operator delete[](void *pointer) noexcept {
+  deallocate(pointer, default_alignment);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  deallocate(pointer, default_alignment);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  deallocate(pointer, default_alignment);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+  deallocate(pointer, default_alignment);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+  deallocate(pointer, default_alignment);
+}
+
+void operator delete(void *pointer, std::align_val_t alignment) noexcept {
+  deallocate(pointer, size_t(alignment));
+}
+
+void operator delete[](void *pointer, std::align_val_t alignment) noexcept {
+  deallocate(pointer, size_t(alignment));
+}
+
+void operator delete(
+    void *pointer, size_t, std::align_val_t alignment) noexcept {
+  deallocate(pointer, size_t(alignment));
+}
+
+void operator delete[](
+    void *pointer, size_t, std::align_val_t alignment) noexcept {
+  deallocate(pointer, size_t(alignment));
+}
+
+void operator delete(
+    void *pointer,
+    std::align_val_t alignment,
+    const std::nothrow_t &) noexcept {
+  deallocate(pointer, size_t(alignment));
+}
+
+void operator delete[](
+    void *pointer,
+    std::align_val_t alignment,
+    const std::nothrow_t &) noexcept {
+  deallocate(pointer, size_t(alignment));
+}
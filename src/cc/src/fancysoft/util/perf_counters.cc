@@ -0,0 +1,123 @@
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "fancysoft/util/perf_counters.hh"
+
+namespace Fancysoft::Util {
+
+const char *PerfCounters::name(Counter counter) {
+  switch (counter) {
+  case Cycles:
+    return "cycles";
+  case Instructions:
+    return "instructions";
+  case CacheMisses:
+    return "cache-misses";
+  case BranchMisses:
+    return "branch-misses";
+  case CounterCount:
+    break;
+  }
+
+  return "unknown";
+}
+
+PerfCounters::Values
+PerfCounters::Values::operator-(const Values &other) const {
+  Values result;
+
+  for (size_t i = 0; i < CounterCount; i++)
+    result.counts[i] = counts[i] - other.counts[i];
+
+  return result;
+}
+
+PerfCounters::Values &PerfCounters::Values::operator+=(const Values &other) {
+  for (size_t i = 0; i < CounterCount; i++)
+    counts[i] += other.counts[i];
+
+  return *this;
+}
+
+PerfCounters::PerfCounters() {
+  _fds.fill(-1);
+
+#ifdef __linux__
+  const uint64_t configs[CounterCount] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES,
+  };
+
+  for (size_t i = 0; i < CounterCount; i++) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+
+    // Counting the user space only is allowed with `perf_event_paranoid=2`.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // The calling thread on any CPU.
+    int fd = syscall(
+        SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+
+    if (fd < 0) {
+      if (!_error)
+        _error = std::string("Failed to open the ") +
+                 name((Counter)i) + " counter: " + std::strerror(errno);
+
+      continue;
+    }
+
+    _fds[i] = fd;
+  }
+#else
+  _error = "Performance counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (auto fd : _fds)
+    if (fd >= 0)
+      close(fd);
+#endif
+}
+
+bool PerfCounters::available() const {
+  for (auto fd : _fds)
+    if (fd >= 0)
+      return true;
+
+  return false;
+}
+
+PerfCounters::Values PerfCounters::read() const {
+  Values values;
+
+#ifdef __linux__
+  for (size_t i = 0; i < CounterCount; i++) {
+    uint64_t count;
+
+    if (_fds[i] < 0)
+      continue;
+
+    if (::read(_fds[i], &count, sizeof(count)) == sizeof(count))
+      values.counts[i] = count;
+  }
+#endif
+
+  return values;
+}
+
+} // namespace Fancysoft::Util
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "fancysoft/util/tar.hh"
+
+namespace Fancysoft {
+namespace Util {
+namespace Tar {
+
+static const size_t block_size = 512;
+
+/// The ustar header block layout.
+struct Header {
+  char name[100];
+  char mode[8];
+  char uid[8];
+  char gid[8];
+  char size[12];
+  char mtime[12];
+  char checksum[8];
+  char typeflag;
+  char linkname[100];
+  char magic[6];
+  char version[2];
+  char uname[32];
+  char gname[32];
+  char devmajor[8];
+  char devminor[8];
+  char prefix[155];
+  char padding[12];
+};
+
+static_assert(sizeof(Header) == block_size);
+
+/// Write *value* into a *size*d *field* as a zero-padded, NUL-terminated
+/// octal number.
+static void write_octal(char *field, size_t size, uint64_t value) {
+  for (size_t i = size - 1; i-- > 0;) {
+    field[i] = '0' + (value & 7);
+    value >>= 3;
+  }
+
+  if (value)
+    throw Error("The value does not fit into a tar header field");
+
+  field[size - 1] = '\0';
+}
+
+Writer::~Writer() { finish(); }
+
+void Writer::add(
+    std::string_view path, std::string_view contents, int64_t mtime) {
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+
+  // Split a long path into the prefix and the name at a separator.
+  if (path.size() <= sizeof(header.name)) {
+    std::memcpy(header.name, path.data(), path.size());
+  } else {
+    auto separator = path.rfind('/', sizeof(header.prefix));
+
+    if (separator == std::string_view::npos ||
+        path.size() - separator - 1 > sizeof(header.name))
+      throw Error("The path is too long for a tar archive");
+
+    std::memcpy(header.prefix, path.data(), separator);
+    std::memcpy(
+        header.name, path.data() + separator + 1, path.size() - separator - 1);
+  }
+
+  write_octal(header.mode, sizeof(header.mode), 0644);
+  write_octal(header.uid, sizeof(header.uid), 0);
+  write_octal(header.gid, sizeof(header.gid), 0);
+  write_octal(header.size, sizeof(header.size), contents.size());
+  write_octal(header.mtime, sizeof(header.mtime), std::max<int64_t>(mtime, 0));
+  header.typeflag = '0';
+  std::memcpy(header.magic, "ustar", 6);
+  std::memcpy(header.version, "00", 2);
+
+  // The checksum is calculated with the checksum field filled with spaces.
+  std::memset(header.checksum, ' ', sizeof(header.checksum));
+  uint64_t checksum = 0;
+
+  for (size_t i = 0; i < block_size; i++)
+    checksum += reinterpret_cast<unsigned char *>(&header)[i];
+
+  write_octal(header.checksum, sizeof(header.checksum) - 1, checksum);
+  header.checksum[7] = ' ';
+
+  static const std::array<char, block_size> zeros{};
+  auto padding = (block_size - contents.size() % block_size) % block_size;
+
+  std::lock_guard lock(_mutex);
+
+  if (_finished)
+    throw Error("The tar archive is already finished");
+
+  _output.write(reinterpret_cast<char *>(&header), block_size);
+  _output.write(contents.data(), contents.size());
+  _output.write(zeros.data(), padding);
+}
+
+void Writer::finish() {
+  std::lock_guard lock(_mutex);
+
+  if (_finished)
+    return;
+
+  // The archive ends with two zero-filled blocks.
+  static const std::array<char, block_size * 2> zeros{};
+  _output.write(zeros.data(), zeros.size());
+  _output.flush();
+
+  _finished = true;
+}
+
+} // namespace Tar
+} // namespace Util
+} // namespace Fancysoft
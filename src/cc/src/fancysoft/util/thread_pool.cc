@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "fancysoft/util/thread_pool.hh"
+
+namespace Fancysoft {
+namespace Util {
+
+ThreadPool::ThreadPool(unsigned size) {
+  if (!size)
+    size = std::max(1u, std::thread::hardware_concurrency());
+
+  _workers.reserve(size);
+
+  for (unsigned i = 0; i < size; i++)
+    _workers.emplace_back(&ThreadPool::_work, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(_mutex);
+    _stopping = true;
+  }
+
+  _task_available.notify_all();
+
+  for (auto &worker : _workers)
+    worker.join();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock lock(_mutex);
+  _idle.wait(lock, [this]() { return _queue.empty() && !_busy; });
+}
+
+void ThreadPool::_push(std::function<void()> task) {
+  {
+    std::lock_guard lock(_mutex);
+    _queue.push_back(std::move(task));
+  }
+
+  _task_available.notify_one();
+}
+
+void ThreadPool::_work() {
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock lock(_mutex);
+      _task_available.wait(
+          lock, [this]() { return _stopping || !_queue.empty(); });
+
+      // The remaining tasks are drained before stopping.
+      if (_queue.empty())
+        return;
+
+      task = std::move(_queue.front());
+      _queue.pop_front();
+      _busy++;
+    }
+
+    task();
+
+    {
+      std::lock_guard lock(_mutex);
+      _busy--;
+
+      if (_queue.empty() && !_busy)
+        _idle.notify_all();
+    }
+  }
+}
+
+} // namespace Util
+} // namespace Fancysoft
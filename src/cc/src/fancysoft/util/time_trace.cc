@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+#include "fancysoft/util/time_trace.hh"
+
+namespace Fancysoft::Util {
+
+TimeTrace time_trace;
+
+namespace {
+
+void write_json_string(std::ostream &output, std::string_view string) {
+  output << '"';
+
+  for (unsigned char ch : string) {
+    switch (ch) {
+    case '"':
+      output << "\\\"";
+      break;
+    case '\\':
+      output << "\\\\";
+      break;
+    case '\n':
+      output << "\\n";
+      break;
+    default:
+      if (ch < 0x20) {
+        char buffer[8];
+        snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+        output << buffer;
+      } else
+        output << ch;
+    }
+  }
+
+  output << '"';
+}
+
+std::atomic<uint64_t> next_id = 0;
+
+int64_t to_us(TimeTrace::Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+} // namespace
+
+TimeTrace::TimeTrace() : _id(next_id++) {}
+
+void TimeTrace::Scope::_begin() {
+  if (_trace->_counters_enabled.load(std::memory_order_relaxed)) {
+    auto &thread = _trace->_current_thread();
+
+    if (thread.counters && thread.counters->available())
+      _start_counters = thread.counters->read();
+  }
+
+  if (_trace->_memory_enabled.load(std::memory_order_relaxed))
+    _start_allocations = MemoryAccount::thread_stats();
+
+  // The last, so that the counters reading is not accounted.
+  _start = Clock::now();
+}
+
+TimeTrace::Scope::~Scope() {
+  if (!_trace)
+    return;
+
+  auto duration = Clock::now() - _start;
+  std::optional<PerfCounters::Values> counters;
+
+  if (_start_counters)
+    counters = _trace->_current_thread().counters->read() - *_start_counters;
+
+  std::optional<MemoryAccount::Stats> allocations;
+  uint64_t process_peak_rss = 0;
+
+  if (_start_allocations) {
+    allocations = MemoryAccount::thread_stats() - *_start_allocations;
+    process_peak_rss = MemoryAccount::peak_rss();
+  }
+
+  _trace->_record(Event{
+      _name,
+      std::move(_detail),
+      _start,
+      duration,
+      counters,
+      allocations,
+      process_peak_rss});
+}
+
+void TimeTrace::enable(bool counters, bool memory) {
+  std::lock_guard lock(_mutex);
+
+  if (_epoch == Clock::time_point())
+    _epoch = Clock::now();
+
+  if (memory)
+    MemoryAccount::enable();
+
+  _counters_enabled.store(counters, std::memory_order_relaxed);
+  _memory_enabled.store(memory, std::memory_order_relaxed);
+  _enabled.store(true, std::memory_order_relaxed);
+}
+
+std::optional<std::string> TimeTrace::counters_error() {
+  if (!_counters_enabled.load(std::memory_order_relaxed))
+    return std::nullopt;
+
+  auto &thread = _current_thread();
+
+  if (thread.counters->available())
+    return std::nullopt;
+  else
+    return thread.counters->error();
+}
+
+void TimeTrace::clear() {
+  std::lock_guard lock(_mutex);
+
+  std::erase_if(_threads, [](auto &thread) {
+    std::lock_guard thread_lock(thread->mutex);
+    thread->events.clear();
+    return thread->exited;
+  });
+}
+
+TimeTrace::_Thread &TimeTrace::_current_thread() {
+  // A thread may record into multiple traces. Upon its exit, its counters
+  // are closed, as they would otherwise keep the descriptors open.
+  thread_local struct Registry {
+    std::map<uint64_t, std::shared_ptr<_Thread>> threads;
+
+    ~Registry() {
+      for (auto &[id, thread] : threads) {
+        std::lock_guard lock(thread->mutex);
+        thread->counters.reset();
+        thread->exited = true;
+      }
+    }
+  } registry;
+
+  auto &thread = registry.threads[_id];
+
+  if (!thread) {
+    std::lock_guard lock(_mutex);
+    thread = std::make_shared<_Thread>();
+    thread->id = _next_thread_id++;
+    _threads.push_back(thread);
+  }
+
+  if (!thread->counters && _counters_enabled.load(std::memory_order_relaxed)) {
+    auto counters = std::make_unique<PerfCounters>();
+    std::lock_guard lock(thread->mutex);
+
+    for (size_t i = 0; i < PerfCounters::CounterCount; i++)
+      thread->has_counters[i] = counters->has((PerfCounters::Counter)i);
+
+    thread->counters = std::move(counters);
+  }
+
+  return *thread;
+}
+
+void TimeTrace::_record(Event event) {
+  auto &thread = _current_thread();
+
+  std::lock_guard lock(thread.mutex);
+  thread.events.push_back(std::move(event));
+}
+
+void TimeTrace::write(std::ostream &output) const {
+  std::lock_guard lock(_mutex);
+  output << "{\"traceEvents\":[";
+
+  output << "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\","
+            "\"args\":{\"name\":\"fnxc\"}}";
+
+  for (auto &thread : _threads) {
+    output << ",{\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+           << ",\"name\":\"thread_name\",\"args\":{\"name\":\"thread "
+           << thread->id << "\"}}";
+
+    std::lock_guard thread_lock(thread->mutex);
+
+    for (auto &event : thread->events) {
+      output << ",{\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+             << ",\"ts\":" << to_us(event.start - _epoch)
+             << ",\"dur\":" << to_us(event.duration) << ",\"name\":";
+
+      write_json_string(output, event.name);
+      output << ",\"args\":{";
+
+      bool first = true;
+
+      if (!event.detail.empty()) {
+        output << "\"detail\":";
+        write_json_string(output, event.detail);
+        first = false;
+      }
+
+      if (event.counters) {
+        for (size_t i = 0; i < PerfCounters::CounterCount; i++) {
+          if (!thread->has_counters[i])
+            continue;
+
+          if (!first)
+            output << ",";
+
+          output << "\"" << PerfCounters::name((PerfCounters::Counter)i)
+                 << "\":" << event.counters->counts[i];
+
+          first = false;
+        }
+      }
+
+      if (event.allocations) {
+        if (!first)
+          output << ",";
+
+        output << "\"allocations\":" << event.allocations->allocations
+               << ",\"allocated_bytes\":"
+               << event.allocations->allocated_bytes
+               << ",\"process_peak_rss\":" << event.process_peak_rss;
+      }
+
+      output << "}}";
+    }
+  }
+
+  output << "],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+TimeTrace::_Summary TimeTrace::_summarize() const {
+  _Summary summary;
+  std::map<std::string_view, _Total> totals;
+
+  {
+    std::lock_guard lock(_mutex);
+
+    for (auto &thread : _threads) {
+      std::lock_guard thread_lock(thread->mutex);
+
+      for (auto &event : thread->events) {
+        auto &total = totals[event.name];
+        total.name = event.name;
+        total.count++;
+        total.duration += event.duration;
+
+        if (event.counters) {
+          total.counters += *event.counters;
+
+          for (size_t i = 0; i < PerfCounters::CounterCount; i++)
+            if (thread->has_counters[i])
+              summary.counters[i] = summary.any_counters = true;
+        }
+
+        if (event.allocations) {
+          total.allocations.allocations += event.allocations->allocations;
+          total.allocations.allocated_bytes +=
+              event.allocations->allocated_bytes;
+          total.process_peak_rss =
+              std::max(total.process_peak_rss, event.process_peak_rss);
+          summary.memory = true;
+        }
+      }
+    }
+  }
+
+  for (auto &pair : totals)
+    summary.totals.push_back(pair.second);
+
+  std::sort(
+      summary.totals.begin(), summary.totals.end(), [](auto &a, auto &b) {
+        return a.duration > b.duration;
+      });
+
+  return summary;
+}
+
+void TimeTrace::write_summary(std::ostream &output) const {
+  auto summary = _summarize();
+
+  auto flags = output.flags();
+  output << std::left << std::setw(24) << "Name" << std::right
+         << std::setw(8) << "Count" << std::setw(14) << "Total, ms"
+         << std::setw(14) << "Average, ms";
+
+  if (summary.any_counters)
+    for (size_t i = 0; i < PerfCounters::CounterCount; i++)
+      output << std::setw(16) << PerfCounters::name((PerfCounters::Counter)i);
+
+  if (summary.memory)
+    output << std::setw(14) << "Allocations" << std::setw(14)
+           << "Allocated, MiB" << std::setw(24) << "Process peak RSS, MiB";
+
+  output << "\n" << std::fixed << std::setprecision(3);
+
+  for (auto &total : summary.totals) {
+    double ms = to_us(total.duration) / 1000.0;
+
+    output << std::left << std::setw(24) << total.name << std::right
+           << std::setw(8) << total.count << std::setw(14) << ms
+           << std::setw(14) << ms / total.count;
+
+    if (summary.any_counters)
+      for (size_t i = 0; i < PerfCounters::CounterCount; i++) {
+        if (summary.counters[i])
+          output << std::setw(16) << total.counters.counts[i];
+        else
+          output << std::setw(16) << "-";
+      }
+
+    if (summary.memory)
+      output << std::setw(14) << total.allocations.allocations
+             << std::setw(14)
+             << total.allocations.allocated_bytes / 1048576.0
+             << std::setw(24) << total.process_peak_rss / 1048576.0;
+
+    output << "\n";
+  }
+
+  output.flags(flags);
+}
+
+void TimeTrace::write_summary_json(std::ostream &output) const {
+  auto summary = _summarize();
+  output << "[";
+
+  for (size_t i = 0; i < summary.totals.size(); i++) {
+    auto &total = summary.totals[i];
+
+    if (i)
+      output << ",";
+
+    output << "{\"name\":";
+    write_json_string(output, total.name);
+    output << ",\"count\":" << total.count
+           << ",\"total_us\":" << to_us(total.duration);
+
+    for (size_t j = 0; j < PerfCounters::CounterCount; j++)
+      if (summary.counters[j])
+        output << ",\"" << PerfCounters::name((PerfCounters::Counter)j)
+               << "\":" << total.counters.counts[j];
+
+    if (summary.memory)
+      output << ",\"allocations\":" << total.allocations.allocations
+             << ",\"allocated_bytes\":" << total.allocations.allocated_bytes
+             << ",\"process_peak_rss\":" << total.process_peak_rss;
+
+    output << "}";
+  }
+
+  output << "]";
+}
+
+} // namespace Fancysoft::Util
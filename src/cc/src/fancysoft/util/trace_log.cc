@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <map>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include "fancysoft/util/trace_log.hh"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define __FNXC__TRACE_LOG_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace Fancysoft::Util {
+
+TraceLog trace_log;
+
+namespace {
+
+const char Magic[8] = {'N', 'X', 'C', 'T', 'R', 'A', 'C', 'E'};
+
+/// A block is written once the thread's buffer exceeds it.
+const size_t BlockSize = 64 * 1024;
+
+std::atomic<uint64_t> next_id = 0;
+
+/// Return a monotonic tick count. On x86, it is the time stamp counter, which
+/// is invariant and synchronized across the cores on the modern CPUs, and
+/// costs a few nanoseconds to read unlike the clock, which may be a syscall.
+uint64_t ticks() {
+#ifdef __FNXC__TRACE_LOG_TSC
+  return __rdtsc();
+#else
+  return TraceLog::Clock::now().time_since_epoch().count();
+#endif
+}
+
+template <typename T> void write_raw(std::ostream &output, const T &value) {
+  output.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> T read_raw(std::istream &input) {
+  T value;
+
+  if (!input.read(reinterpret_cast<char *>(&value), sizeof(value)))
+    throw TraceLog::Error("Unexpected end of the trace log");
+
+  return value;
+}
+
+/// Reads the fields of a block.
+struct Cursor {
+  const char *data;
+  const char *end;
+
+  template <typename T> T read() {
+    if (end - data < (ptrdiff_t)sizeof(T))
+      throw TraceLog::Error("Truncated trace log event");
+
+    T value;
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return value;
+  }
+
+  std::string read_string(size_t length) {
+    if (end - data < (ptrdiff_t)length)
+      throw TraceLog::Error("Truncated trace log event");
+
+    std::string string(data, length);
+    data += length;
+    return string;
+  }
+};
+
+} // namespace
+
+TraceLog::TraceLog() : _id(next_id++) {}
+
+TraceLog::~TraceLog() { close(); }
+
+void TraceLog::open(const std::filesystem::path &path) {
+  close();
+  std::lock_guard lock(_mutex);
+
+  _file.open(path, std::ios::binary | std::ios::trunc);
+
+  if (!_file)
+    throw Error("Could not open " + path.string() + " for writing");
+
+  _file.write(Magic, sizeof(Magic));
+  write_raw(_file, Version);
+
+  // The ids may have been cached by the call sites of a previous file.
+  for (size_t i = 0; i < _strings.size(); i++)
+    _write_string(i + 1, _strings[i]);
+
+#ifdef __FNXC__TRACE_LOG_TSC
+  // The rate of the counter is measured against the clock.
+  auto start = Clock::now();
+  auto start_ticks = ticks();
+  Clock::duration elapsed;
+
+  do
+    elapsed = Clock::now() - start;
+  while (elapsed < std::chrono::milliseconds(1));
+
+  _ns_per_tick =
+      std::chrono::duration<double, std::nano>(elapsed).count() /
+      (ticks() - start_ticks);
+#else
+  _ns_per_tick = std::chrono::duration<double, std::nano>(Clock::duration(1))
+                     .count();
+#endif
+
+  _epoch_ticks = ticks();
+  _enabled.store(true, std::memory_order_release);
+}
+
+void TraceLog::close() {
+  std::lock_guard lock(_mutex);
+
+  if (!_file.is_open())
+    return;
+
+  _enabled.store(false, std::memory_order_release);
+
+  for (auto &thread : _threads) {
+    std::lock_guard thread_lock(thread->mutex);
+    _flush(*thread);
+  }
+
+  _file.close();
+}
+
+TraceLog::Id TraceLog::intern(std::string_view string) {
+  std::lock_guard lock(_mutex);
+  auto [it, inserted] = _ids.emplace(string, _strings.size() + 1);
+
+  if (inserted) {
+    _strings.emplace_back(string);
+
+    if (_file.is_open())
+      _write_string(it->second, string);
+  }
+
+  return it->second;
+}
+
+TraceLog::_Thread &TraceLog::_current_thread() {
+  // The last used log is cached, as there is usually just the one.
+  thread_local uint64_t last_id = UINT64_MAX;
+  thread_local _Thread *last = nullptr;
+
+  if (last_id == _id)
+    return *last;
+
+  // A thread may record into multiple logs.
+  thread_local std::map<uint64_t, std::shared_ptr<_Thread>> threads;
+  auto &thread = threads[_id];
+
+  if (!thread) {
+    std::lock_guard lock(_mutex);
+    thread = std::make_shared<_Thread>();
+    thread->id = _threads.size();
+    thread->buffer.reserve(BlockSize + MaxPayload + 32);
+    _threads.push_back(thread);
+  }
+
+  last_id = _id;
+  last = thread.get();
+  return *thread;
+}
+
+uint64_t TraceLog::_now() const {
+  // A tick read on another core may precede the epoch by a bit.
+  auto elapsed = (int64_t)(ticks() - _epoch_ticks);
+  return elapsed > 0 ? elapsed * _ns_per_tick : 0;
+}
+
+void TraceLog::_append(Id context, Id name, const char *payload, size_t size) {
+  auto &thread = _current_thread();
+  uint64_t ns = _now();
+
+  bool full;
+
+  {
+    std::lock_guard lock(thread.mutex);
+    auto &buffer = thread.buffer;
+    auto offset = buffer.size();
+    buffer.resize(offset + 17 + size);
+
+    auto data = buffer.data() + offset;
+    memcpy(data, &context, 4);
+    memcpy(data + 4, &name, 4);
+    memcpy(data + 8, &ns, 8);
+    data[16] = size;
+    memcpy(data + 17, payload, size);
+
+    full = buffer.size() >= BlockSize;
+  }
+
+  if (full) {
+    // Locked in the same order as by `close()`.
+    std::lock_guard file_lock(_mutex);
+    std::lock_guard lock(thread.mutex);
+    _flush(thread);
+  }
+}
+
+void TraceLog::_flush(_Thread &thread) {
+  if (thread.buffer.empty())
+    return;
+
+  if (_file.is_open()) {
+    _file.put('B');
+    write_raw(_file, thread.id);
+    write_raw(_file, (uint32_t)thread.buffer.size());
+    _file.write(thread.buffer.data(), thread.buffer.size());
+  }
+
+  thread.buffer.clear();
+}
+
+void TraceLog::_write_string(Id id, std::string_view string) {
+  auto length = (uint16_t)std::min<size_t>(string.size(), UINT16_MAX);
+  _file.put('S');
+  write_raw(_file, id);
+  write_raw(_file, length);
+  _file.write(string.data(), length);
+}
+
+void TraceLog::read(
+    std::istream &input, const std::function<void(const Event &)> &callback) {
+  char magic[sizeof(Magic)];
+
+  if (!input.read(magic, sizeof(magic)) ||
+      memcmp(magic, Magic, sizeof(Magic)))
+    throw Error("Not a trace log");
+
+  if (auto version = read_raw<uint32_t>(input); version != Version)
+    throw Error(fmt::format("Unsupported trace log version {}", version));
+
+  std::vector<std::string> strings;
+
+  auto string_at = [&strings](Id id) -> std::string_view {
+    if (id == 0 || id > strings.size())
+      throw Error(fmt::format("Undefined trace log string {}", id));
+
+    return strings[id - 1];
+  };
+
+  std::vector<char> block;
+  int tag;
+
+  while ((tag = input.get()) != EOF) {
+    switch (tag) {
+    case 'S': {
+      auto id = read_raw<Id>(input);
+
+      if (id == 0)
+        throw Error("Invalid trace log string id");
+
+      std::string string(read_raw<uint16_t>(input), '\0');
+
+      if (!input.read(string.data(), string.size()))
+        throw Error("Unexpected end of the trace log");
+
+      if (strings.size() < id)
+        strings.resize(id);
+
+      strings[id - 1] = std::move(string);
+      break;
+    }
+
+    case 'B': {
+      Event event;
+      event.thread = read_raw<uint32_t>(input);
+      block.resize(read_raw<uint32_t>(input));
+
+      if (!input.read(block.data(), block.size()))
+        throw Error("Unexpected end of the trace log");
+
+      Cursor cursor{block.data(), block.data() + block.size()};
+
+      while (cursor.data != cursor.end) {
+        event.context = string_at(cursor.read<Id>());
+        event.name = string_at(cursor.read<Id>());
+        event.timestamp = std::chrono::nanoseconds(cursor.read<uint64_t>());
+        event.args.clear();
+
+        auto size = cursor.read<uint8_t>();
+        Cursor payload{cursor.data, cursor.data + size};
+        cursor.read_string(size);
+
+        while (payload.data != payload.end) {
+          switch (payload.read<char>()) {
+          case 'c':
+            event.args.push_back(payload.read<char>());
+            break;
+          case 'i':
+            event.args.push_back(payload.read<int64_t>());
+            break;
+          case 'u':
+            event.args.push_back(payload.read<uint64_t>());
+            break;
+          case 'd':
+            event.args.push_back(payload.read<double>());
+            break;
+          case 's':
+            event.args.push_back(payload.read_string(payload.read<uint8_t>()));
+            break;
+          default:
+            throw Error("Unknown trace log argument type");
+          }
+        }
+
+        callback(event);
+      }
+
+      break;
+    }
+
+    default:
+      throw Error(fmt::format("Unknown trace log record `{:c}`", (char)tag));
+    }
+  }
+}
+
+void TraceLog::dump(std::istream &input, std::ostream &output) {
+  struct Line {
+    std::chrono::nanoseconds timestamp;
+    std::string text;
+  };
+
+  std::vector<Line> lines;
+
+  read(input, [&lines](const Event &event) {
+    std::string text = fmt::format(
+        "[{:.6f}][@{}][{}] {}",
+        std::chrono::duration<double>(event.timestamp).count(),
+        event.thread,
+        event.context,
+        event.name);
+
+    for (auto &arg : event.args) {
+      text += ' ';
+
+      if (auto ch = std::get_if<char>(&arg)) {
+        switch (*ch) {
+        case '\n':
+          text += "'\\n'";
+          break;
+        case EOF:
+          text += "EOF";
+          break;
+        default:
+          text += fmt::format("'{}'", *ch);
+        }
+      } else if (auto string = std::get_if<std::string>(&arg))
+        text += fmt::format("`{}`", *string);
+      else
+        std::visit([&text](auto &value) { text += fmt::format("{}", value); },
+                   arg);
+    }
+
+    lines.push_back({event.timestamp, std::move(text)});
+  });
+
+  // The blocks of the threads are interleaved arbitrarily.
+  std::stable_sort(lines.begin(), lines.end(), [](auto &a, auto &b) {
+    return a.timestamp < b.timestamp;
+  });
+
+  for (auto &line : lines)
+    output << line.text << '\n';
+}
+
+} // namespace Fancysoft::Util
@@ -1,110 +1,337 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "fancysoft/util/utf8.hh"
 
 namespace Fancysoft {
 namespace Util {
-
-/**
- * @details The implemenation is adapted from
- * https://rosettacode.org/wiki/UTF-8_encode_and_decode#C,
- * licensed under GNU (FDL) 1.2.
- */
 namespace UTF8 {
 
-typedef struct {
-  // This mask is applied to a byte to
-  // determine the size of a codepoint.
-  uint8_t mask;
+/// The amount of bytes checked at once in an ASCII run.
+const size_t BlockSize = 32;
 
-  // Leading byte mask.
-  uint8_t lead;
+/// The code point an ill-formed input is replaced with.
+const char32_t Replacement = 0xfffd;
 
-  // The beginning of the codepoint range.
-  uint32_t range_begin;
+/// Are all the `BlockSize` bytes at *data* ASCII?
+static inline bool is_ascii_block(const char8_t *data) {
+#ifdef __SSE2__
+  auto a = _mm_loadu_si128((const __m128i *)data);
+  auto b = _mm_loadu_si128((const __m128i *)(data + 16));
+  return !_mm_movemask_epi8(_mm_or_si128(a, b));
+#else
+  uint64_t words[4];
+  std::memcpy(words, data, sizeof(words));
+  return !((words[0] | words[1] | words[2] | words[3]) &
+           0x8080808080808080ull);
+#endif
+}
 
-  // The end of the codepoint range.
-  uint32_t range_end;
+/// Widen the `BlockSize` ASCII bytes at *data* into *out*.
+static inline void widen_block(const char8_t *data, char32_t *out) {
+#ifdef __SSE2__
+  const auto zero = _mm_setzero_si128();
 
-  // The number of significant bits in an encoded byte.
-  uint8_t significant_bits;
-} utf_t;
+  for (size_t i = 0; i < BlockSize; i += 16) {
+    auto bytes = _mm_loadu_si128((const __m128i *)(data + i));
+    auto low = _mm_unpacklo_epi8(bytes, zero);
+    auto high = _mm_unpackhi_epi8(bytes, zero);
 
-utf_t *utf[] = {
-    new utf_t({0b00111111, 0b10000000, 0, 0, 6}),
-    new utf_t({0b01111111, 0b00000000, 0000, 0177, 7}),
-    new utf_t({0b00011111, 0b11000000, 0200, 03777, 5}),
-    new utf_t({0b00001111, 0b11100000, 04000, 0177777, 4}),
-    new utf_t({0b00000111, 0b11110000, 0200000, 04177777, 3}),
-    0,
-};
+    _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi16(low, zero));
+    _mm_storeu_si128((__m128i *)(out + i + 4), _mm_unpackhi_epi16(low, zero));
+    _mm_storeu_si128((__m128i *)(out + i + 8), _mm_unpacklo_epi16(high, zero));
+    _mm_storeu_si128(
+        (__m128i *)(out + i + 12), _mm_unpackhi_epi16(high, zero));
+  }
+#else
+  for (size_t i = 0; i < BlockSize; i++)
+    out[i] = data[i];
+#endif
+}
 
-} // namespace UTF8
+/// Narrow the `BlockSize` code points at *data* into *out* if all of
+/// them are ASCII, returning whether they were.
+static inline bool narrow_block(const char32_t *data, char8_t *out) {
+#ifdef __SSE2__
+  __m128i words[BlockSize / 4];
+  auto any = _mm_setzero_si128();
+
+  for (size_t i = 0; i < BlockSize / 4; i++) {
+    words[i] = _mm_loadu_si128((const __m128i *)(data + i * 4));
+    any = _mm_or_si128(any, words[i]);
+  }
 
-size_t UTF8::code_point_byte_size(char32_t codepoint) {
-  size_t len = 0;
+  // Any bit above the seventh one.
+  auto high = _mm_andnot_si128(_mm_set1_epi32(0x7f), any);
 
-  for (utf_t **u = utf; *u; ++u) {
-    if ((codepoint >= (*u)->range_begin) &&
-        (codepoint <= (*u)->range_end))
-      break;
+  if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) !=
+      0xffff)
+    return false;
 
-    ++len;
+  for (size_t i = 0; i < BlockSize / 4; i += 4) {
+    auto first = _mm_packs_epi32(words[i], words[i + 1]);
+    auto second = _mm_packs_epi32(words[i + 2], words[i + 3]);
+    _mm_storeu_si128(
+        (__m128i *)(out + i * 4), _mm_packus_epi16(first, second));
   }
 
-  if (len > 4)
-    throw Error("UTF-8 codepoint length out of boundaries");
+  return true;
+#else
+  char32_t any = 0;
+
+  for (size_t i = 0; i < BlockSize; i++)
+    any |= data[i];
+
+  if (any >= 0x80)
+    return false;
+
+  for (size_t i = 0; i < BlockSize; i++)
+    out[i] = data[i];
 
-  if (len == 0)
-    return 1; // \0 still takes one byte
-  else
-    return len;
+  return true;
+#endif
 }
 
-size_t UTF8::size_from_leading_byte(char8_t ch) {
-  size_t len = 0;
+/// Return the size of a well-formed sequence at *data* with *left*
+/// bytes remaining, or zero.
+static inline size_t well_formed_size(const char8_t *data, size_t left) {
+  auto size = sequence_size(data[0]);
 
-  for (utf_t **u = utf; *u; ++u) {
-    uint8_t result = (ch & ~(*u)->mask);
+  if (!size || size > left)
+    return 0;
 
-    if (result == ((*u)->lead))
-      break;
+  // The second byte's range excludes overlongs, surrogates and
+  // code points above U+10FFFF, see Unicode's Table 3-7.
+  char8_t min = 0x80, max = 0xbf;
 
-    len++;
+  switch (data[0]) {
+  case 0xe0:
+    min = 0xa0;
+    break;
+  case 0xed:
+    max = 0x9f;
+    break;
+  case 0xf0:
+    min = 0x90;
+    break;
+  case 0xf4:
+    max = 0x8f;
+    break;
   }
 
-  if (len > 4)
+  if (size > 1 && (data[1] < min || data[1] > max))
+    return 0;
+
+  for (size_t i = 2; i < size; i++)
+    if ((data[i] & 0xc0) != 0x80)
+      return 0;
+
+  return size;
+}
+
+/// Return the encoded size of *code_point*, zero if out of range.
+static inline size_t encoded_size(char32_t code_point) {
+  return code_point <= 0x10ffff
+             ? Detail::size_by_bit_width[std::bit_width((uint32_t)code_point)]
+             : 0;
+}
+
+/// Write a *size* code units long *code_point* into the four code
+/// units at *out*, the excess ones are garbage. Branchless, as the
+/// shifts are masked instead.
+static inline void
+encode_sequence(char32_t code_point, size_t size, char8_t *out) {
+  const unsigned shift = 6 * (size - 1);
+
+  out[0] = Detail::lead_marker[size] | (code_point >> shift);
+  out[1] = 0x80 | ((code_point >> ((shift - 6) & 31)) & 0x3f);
+  out[2] = 0x80 | ((code_point >> ((shift - 12) & 31)) & 0x3f);
+  out[3] = 0x80 | (code_point & 0x3f);
+}
+
+} // namespace UTF8
+
+size_t UTF8::code_point_byte_size(char32_t code_point) {
+  auto size = encoded_size(code_point);
+
+  if (!size)
+    throw Error("UTF-8 codepoint length out of boundaries");
+
+  return size;
+}
+
+size_t UTF8::size_from_leading_byte(char8_t ch) {
+  auto ones = std::countl_one((uint8_t)ch);
+
+  if (ones > 4)
     throw Error("Malformed leading byte");
 
-  return len;
+  return Detail::size_by_leading_ones[ones];
 }
 
-char8_t *UTF8::to_code_units(char32_t codepoint) {
+char8_t *UTF8::to_code_units(char32_t code_point) {
   static thread_local char8_t ret[5];
-  const int bytes = code_point_byte_size(codepoint);
+  const auto size = code_point_byte_size(code_point);
+
+  encode_sequence(code_point, size, ret);
+  ret[size] = '\0';
+
+  return ret;
+}
+
+char32_t UTF8::to_code_point(const char8_t *code_units) {
+  return decode_sequence(code_units, size_from_leading_byte(*code_units));
+}
+
+size_t UTF8::validate(std::string_view string) {
+  auto data = (const char8_t *)string.data();
+  const size_t size = string.size();
+  size_t i = 0;
 
-  int shift = utf[0]->significant_bits * (bytes - 1);
-  ret[0] = (codepoint >> shift & utf[bytes]->mask) | utf[bytes]->lead;
-  shift -= utf[0]->significant_bits;
+  while (i < size) {
+    if (size - i >= BlockSize && is_ascii_block(data + i)) {
+      i += BlockSize;
+      continue;
+    }
 
-  for (int i = 1; i < bytes; ++i) {
-    ret[i] = (codepoint >> shift & utf[0]->mask) | utf[0]->lead;
-    shift -= utf[0]->significant_bits;
+    // Check a block containing non-ASCII bytes, or the tail, one
+    // sequence at a time.
+    const size_t end = std::min(size, i + BlockSize);
+
+    while (i < end) {
+      auto sequence = well_formed_size(data + i, size - i);
+
+      if (!sequence)
+        return i;
+
+      i += sequence;
+    }
   }
 
-  ret[bytes] = '\0';
-  return ret;
+  return size;
+}
+
+size_t UTF8::count_code_points(std::span<const char8_t> units) {
+  auto data = units.data();
+  const size_t size = units.size();
+  size_t i = 0, continuations = 0;
+
+#ifdef __SSE2__
+  // A continuation byte is 0b10xxxxxx, i.e. below -64 as signed.
+  const auto threshold = _mm_set1_epi8(-64);
+
+  for (; i + 16 <= size; i += 16) {
+    auto bytes = _mm_loadu_si128((const __m128i *)(data + i));
+    continuations += std::popcount(
+        (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(bytes, threshold)));
+  }
+#else
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+
+    // The seventh bit set, and the sixth one unset.
+    continuations +=
+        std::popcount(word & ~(word << 1) & 0x8080808080808080ull);
+  }
+#endif
+
+  for (; i < size; i++)
+    continuations += (data[i] & 0xc0) == 0x80;
+
+  return size - continuations;
 }
 
-char32_t UTF8::to_code_point(const char8_t *codeunits) {
-  int bytes = size_from_leading_byte(*codeunits);
-  int shift = utf[0]->significant_bits * (bytes - 1);
-  char32_t codepoint = (*codeunits++ & utf[bytes]->mask) << shift;
+size_t UTF8::decode_n(std::span<const char8_t> units, std::span<char32_t> out) {
+  auto data = units.data();
+  const size_t size = units.size();
+  size_t i = 0, written = 0;
+
+  while (i < size) {
+    if (size - i >= BlockSize && is_ascii_block(data + i)) {
+      widen_block(data + i, out.data() + written);
+      i += BlockSize;
+      written += BlockSize;
+      continue;
+    }
+
+    const size_t end = std::min(size, i + BlockSize);
+
+    // Branchless while the four code units may be read at once, the
+    // excess ones are shifted out.
+    for (; i < end && i + 4 <= size; written++) {
+      const size_t sequence = sequence_size(data[i]);
+
+      char32_t code_point = (data[i] & Detail::lead_mask[sequence]) << 18 |
+                            (data[i + 1] & 0x3f) << 12 |
+                            (data[i + 2] & 0x3f) << 6 | (data[i + 3] & 0x3f);
+      code_point >>= 6 * (4 - sequence);
+
+      // An invalid leading byte is skipped alone.
+      const bool invalid = !sequence;
+      out[written] = invalid ? Replacement : code_point;
+      i += sequence + invalid;
+    }
+
+    for (; i < end; written++) {
+      const size_t sequence = sequence_size(data[i]);
+
+      if (!sequence || i + sequence > size) {
+        out[written] = Replacement;
+        i++;
+      } else {
+        out[written] = decode_sequence(data + i, sequence);
+        i += sequence;
+      }
+    }
+  }
+
+  return written;
+}
+
+size_t
+UTF8::encode_n(std::span<const char32_t> code_points, std::span<char8_t> out) {
+  auto data = code_points.data();
+  const size_t size = code_points.size();
+  size_t i = 0, written = 0;
+
+  while (i < size) {
+    if (size - i >= BlockSize && out.size() - written >= BlockSize &&
+        narrow_block(data + i, out.data() + written)) {
+      i += BlockSize;
+      written += BlockSize;
+      continue;
+    }
+
+    const size_t end = std::min(size, i + BlockSize);
+
+    for (; i < end; i++) {
+      auto code_point = data[i];
+      size_t sequence = encoded_size(code_point);
+
+      const bool invalid = !sequence;
+      code_point = invalid ? Replacement : code_point;
+      sequence = invalid ? 3 : sequence;
+
+      // Written in full while there is a room for the excess.
+      if (out.size() - written >= 4) {
+        encode_sequence(code_point, sequence, out.data() + written);
+      } else {
+        char8_t units[4];
+        encode_sequence(code_point, sequence, units);
+        std::memcpy(out.data() + written, units, sequence);
+      }
 
-  for (int i = 1; i < bytes; ++i, ++codeunits) {
-    shift -= utf[0]->significant_bits;
-    codepoint |= ((char8_t)*codeunits & utf[0]->mask) << shift;
+      written += sequence;
+    }
   }
 
-  return codepoint;
+  return written;
 }
 
 } // namespace Util
@@ -0,0 +1,97 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "fancysoft/nxc/index.hh"
+#include "fancysoft/util/logger.hh"
+
+using namespace Fancysoft;
+using namespace Fancysoft::NXC;
+
+Util::Logger Util::logger(Util::Logger::Verbosity::Fatal, std::cerr);
+
+TEST_CASE("Index") {
+  auto temp = std::filesystem::temp_directory_path() / "fnxc-test-index";
+  std::filesystem::remove_all(temp);
+  std::filesystem::create_directories(temp);
+
+  auto source = temp / "main.nx";
+  std::ofstream(source) << "let x = y\n";
+
+  auto hash = Index::hash_file(source);
+  REQUIRE(hash);
+
+  Index index(temp / "index");
+
+  std::vector<Index::Entry> entries = {
+      {Index::Kind::VarRef,
+       "y",
+       source,
+       Position(0, 8),
+       source,
+       Position(0, 4),
+       "%y"},
+      {Index::Kind::VarDecl,
+       "x",
+       source,
+       Position(0, 4),
+       source,
+       Position(0, 4),
+       "%x"}};
+
+  SUBCASE("looks the committed entries up") {
+    CHECK(!index.fresh(source, *hash));
+    index.update(source, *hash, entries);
+
+    // The shard is skipped until the source hash changes.
+    CHECK(index.fresh(source, *hash));
+    CHECK(!index.fresh(source, *hash + 1));
+
+    // Not committed yet.
+    CHECK(index.lookup("x").empty());
+
+    index.commit();
+    auto found = index.lookup("x");
+
+    REQUIRE(found.size() == 1);
+    CHECK(found[0].kind == Index::Kind::VarDecl);
+    CHECK(found[0].path == source.generic_string());
+    CHECK(found[0].position.row == 0);
+    CHECK(found[0].position.col == 4);
+    CHECK(found[0].description == "%x");
+    CHECK(found[0].is_declaration());
+
+    REQUIRE(index.lookup("y").size() == 1);
+    CHECK(index.lookup("z").empty());
+  }
+
+  SUBCASE("does not merge unless a shard has changed") {
+    index.update(source, *hash, entries);
+    index.commit();
+
+    auto merged = temp / "index" / "index.bin";
+    auto time = std::filesystem::last_write_time(merged);
+
+    index.commit();
+    CHECK(std::filesystem::last_write_time(merged) == time);
+  }
+
+  SUBCASE("removes the entries of a deleted source upon commit") {
+    index.update(source, *hash, entries);
+    index.commit();
+    REQUIRE(index.lookup("x").size() == 1);
+
+    std::filesystem::remove(source);
+    index.commit();
+
+    CHECK(index.lookup("x").empty());
+    CHECK(std::filesystem::is_empty(temp / "index" / "shards"));
+  }
+
+  std::filesystem::remove_all(temp);
+}
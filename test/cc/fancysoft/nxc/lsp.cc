@@ -0,0 +1,251 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+
+#include "fancysoft/nxc/lsp.hh"
+#include "fancysoft/util/logger.hh"
+
+using namespace Fancysoft;
+using namespace Fancysoft::NXC;
+
+Util::Logger Util::logger(Util::Logger::Verbosity::Fatal, std::cerr);
+
+/// Opened once the server has read all of its input.
+struct Gate {
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool open = false;
+
+  void release() {
+    std::lock_guard lock(mutex);
+    open = true;
+    condition.notify_all();
+  }
+
+  void wait() {
+    std::unique_lock lock(mutex);
+    condition.wait(lock, [this]() { return open; });
+  }
+};
+
+/// An input opening the gate upon its end.
+struct GatedInput : std::stringbuf {
+  Gate &gate;
+
+  GatedInput(std::string input, Gate &gate) :
+      std::stringbuf(input, std::ios::in), gate(gate) {}
+
+  int_type underflow() override {
+    auto ch = std::stringbuf::underflow();
+
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+      gate.release();
+
+    return ch;
+  }
+};
+
+/// An output blocking until the gate is open, so that all the messages are
+/// queued before the first one is responded to; thus the skipping of the
+/// outdated messages is deterministic.
+struct GatedOutput : std::stringbuf {
+  Gate &gate;
+
+  GatedOutput(Gate &gate) : std::stringbuf(std::ios::out), gate(gate) {}
+
+  std::streamsize xsputn(const char *data, std::streamsize size) override {
+    gate.wait();
+    return std::stringbuf::xsputn(data, size);
+  }
+
+  int_type overflow(int_type ch) override {
+    gate.wait();
+    return std::stringbuf::overflow(ch);
+  }
+};
+
+static std::string frame(llvm::json::Value message) {
+  auto content = llvm::formatv("{0}", message).str();
+  return "Content-Length: " + std::to_string(content.size()) + "\r\n\r\n" +
+         content;
+}
+
+static std::string
+request(int64_t id, std::string method, llvm::json::Object params = {}) {
+  return frame(llvm::json::Object{
+      {"jsonrpc", "2.0"},
+      {"id", id},
+      {"method", method},
+      {"params", std::move(params)}});
+}
+
+static std::string
+notification(std::string method, llvm::json::Object params) {
+  return frame(llvm::json::Object{
+      {"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}});
+}
+
+/// Parse the framed *output* messages.
+static std::vector<llvm::json::Object>
+messages_of(const std::string &output) {
+  std::vector<llvm::json::Object> messages;
+  const std::string header = "Content-Length: ";
+  size_t offset = 0;
+
+  while ((offset = output.find(header, offset)) != output.npos) {
+    offset += header.size();
+    auto size = std::stoul(output.substr(offset));
+    offset = output.find("\r\n\r\n", offset) + 4;
+
+    auto parsed = llvm::json::parse(output.substr(offset, size));
+
+    if (!parsed) {
+      llvm::consumeError(parsed.takeError());
+      break;
+    }
+
+    if (auto object = parsed->getAsObject())
+      messages.push_back(std::move(*object));
+
+    offset += size;
+  }
+
+  return messages;
+}
+
+/// The integer at *key* of *object*, or -1 if missing.
+static int64_t integer_of(const llvm::json::Object *object, std::string key) {
+  if (!object)
+    return -1;
+
+  return object->getInteger(key).getValueOr(-1);
+}
+
+static std::string uri = "file:///tmp/fnxc-test-lsp/main.nx";
+
+static llvm::json::Object change(int64_t version, std::string text) {
+  return llvm::json::Object{
+      {"textDocument", llvm::json::Object{{"uri", uri}, {"version", version}}},
+      {"contentChanges",
+       llvm::json::Array{llvm::json::Object{{"text", std::move(text)}}}}};
+}
+
+TEST_CASE("LSP::Server") {
+  SUBCASE("reads the framed messages until a malformed one") {
+    std::stringstream input, output;
+
+    // Any other header, and a bare line feed, are accepted.
+    auto initialize = request(1, "initialize");
+    initialize.insert(
+        initialize.find("\r\n") + 2, "Content-Type: application/json\n");
+
+    input << initialize << "Content-Length: 1099511627776\r\n\r\n{}";
+
+    LSP::Server server(input, output);
+
+    // The client is gone without the `exit` notification.
+    CHECK(server.run() == 1);
+
+    auto messages = messages_of(output.str());
+    REQUIRE(messages.size() == 1);
+    CHECK(integer_of(&messages[0], "id") == 1);
+    CHECK(messages[0].getObject("result"));
+  }
+
+  SUBCASE("skips the outdated and cancelled messages") {
+    std::string input;
+
+    input += request(1, "initialize");
+
+    // The panic column is 19 code points, but 20 UTF-16 code units.
+    input += notification(
+        "textDocument/didOpen",
+        llvm::json::Object{
+            {"textDocument",
+             llvm::json::Object{
+                 {"uri", uri},
+                 {"version", 1},
+                 {"text", "unsafe! $puts($\"\xf0\x9f\x98\x80\")#\n"}}}});
+
+    // A stale edit, and a request issued before a newer edit.
+    input += notification("textDocument/didChange", change(2, "let a = )\n"));
+    input += request(
+        2,
+        "textDocument/hover",
+        llvm::json::Object{
+            {"textDocument", llvm::json::Object{{"uri", uri}}},
+            {"position", llvm::json::Object{{"line", 0}, {"character", 0}}}});
+    input += notification("textDocument/didChange", change(3, ""));
+
+    input += notification("$/cancelRequest", llvm::json::Object{{"id", 3}});
+    input += request(3, "fnxc/stats");
+    input += request(4, "fnxc/stats");
+    input += request(5, "shutdown");
+    input += notification("exit", {});
+
+    Gate gate;
+    GatedInput input_buffer(input, gate);
+    GatedOutput output_buffer(gate);
+    std::istream input_stream(&input_buffer);
+    std::ostream output_stream(&output_buffer);
+
+    LSP::Server server(input_stream, output_stream);
+    CHECK(server.run() == 0);
+
+    auto messages = messages_of(output_buffer.str());
+    REQUIRE(messages.size() == 7);
+
+    CHECK(integer_of(&messages[0], "id") == 1);
+
+    // The diagnostics of the opened document.
+    CHECK(
+        messages[1].getString("method") ==
+        llvm::StringRef("textDocument/publishDiagnostics"));
+
+    auto params = messages[1].getObject("params");
+    REQUIRE(params);
+    CHECK(integer_of(params, "version") == 1);
+
+    auto diagnostics = params->getArray("diagnostics");
+    REQUIRE(diagnostics);
+    REQUIRE(diagnostics->size() == 1);
+
+    auto range = (*diagnostics)[0].getAsObject()->getObject("range");
+    REQUIRE(range);
+    CHECK(integer_of(range->getObject("start"), "character") == 20);
+    CHECK(integer_of(range->getObject("end"), "character") == 21);
+
+    // The hover has been outdated by the newer edit.
+    CHECK(integer_of(&messages[2], "id") == 2);
+    REQUIRE(messages[2].getObject("error"));
+    CHECK(integer_of(messages[2].getObject("error"), "code") == -32801);
+
+    // The stale edit of version 2 is skipped.
+    params = messages[3].getObject("params");
+    REQUIRE(params);
+    CHECK(integer_of(params, "version") == 3);
+    CHECK(params->getArray("diagnostics")->empty());
+
+    CHECK(integer_of(&messages[4], "id") == 3);
+    REQUIRE(messages[4].getObject("error"));
+    CHECK(integer_of(messages[4].getObject("error"), "code") == -32800);
+
+    // Only the applied edit's latency is recorded.
+    CHECK(integer_of(&messages[5], "id") == 4);
+    auto stats = messages[5].getObject("result");
+    REQUIRE(stats);
+    CHECK(integer_of(stats, "edits") == 1);
+    CHECK(integer_of(stats, "skipped_edits") == 1);
+
+    CHECK(integer_of(&messages[6], "id") == 5);
+  }
+}
@@ -0,0 +1,151 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fancysoft/nxc/exception.hh"
+#include "fancysoft/nxc/onyx/file.hh"
+#include "fancysoft/nxc/program.hh"
+#include "fancysoft/nxc/workspace.hh"
+#include "fancysoft/util/logger.hh"
+
+using namespace Fancysoft;
+using namespace Fancysoft::NXC;
+
+Util::Logger Util::logger(Util::Logger::Verbosity::Fatal, std::cerr);
+
+/// Return a program for the in-memory *source* of the entry module at
+/// *entry_path*, which needs not to exist.
+static std::shared_ptr<Program> program_of(
+    std::filesystem::path entry_path,
+    std::string source,
+    std::shared_ptr<Workspace> workspace = std::make_shared<Workspace>(),
+    unsigned opt_level = 0) {
+  Program::CompilationContext context;
+  context.opt_level = opt_level;
+  context.target.triple = Target::default_triple();
+  context.target.object_file_format =
+      Target::object_file_format_of(context.target.triple);
+  context.entry_path = entry_path;
+
+  auto program = std::make_shared<Program>(context, workspace);
+  program->set_source(entry_path, std::move(source));
+
+  return program;
+}
+
+TEST_CASE("Program") {
+  SUBCASE("fails to compile upon a lexer error") {
+    auto program =
+        program_of("main.nx", "unsafe! $puts($\"hi\")#\nlet y = x\n");
+
+    CHECK_THROWS_AS(program->compile_mlir(), Panics);
+
+    auto &panics = program->module("main.nx")->panics();
+    REQUIRE(panics.size() == 1);
+    CHECK(std::string(panics[0].what()) == "Unexpected input");
+  }
+
+  SUBCASE("reports all the syntax errors at once") {
+    auto program = program_of("main.nx", "let a = )\nlet = y\nlet c = z\n");
+
+    try {
+      program->compile_mlir();
+      FAIL("Shall throw");
+    } catch (Panics &panics) {
+      CHECK(panics.panics.size() == 2);
+    }
+  }
+
+  SUBCASE("caches the objects of an absolute path per settings") {
+    auto temp = std::filesystem::temp_directory_path() / "fnxc-test-program";
+    auto entry_path = temp / "src" / "main.nx";
+
+    auto workspace = std::make_shared<Workspace>();
+    workspace->cache_dir = temp / "cache";
+
+    auto debug = program_of(entry_path, "", workspace, 0);
+    auto release = program_of(entry_path, "", workspace, 2);
+
+    auto path = debug->obj_path(entry_path).lexically_normal();
+    auto relative = path.lexically_relative(*workspace->cache_dir);
+
+    // Within the cache rather than next to the source.
+    REQUIRE(!relative.empty());
+    CHECK(*relative.begin() == "obj");
+    CHECK(path.filename() == "main.o");
+
+    CHECK(path != release->obj_path(entry_path).lexically_normal());
+
+    std::filesystem::remove_all(temp);
+  }
+
+  SUBCASE("compiles the imported modules first") {
+    auto program = program_of("main.nx", "import \"lib.nx\"\n");
+    program->set_source("lib.nx", "let x = )\n");
+
+    CHECK_THROWS_AS(program->compile_mlir(), Panics);
+
+    auto main = program->module("main.nx");
+    REQUIRE(
+        main->dependencies() == std::vector<std::filesystem::path>{"lib.nx"});
+
+    // The importing module awaits the one failed, which itself is compiled
+    // on the best-effort basis.
+    CHECK(!program->module("lib.nx")->panics().empty());
+    CHECK(!main->compiled());
+
+    program->set_source("lib.nx", "");
+    program->compile_mlir();
+
+    CHECK(program->module("lib.nx")->compiled());
+    CHECK(main->compiled());
+  }
+
+  SUBCASE("prunes the modules not imported anymore") {
+    auto program = program_of("main.nx", "import \"lib.nx\"\n");
+    program->set_source("lib.nx", "");
+    program->compile_mlir();
+
+    REQUIRE(program->module("lib.nx"));
+
+    program->set_source("main.nx", "");
+    program->compile_mlir();
+
+    CHECK(!program->module("lib.nx"));
+    CHECK(program->modules().size() == 1);
+  }
+
+  SUBCASE("fails upon cyclic imports") {
+    auto program = program_of("main.nx", "import \"lib.nx\"\n");
+    program->set_source("lib.nx", "import \"main.nx\"\n");
+
+    CHECK_THROWS_AS(program->compile_mlir(), std::string);
+  }
+
+  SUBCASE("discovers the imported files") {
+    auto temp = std::filesystem::temp_directory_path() / "fnxc-test-import";
+    std::filesystem::create_directories(temp / "lib");
+    std::ofstream(temp / "lib" / "foo.nx") << "\n";
+
+    auto program = program_of(temp / "main.nx", "import \"./lib/foo.nx\"\n");
+
+    program->compile_mlir();
+
+    auto foo = program->module(temp / "lib" / "foo.nx");
+    REQUIRE(foo);
+    CHECK(foo->compiled());
+
+    std::filesystem::remove(temp / "lib" / "foo.nx");
+    auto missing = program_of(temp / "main.nx", "import \"./lib/foo.nx\"\n");
+
+    CHECK_THROWS_AS(missing->compile_mlir(), Panic);
+
+    std::filesystem::remove_all(temp);
+  }
+}
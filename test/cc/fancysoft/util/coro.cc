@@ -1,11 +1,13 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include <vector>
+
 #include "fancysoft/util/coro.hh"
 
 using namespace Fancysoft::Util;
 
-Coro::generator<int> _generator() {
+Coro::Generator<int> _generator() {
   co_yield(42);
   co_yield(43);
 }
@@ -24,9 +26,8 @@ TEST_CASE("straightforward generator") {
   CHECK(gen.current() == 43);
   CHECK(!gen.done());
 
-  output = gen.next();
-  CHECK(output == 43);
-  CHECK(gen.current() == 43);
+  // The last value is not referenced once done.
+  gen.resume();
   CHECK(gen.done());
 
   int i = 0;
@@ -48,7 +49,7 @@ int sync_switch = 0;
 
 // NOTE: `sync` clashes with `unistd.h`
 // on POSIX platforms.
-Coro::sync<int> _sync() {
+Coro::Sync<int> _sync() {
   co_return(42);
   sync_switch = 1;
 }
@@ -62,7 +63,7 @@ TEST_CASE("straightforward sync") {
 
 int async_switch = 0;
 
-Coro::async<int> _async() {
+Coro::Async<int> _async() {
   co_return(42);
   async_switch = 1;
 }
@@ -74,12 +75,12 @@ TEST_CASE("straightforward async") {
   CHECK(async_switch == 0);
 }
 
-Coro::generator<int> _recursive_generator() {
+Coro::Generator<int> _recursive_generator() {
   co_yield(100);
   co_yield(101);
 }
 
-Coro::generator<int> _complex_generator() {
+Coro::Generator<int> _complex_generator() {
   auto rec = _recursive_generator();
   co_yield(1);
   co_yield co_await(_async());
@@ -88,7 +89,6 @@ Coro::generator<int> _complex_generator() {
   co_yield rec.next();
   co_yield co_await(_async());
   co_yield(3);
-  co_yield rec.next();
 }
 
 TEST_CASE("complex generator") {
@@ -100,8 +100,70 @@ TEST_CASE("complex generator") {
   CHECK(gen.next() == 101);
   CHECK(gen.next() == 42);
   CHECK(gen.next() == 3);
-  CHECK(gen.next() == 101);
   CHECK(!gen.done());
-  CHECK(gen.next() == 101);
+  gen.resume();
   CHECK(gen.done());
 }
+
+struct Counted {
+  static inline int copies = 0;
+
+  int value;
+
+  Counted(int value) : value(value) {}
+  Counted(const Counted &other) : value(other.value) { copies++; }
+  Counted(Counted &&other) = default;
+};
+
+Coro::Generator<Counted> _counted_generator() {
+  co_yield Counted(1); // Referenced
+
+  Counted lvalue(2);
+  co_yield lvalue; // Copied
+  CHECK(lvalue.value == 2);
+}
+
+TEST_CASE("generator yields without copying") {
+  Counted::copies = 0;
+  std::vector<Counted> values;
+
+  for (auto &&value : _counted_generator())
+    values.push_back(std::move(value));
+
+  REQUIRE(values.size() == 2);
+  CHECK(values[0].value == 1);
+  CHECK(values[1].value == 2);
+  CHECK(Counted::copies == 1);
+}
+
+Coro::Generator<const int &> _reference_generator(const std::vector<int> &v) {
+  for (auto &value : v)
+    co_yield value;
+}
+
+TEST_CASE("generator of references") {
+  std::vector<int> values = {1, 2};
+  auto gen = _reference_generator(values);
+
+  CHECK(&gen.next() == &values[0]);
+  CHECK(&gen.next() == &values[1]);
+
+  // Move-only.
+  auto other = std::move(gen);
+  other.resume();
+  CHECK(other.done());
+}
+
+TEST_CASE("generator frames are recycled") {
+  // Warm up the cache.
+  _generator();
+  auto cached = Coro::FrameAllocator::cached();
+  REQUIRE(cached > 0);
+
+  {
+    auto gen = _generator();
+    CHECK(Coro::FrameAllocator::cached() == cached - 1);
+  }
+
+  CHECK(Coro::FrameAllocator::cached() == cached);
+}
@@ -0,0 +1,143 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "fancysoft/util/executor.hh"
+
+using namespace Fancysoft::Util::Coro;
+
+namespace {
+
+Task<int> square(Executor &executor, int value) {
+  co_await executor.schedule();
+  co_return value * value;
+}
+
+Task<int> sum_of_squares(Executor &executor, int count) {
+  std::vector<Task<int>> tasks;
+
+  for (int i = 0; i < count; i++)
+    tasks.push_back(square(executor, i));
+
+  int sum = 0;
+
+  for (auto value : co_await when_all(std::move(tasks)))
+    sum += value;
+
+  co_return sum;
+}
+
+Task<int> fail(Executor &executor) {
+  co_await executor.schedule();
+  throw std::runtime_error("x");
+}
+
+Task<> await_event(Executor &executor, Event &event, std::atomic<int> &count) {
+  co_await executor.schedule();
+  co_await event;
+  count++;
+}
+
+Task<> set_event(Executor &executor, Event &event) {
+  co_await executor.schedule();
+  event.set();
+}
+
+/// Awaits itself with a chain of tasks, which would overflow the stack
+/// unless transferred symmetrically.
+Task<int> chain(int depth) {
+  if (!depth)
+    co_return 0;
+
+  co_return co_await chain(depth - 1) + 1;
+}
+
+Task<std::thread::id> thread_id(Executor &executor) {
+  co_await executor.schedule();
+
+  // Busy enough for the other workers to steal the remaining tasks.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  co_return std::this_thread::get_id();
+}
+
+} // namespace
+
+TEST_CASE("Executor") {
+  Executor executor(4);
+  REQUIRE(executor.size() == 4);
+
+  SUBCASE("awaits all tasks") {
+    CHECK(executor.block_on(sum_of_squares(executor, 100)) == 328350);
+  }
+
+  SUBCASE("rethrows") {
+    std::vector<Task<int>> tasks;
+    tasks.push_back(square(executor, 2));
+    tasks.push_back(fail(executor));
+
+    CHECK_THROWS_AS(
+        executor.block_on(when_all(std::move(tasks))), std::runtime_error);
+  }
+
+  SUBCASE("resumes event waiters") {
+    Event event(executor);
+    std::atomic<int> count = 0;
+    std::vector<Task<>> tasks;
+
+    for (int i = 0; i < 10; i++)
+      tasks.push_back(await_event(executor, event, count));
+
+    tasks.push_back(set_event(executor, event));
+    executor.block_on(when_all(std::move(tasks)));
+
+    CHECK(event.is_set());
+    CHECK(count == 10);
+  }
+
+  SUBCASE("detects deadlocks") {
+    Event event(executor);
+    std::atomic<int> count = 0;
+
+    CHECK_THROWS_AS(
+        executor.block_on(await_event(executor, event, count)),
+        Executor::Deadlock);
+  }
+
+  SUBCASE("transfers symmetrically") {
+    CHECK(executor.block_on(chain(10000)) == 10000);
+  }
+
+  SUBCASE("steals work") {
+    std::vector<Task<std::thread::id>> tasks;
+
+    for (int i = 0; i < 32; i++)
+      tasks.push_back(thread_id(executor));
+
+    auto ids = executor.block_on(when_all(std::move(tasks)));
+    CHECK(std::set<std::thread::id>(ids.begin(), ids.end()).size() > 1);
+  }
+}
+
+TEST_CASE("Executor::shared") {
+  auto &executor = Executor::shared();
+  REQUIRE(&executor == &Executor::shared());
+
+  // Blocked on by multiple threads at once.
+  std::vector<std::thread> threads;
+  std::atomic<int> sum = 0;
+
+  for (int i = 0; i < 4; i++)
+    threads.emplace_back([&executor, &sum]() {
+      sum += executor.block_on(sum_of_squares(executor, 100));
+    });
+
+  for (auto &thread : threads)
+    thread.join();
+
+  CHECK(sum == 4 * 328350);
+}
@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fancysoft/util/logger.hh"
+
+using namespace Fancysoft::Util;
+
+static std::vector<std::string> lines_of(const std::string &string) {
+  std::vector<std::string> lines;
+  std::istringstream stream(string);
+
+  for (std::string line; std::getline(stream, line);)
+    lines.push_back(line);
+
+  return lines;
+}
+
+TEST_CASE("Logger") {
+  std::ostringstream output;
+  Logger logger(Logger::Verbosity::Debug, output);
+  logger.enable_time_output = false;
+  logger.enable_thread_id_output = false;
+
+  SUBCASE("filters by verbosity") {
+    logger.trace("Test") << "hidden\n";
+    logger.debug("Test") << "shown " << 42 << "\n";
+    logger.info({"A", "B"}) << "nested\n";
+
+    auto lines = lines_of(output.str());
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[0] == "[D][Test] shown 42");
+    CHECK(lines[1] == "[I][A/B] nested");
+  }
+
+  SUBCASE("does not interleave messages of threads") {
+    output.str("");
+
+    // A small buffer makes the producers wait for the writer.
+    logger.start_async(256);
+
+    const int threads_count = 4, messages_count = 1000;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < threads_count; t++)
+      threads.emplace_back([&logger, t]() {
+        for (int i = 0; i < messages_count; i++)
+          logger.info("Test") << "thread " << t << " message " << i << "\n";
+
+        // Larger than the ring, thus written synchronously.
+        logger.info("Test") << "thread " << t << ' ' << std::string(300, 'x')
+                            << "\n";
+      });
+
+    for (auto &thread : threads)
+      thread.join();
+
+    logger.stop_async();
+
+    auto lines = lines_of(output.str());
+    REQUIRE(lines.size() == threads_count * (messages_count + 1));
+
+    std::vector<int> next(threads_count, 0);
+
+    for (auto &line : lines) {
+      int t, i;
+
+      if (sscanf(line.c_str(), "[I][Test] thread %d message %d", &t, &i) == 2) {
+        // Messages of a single thread are written in order.
+        CHECK(i == next[t]++);
+      } else {
+        REQUIRE(sscanf(line.c_str(), "[I][Test] thread %d", &t) == 1);
+        CHECK(line.size() == std::string("[I][Test] thread 0 ").size() + 300);
+      }
+    }
+
+    for (auto n : next)
+      CHECK(n == messages_count);
+  }
+
+  SUBCASE("writes an error synchronously after the pending messages") {
+    output.str("");
+    logger.start_async();
+
+    logger.info("Test") << "pending\n";
+    logger.error("Test") << "failed\n";
+
+    // Already written, thus ordered against the direct output, e.g. a panic.
+    auto lines = lines_of(output.str());
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[0] == "[I][Test] pending");
+    CHECK(lines[1] == "[E][Test] failed");
+
+    logger.stop_async();
+  }
+
+  SUBCASE("flushes the pending messages") {
+    output.str("");
+    logger.start_async();
+
+    logger.info("Test") << "pending\n";
+    logger.flush();
+
+    CHECK(output.str() == "[I][Test] pending\n");
+    logger.stop_async();
+  }
+}
@@ -0,0 +1,73 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "fancysoft/util/memory_account.hh"
+
+using namespace Fancysoft::Util;
+
+TEST_CASE("MemoryAccount") {
+  SUBCASE("does not account when disabled") {
+    MemoryAccount account;
+
+    {
+      MemoryAccount::Scope scope(account);
+      auto buffer = std::make_unique<char[]>(1024);
+    }
+
+    CHECK(account.stats().allocations == 0);
+  }
+
+  SUBCASE("accounts allocations to the innermost scope") {
+    MemoryAccount::enable();
+    MemoryAccount outer, inner;
+    auto thread_before = MemoryAccount::thread_stats();
+
+    std::unique_ptr<char[]> kept;
+
+    {
+      MemoryAccount::Scope outer_scope(outer);
+      kept = std::make_unique<char[]>(4096);
+
+      {
+        MemoryAccount::Scope inner_scope(inner);
+        std::vector<char> temporary(1024);
+      }
+    }
+
+    auto thread_delta = MemoryAccount::thread_stats() - thread_before;
+    CHECK(thread_delta.allocations == 2);
+    CHECK(thread_delta.live_bytes >= 4096);
+
+    CHECK(outer.stats().allocations == 1);
+    CHECK(outer.stats().live_bytes >= 4096);
+
+    CHECK(inner.stats().allocations == 1);
+    CHECK(inner.stats().allocated_bytes >= 1024);
+    CHECK(inner.stats().live_bytes == 0);
+    CHECK(inner.stats().peak_bytes >= 1024);
+
+    {
+      MemoryAccount::Scope scope(outer);
+      kept.reset();
+    }
+
+    CHECK(outer.stats().live_bytes == 0);
+
+    // Another thread's allocations are not accounted to this thread's scope.
+    {
+      MemoryAccount::Scope scope(inner);
+      std::thread([]() { std::vector<char> other(1024); }).join();
+    }
+
+    CHECK(inner.stats().allocations <= 2);
+    MemoryAccount::disable();
+  }
+
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+  CHECK(MemoryAccount::peak_rss() > 0);
+#endif
+}
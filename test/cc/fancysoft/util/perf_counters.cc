@@ -0,0 +1,33 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "fancysoft/util/perf_counters.hh"
+
+using namespace Fancysoft::Util;
+
+TEST_CASE("PerfCounters") {
+  PerfCounters counters;
+
+  // The counters may be unavailable, e.g. in a container.
+  if (!counters.available()) {
+    CHECK(counters.error().has_value());
+    CHECK(counters.read()[PerfCounters::Instructions] == 0);
+    return;
+  }
+
+  auto before = counters.read();
+
+  volatile uint64_t sum = 0;
+  for (int i = 0; i < 1000000; i++)
+    sum = sum + i;
+
+  auto delta = counters.read() - before;
+
+  if (counters.has(PerfCounters::Instructions))
+    CHECK(delta[PerfCounters::Instructions] > 1000000);
+
+  PerfCounters::Values total;
+  total += delta;
+  total += delta;
+  CHECK(total[PerfCounters::Cycles] == 2 * delta[PerfCounters::Cycles]);
+}
@@ -1,9 +1,12 @@
+#include <atomic>
 #include <chrono>
+#include <thread>
+#include <vector>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
-#include "../../../src/cc/src/fancysoft/util/pool.cc"
+#include "fancysoft/util/pool.hh"
 
 using namespace Fancysoft::Util;
 
@@ -55,3 +58,70 @@ TEST_SUITE("pool") {
     CHECK_MESSAGE(dummy4 == nullptr, "should return NULL upon timeout");
   }
 }
+
+TEST_CASE("Pool::lease") {
+  Pool<Dummy> pool([] { return std::make_unique<Dummy>(Dummy{7}); }, 1);
+
+  {
+    auto lease = pool.lease();
+    CHECK(lease->value == 7);
+    lease->value = 8;
+    CHECK(pool.acquire(std::chrono::milliseconds(1)) == nullptr);
+  }
+
+  CHECK(pool.acquire()->value == 8);
+}
+
+TEST_CASE("Pool under contention") {
+  const int size = 2, threads_count = 8, iterations = 10000;
+  std::atomic<int> in_use = 0, max_in_use = 0;
+
+  Pool<Dummy> pool([] { return Dummy(); }, size);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < threads_count; t++)
+    threads.emplace_back([&]() {
+      for (int i = 0; i < iterations; i++) {
+        auto dummy = pool.acquire();
+        REQUIRE(dummy);
+
+        auto current = ++in_use;
+        auto max = max_in_use.load();
+
+        while (current > max && !max_in_use.compare_exchange_weak(max, current))
+          ;
+
+        dummy->value++;
+        in_use--;
+        pool.release(move(dummy));
+      }
+    });
+
+  for (auto &thread : threads)
+    thread.join();
+
+  CHECK(max_in_use <= size);
+
+  // No object is lost.
+  auto a = pool.acquire(), b = pool.acquire();
+  CHECK(a->value + b->value == threads_count * iterations);
+}
+
+TEST_CASE("Pool::stats") {
+  Pool<Dummy> pool([] { return Dummy(); }, 2);
+
+  auto a = pool.acquire(), b = pool.acquire();
+  CHECK(pool.acquire(std::chrono::milliseconds(1)) == nullptr);
+
+  pool.release(move(a));
+  a = pool.acquire();
+
+  auto stats = pool.stats();
+  CHECK(stats.creations == 2);
+  CHECK(stats.hits == 1);
+  CHECK(stats.waits == 1);
+  CHECK(stats.timeouts == 1);
+  CHECK(stats.wait_time >= std::chrono::milliseconds(1));
+  CHECK(stats.size == 2);
+  CHECK(stats.max_size == 2);
+}
@@ -0,0 +1,53 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <sstream>
+#include <string>
+
+#include "fancysoft/util/tar.hh"
+
+using namespace Fancysoft::Util;
+
+TEST_CASE("Tar::Writer") {
+  std::ostringstream out;
+
+  {
+    Tar::Writer tar(out);
+    tar.add("foo.ll", "Hello");
+    tar.add(std::string(120, 'a') + "/bar.ll", std::string(512, 'b'));
+  }
+
+  auto archive = out.str();
+
+  // Header, a padded member, header, an exact member, two zero blocks.
+  REQUIRE(archive.size() == 512 * 6);
+
+  CHECK(archive.substr(0, 7) == std::string("foo.ll\0", 7));
+  CHECK(archive.substr(124, 12) == std::string("00000000005\0", 12));
+  CHECK(archive.substr(257, 8) == std::string("ustar\0" "00", 8));
+  CHECK(archive.substr(512, 5) == "Hello");
+  CHECK(archive[517] == '\0');
+
+  // The long path is split into the prefix and the name.
+  CHECK(archive.substr(1024, 7) == std::string("bar.ll\0", 7));
+  CHECK(archive.substr(1024 + 345, 120) == std::string(120, 'a'));
+  CHECK(archive.substr(1536, 512) == std::string(512, 'b'));
+  CHECK(archive.substr(2048) == std::string(1024, '\0'));
+
+  // Verify the checksum of the first header.
+  unsigned checksum = 0;
+  for (size_t i = 0; i < 512; i++)
+    checksum += (i >= 148 && i < 156) ? ' ' : (unsigned char)archive[i];
+
+  CHECK(std::stoul(archive.substr(148, 6), nullptr, 8) == checksum);
+}
+
+TEST_CASE("Tar::Writer errors") {
+  std::ostringstream out;
+  Tar::Writer tar(out);
+
+  CHECK_THROWS_AS(tar.add(std::string(101, 'a'), ""), Tar::Error);
+
+  tar.finish();
+  CHECK_THROWS_AS(tar.add("foo", ""), Tar::Error);
+}
@@ -0,0 +1,40 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "fancysoft/util/thread_pool.hh"
+
+using namespace Fancysoft::Util;
+
+TEST_CASE("ThreadPool") {
+  ThreadPool pool(4);
+  REQUIRE(pool.size() == 4);
+
+  SUBCASE("returns results") {
+    std::vector<std::future<int>> futures;
+
+    for (int i = 0; i < 100; i++)
+      futures.push_back(pool.submit([i]() { return i * 2; }));
+
+    for (int i = 0; i < 100; i++)
+      CHECK(futures[i].get() == i * 2);
+  }
+
+  SUBCASE("propagates exceptions") {
+    auto future = pool.submit([]() -> int { throw std::runtime_error("x"); });
+    CHECK_THROWS_AS(future.get(), std::runtime_error);
+  }
+
+  SUBCASE("waits for all tasks") {
+    std::atomic<int> counter = 0;
+
+    for (int i = 0; i < 1000; i++)
+      pool.submit([&counter]() { counter++; });
+
+    pool.wait();
+    CHECK(counter == 1000);
+  }
+}
@@ -0,0 +1,147 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fancysoft/util/time_trace.hh"
+
+using namespace Fancysoft::Util;
+
+TEST_CASE("TimeTrace") {
+  TimeTrace trace;
+
+  SUBCASE("is no-op when disabled") {
+    bool evaluated = false;
+
+    {
+      TimeTrace::Scope scope(
+          "Parse", [&]() { return evaluated = true, "foo"; }, &trace);
+    }
+
+    std::ostringstream summary;
+    trace.write_summary(summary);
+
+    CHECK(!evaluated);
+    CHECK(summary.str().find("Parse") == std::string::npos);
+  }
+
+  SUBCASE("records events per thread") {
+    trace.enable();
+
+    { TimeTrace::Scope scope("Parse", "foo.nx", &trace); }
+
+    std::thread thread([&trace]() {
+      TimeTrace::Scope outer("Compile", [] { return "bar.nx"; }, &trace);
+      TimeTrace::Scope inner("Parse", "bar\"baz\".nx", &trace);
+    });
+
+    thread.join();
+
+    std::ostringstream json;
+    trace.write(json);
+    auto string = json.str();
+
+    CHECK(string.rfind("{\"traceEvents\":[", 0) == 0);
+    CHECK(string.find("\"name\":\"Parse\"") != std::string::npos);
+    CHECK(string.find("\"detail\":\"foo.nx\"") != std::string::npos);
+    CHECK(string.find("\"detail\":\"bar\\\"baz\\\".nx\"") != std::string::npos);
+    CHECK(string.find("\"tid\":1") != std::string::npos);
+
+    std::ostringstream summary;
+    trace.write_summary(summary);
+
+    std::istringstream lines(summary.str());
+    std::string header, first, second;
+    std::getline(lines, header);
+    std::getline(lines, first);
+    std::getline(lines, second);
+
+    CHECK(header.rfind("Name", 0) == 0);
+    CHECK(summary.str().find("Compile") != std::string::npos);
+
+    // Both parse events are aggregated.
+    auto parse = first.rfind("Parse", 0) == 0 ? first : second;
+    std::istringstream parse_stream(parse);
+    std::string name;
+    size_t count;
+    parse_stream >> name >> count;
+    CHECK(count == 2);
+
+    trace.clear();
+    std::ostringstream cleared;
+    trace.write_summary(cleared);
+    CHECK(cleared.str().find("Parse") == std::string::npos);
+  }
+
+  SUBCASE("records performance counters") {
+    trace.enable(true);
+
+    { TimeTrace::Scope scope("Parse", "foo.nx", &trace); }
+
+    trace.disable();
+
+    std::ostringstream summary;
+    trace.write_summary(summary);
+
+    // The counters may be unavailable, e.g. in a container.
+    if (trace.counters_error())
+      CHECK(summary.str().find("cycles") == std::string::npos);
+    else {
+      CHECK(summary.str().find("instructions") != std::string::npos);
+
+      std::ostringstream json;
+      trace.write(json);
+      CHECK(json.str().find("\"instructions\":") != std::string::npos);
+    }
+  }
+
+  SUBCASE("records allocations") {
+    trace.clear();
+    trace.enable(false, true);
+
+    {
+      TimeTrace::Scope scope("Parse", "foo.nx", &trace);
+      std::vector<char> buffer(1024);
+    }
+
+    trace.disable();
+    MemoryAccount::disable();
+
+    std::ostringstream json;
+    trace.write_summary_json(json);
+
+    CHECK(json.str().rfind("[{\"name\":\"Parse\",\"count\":1,", 0) == 0);
+    CHECK(json.str().find("\"allocations\":1,") != std::string::npos);
+    CHECK(json.str().find("\"process_peak_rss\":0") == std::string::npos);
+  }
+
+  SUBCASE("prunes the exited threads upon clearing") {
+    trace.enable(true);
+
+    std::thread thread(
+        [&trace]() { TimeTrace::Scope scope("Parse", "", &trace); });
+    thread.join();
+
+    auto threads_count = [&trace]() {
+      std::ostringstream json;
+      trace.write(json);
+      auto string = json.str();
+      size_t count = 0;
+
+      for (auto i = string.find("thread_name"); i != std::string::npos;
+           i = string.find("thread_name", i + 1))
+        count++;
+
+      return count;
+    };
+
+    auto count = threads_count();
+    REQUIRE(count > 0);
+
+    trace.clear();
+    CHECK(threads_count() == count - 1);
+  }
+}
@@ -0,0 +1,119 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fancysoft/util/trace_log.hh"
+
+using namespace Fancysoft::Util;
+
+TEST_CASE("TraceLog") {
+  auto path = std::filesystem::temp_directory_path() / "fnxc-trace-log.trace";
+  TraceLog log;
+
+  // Interned before opening, thus written upon opening.
+  auto context = log.intern("MLIR/_Scope");
+  CHECK(log.intern("MLIR/_Scope") == context);
+
+  log.record(context, context, 1); // Disabled
+  log.open(path);
+  REQUIRE(log.enabled());
+
+  auto name = log.intern("compile_var_decl");
+  log.record(context, name, 'x', -42, 42u, 0.5, "foo");
+
+  // Enough to write multiple blocks per thread.
+  const int threads_count = 4, events_count = 10000;
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < threads_count; t++)
+    threads.emplace_back([&log, t]() {
+      auto read = log.intern("read");
+
+      for (int i = 0; i < events_count; i++)
+        log.record(read, read, t, i);
+    });
+
+  for (auto &thread : threads)
+    thread.join();
+
+  // Too long a string is truncated.
+  log.record(context, name, std::string(1000, 'a'));
+  log.close();
+  REQUIRE(!log.enabled());
+
+  std::ifstream file(path, std::ios::binary);
+
+  // The event strings are only valid within the callback.
+  struct Event {
+    std::string context, name;
+    std::vector<TraceLog::Value> args;
+  };
+
+  std::vector<Event> events;
+
+  TraceLog::read(file, [&events](auto &e) {
+    events.push_back({std::string(e.context), std::string(e.name), e.args});
+  });
+
+  REQUIRE(events.size() == 2 + threads_count * events_count);
+
+  // The blocks of the threads are written in an arbitrary order.
+  std::vector<Event> main_events;
+
+  for (auto &event : events)
+    if (event.name == "compile_var_decl")
+      main_events.push_back(event);
+
+  REQUIRE(main_events.size() == 2);
+
+  auto &first = main_events.front();
+  CHECK(first.context == "MLIR/_Scope");
+  REQUIRE(first.args.size() == 5);
+  CHECK(std::get<char>(first.args[0]) == 'x');
+  CHECK(std::get<int64_t>(first.args[1]) == -42);
+  CHECK(std::get<uint64_t>(first.args[2]) == 42);
+  CHECK(std::get<double>(first.args[3]) == 0.5);
+  CHECK(std::get<std::string>(first.args[4]) == "foo");
+
+  auto &last = main_events.back();
+  REQUIRE(last.args.size() == 1);
+  CHECK(std::get<std::string>(last.args[0]).size() == 253);
+
+  // The events of a thread are ordered.
+  std::vector<int64_t> next(threads_count, 0);
+
+  for (auto &event : events) {
+    if (event.name != "read")
+      continue;
+
+    auto t = std::get<int64_t>(event.args[0]);
+    CHECK(std::get<int64_t>(event.args[1]) == next[t]++);
+  }
+
+  for (auto n : next)
+    CHECK(n == events_count);
+
+  SUBCASE("dumps") {
+    file.clear();
+    file.seekg(0);
+
+    std::ostringstream dump;
+    TraceLog::dump(file, dump);
+
+    auto line = "[@0][MLIR/_Scope] compile_var_decl 'x' -42 42 0.5 `foo`\n";
+    CHECK(dump.str().find(line) != std::string::npos);
+  }
+
+  SUBCASE("throws upon a malformed log") {
+    std::istringstream input("NXCTRACE");
+    CHECK_THROWS_AS(TraceLog::read(input, [](auto &) {}), TraceLog::Error);
+  }
+
+  std::filesystem::remove(path);
+}
@@ -1,6 +1,8 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include <string>
+
 #include "fancysoft/util/utf8.hh"
 
 using namespace Fancysoft::Util;
@@ -40,3 +42,127 @@ TEST_CASE("UTF8::to_code_point") {
   CHECK(UTF8::to_code_point(u8"€") == 8364);
   CHECK(UTF8::to_code_point(u8"𝄞") == 119070);
 }
+
+TEST_CASE("UTF8::sequence_size") {
+  CHECK(UTF8::sequence_size('A') == 1);
+  CHECK(UTF8::sequence_size(0xc3) == 2);
+  CHECK(UTF8::sequence_size(0xe2) == 3);
+  CHECK(UTF8::sequence_size(0xf0) == 4);
+  CHECK(UTF8::sequence_size(0xb6) == 0); // A continuation byte
+  CHECK(UTF8::sequence_size(0xc0) == 0); // Always overlong
+  CHECK(UTF8::sequence_size(0xf5) == 0); // Above U+10FFFF
+}
+
+TEST_CASE("UTF8::validate") {
+  CHECK(UTF8::validate("") == 0);
+  CHECK(UTF8::validate("Hello, world!") == 13);
+  CHECK(UTF8::validate("aöЖ€𝄞") == 12);
+
+  // Past a 32-byte ASCII block.
+  std::string ascii(100, 'a');
+  CHECK(UTF8::validate(ascii) == 100);
+  CHECK(UTF8::validate(ascii + "ö" + ascii) == 202);
+  CHECK(UTF8::validate(ascii + "\xff" + ascii) == 100);
+
+  CHECK(UTF8::validate("a\xb6") == 1);             // Lone continuation
+  CHECK(UTF8::validate("a\xc3") == 1);             // Truncated
+  CHECK(UTF8::validate("a\xc3z") == 1);            // Not continued
+  CHECK(UTF8::validate("a\xc0\x80") == 1);         // Overlong NUL
+  CHECK(UTF8::validate("a\xe0\x80\x80") == 1);     // Overlong
+  CHECK(UTF8::validate("a\xed\xa0\x80") == 1);     // Surrogate
+  CHECK(UTF8::validate("a\xf4\x90\x80\x80") == 1); // Above U+10FFFF
+  CHECK(UTF8::validate("a\xf4\x8f\xbf\xbf") == 5); // U+10FFFF
+}
+
+TEST_CASE("UTF8::count_code_points") {
+  CHECK(UTF8::count_code_points(std::u8string_view(u8"")) == 0);
+  CHECK(UTF8::count_code_points(std::u8string_view(u8"aöЖ€𝄞")) == 5);
+
+  std::u8string source;
+
+  for (int i = 0; i < 10; i++)
+    source += u8"Hello, world! Привет, мир! 𝄞\n";
+
+  CHECK(UTF8::count_code_points(source) == 290);
+}
+
+TEST_CASE("UTF8::decode_n") {
+  char32_t out[512];
+
+  CHECK(UTF8::decode_n(std::u8string_view(u8"aöЖ€𝄞"), out) == 5);
+  CHECK(std::u32string(out, 5) == U"aöЖ€𝄞");
+
+  std::u8string source;
+  std::u32string expected;
+
+  for (int i = 0; i < 10; i++) {
+    source += u8"Hello, world! Привет, мир! 𝄞\n";
+    expected += U"Hello, world! Привет, мир! 𝄞\n";
+  }
+
+  REQUIRE(expected.size() <= 512);
+  CHECK(UTF8::decode_n(source, out) == expected.size());
+  CHECK(std::u32string(out, expected.size()) == expected);
+
+  // An invalid leading byte, also within the last four code units.
+  char8_t invalid[] = {'a', 0xb6, 'b', 0xff, 'c'};
+  CHECK(UTF8::decode_n(invalid, out) == 5);
+  CHECK(std::u32string(out, 5) == U"a\ufffdb\ufffdc");
+}
+
+TEST_CASE("UTF8::encode_n") {
+  char8_t out[1024];
+
+  CHECK(UTF8::encode_n(std::u32string_view(U"aöЖ€𝄞"), out) == 12);
+  CHECK(std::u8string(out, 12) == u8"aöЖ€𝄞");
+
+  std::u32string source;
+  std::u8string expected;
+
+  for (int i = 0; i < 10; i++) {
+    source += U"Hello, world! Hello, world! Hello, world! Привет, мир!\n";
+    expected += u8"Hello, world! Hello, world! Hello, world! Привет, мир!\n";
+  }
+
+  REQUIRE(expected.size() <= 1024);
+  CHECK(UTF8::encode_n(source, out) == expected.size());
+  CHECK(std::u8string(out, expected.size()) == expected);
+
+  // Exactly fits, without a room for the excess code units.
+  char8_t fit[3];
+  CHECK(UTF8::encode_n(std::u32string_view(U"aö"), fit) == 3);
+  CHECK(std::u8string(fit, 3) == u8"aö");
+
+  char32_t above[] = {0x110000};
+  CHECK(UTF8::encode_n(above, out) == 3);
+  CHECK(std::u8string(out, 3) == u8"\ufffd");
+}
+
+TEST_CASE("UTF8 round trip") {
+  std::u32string code_points;
+
+  for (char32_t c = 0; c <= 0x10ffff; c++)
+    if (c < 0xd800 || c > 0xdfff)
+      code_points.push_back(c);
+
+  std::u8string units(code_points.size() * 4, '\0');
+  units.resize(UTF8::encode_n(code_points, units));
+
+  std::string_view view((const char *)units.data(), units.size());
+  REQUIRE(UTF8::validate(view) == units.size());
+  REQUIRE(UTF8::count_code_points(units) == code_points.size());
+
+  std::u32string decoded(code_points.size(), 0);
+  CHECK(UTF8::decode_n(units, decoded) == code_points.size());
+  CHECK(decoded == code_points);
+
+  // The scalar functions agree with the bulk ones.
+  for (char32_t c : {0x7fu, 0x80u, 0x7ffu, 0x800u, 0xffffu, 0x10000u}) {
+    CHECK(std::u8string(UTF8::to_code_units(c)).size() ==
+          UTF8::code_point_byte_size(c));
+    CHECK(UTF8::to_code_point(UTF8::to_code_units(c)) == c);
+  }
+
+  CHECK_THROWS_AS(UTF8::code_point_byte_size(0x110000), UTF8::Error);
+  CHECK_THROWS_AS(UTF8::size_from_leading_byte(0xf8), UTF8::Error);
+}